@@ -19,6 +19,7 @@
 #include <AudioMixer.h>
 #include <AvatarMixer.h>
 #include <Logging.h>
+#include <MetricsServer.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
@@ -30,13 +31,26 @@ const char CHILD_TARGET_NAME[] = "assignment-client";
 pid_t* childForks = NULL;
 sockaddr_in customAssignmentSocket = {};
 int numForks = 0;
+int avatarBroadcastIntervalMsecs = DEFAULT_AVATAR_BROADCAST_INTERVAL_MSECS;
+int numAudioMixerThreads = 0;
+unsigned short metricsPort = 0;
 
-void childClient() {
+void childClient(int forkIndex) {
     // this is one of the child forks or there is a single assignment client, continue assignment-client execution
     
     // set the logging target to the the CHILD_TARGET_NAME
     Logging::setTargetName(CHILD_TARGET_NAME);
     
+    // each fork serves its metrics on its own port, counting up from the one we were given
+    MetricsServer* metricsServer = NULL;
+    if (::metricsPort) {
+        metricsServer = new MetricsServer(::metricsPort + forkIndex);
+        if (!metricsServer->start()) {
+            delete metricsServer;
+            metricsServer = NULL;
+        }
+    }
+    
     // create a NodeList as an unassigned client
     NodeList* nodeList = NodeList::createInstance(NODE_TYPE_UNASSIGNED);
     
@@ -94,9 +108,9 @@ void childClient() {
                 qDebug("Destination IP for assignment is %s\n", inet_ntoa(domainSocketAddr));
                 
                 if (deployedAssignment.getType() == Assignment::AudioMixerType) {
-                    AudioMixer::run();
+                    AudioMixer::run(::numAudioMixerThreads);
                 } else if (deployedAssignment.getType() == Assignment::AvatarMixerType) {
-                    AvatarMixer::run();
+                    AvatarMixer::run(::avatarBroadcastIntervalMsecs);
                 } else {
                     // figure out the URL for the script for this agent assignment
                     QString scriptURLString("http://%1:8080/assignment/%2");
@@ -143,7 +157,7 @@ void sigchldHandler(int sig) {
                 newForkProcessID = fork();
                 if (newForkProcessID == 0) {
                     // this is the child, call childClient
-                    childClient();
+                    childClient(i);
                     
                     // break out so we don't fork bomb
                     break;
@@ -208,10 +222,35 @@ int main(int argc, const char* argv[]) {
         ::customAssignmentSocket = socketForHostnameAndHostOrderPort(customAssignmentServerHostname, assignmentServerPort);
     }
     
+    // grab how often an avatar mixer should broadcast, if we were told
+    const char AVATAR_BROADCAST_INTERVAL_OPTION[] = "--avatarBroadcastIntervalMsecs";
+    const char* avatarBroadcastIntervalString = getCmdOption(argc, argv, AVATAR_BROADCAST_INTERVAL_OPTION);
+    
+    if (avatarBroadcastIntervalString && atoi(avatarBroadcastIntervalString) > 0) {
+        ::avatarBroadcastIntervalMsecs = atoi(avatarBroadcastIntervalString);
+    }
+    
+    // grab how many threads an audio mixer should mix on, if we were told, instead of one per core
+    const char AUDIO_MIXER_THREADS_OPTION[] = "--audioMixerThreads";
+    const char* audioMixerThreadsString = getCmdOption(argc, argv, AUDIO_MIXER_THREADS_OPTION);
+    
+    if (audioMixerThreadsString && atoi(audioMixerThreadsString) > 0) {
+        ::numAudioMixerThreads = atoi(audioMixerThreadsString);
+    }
+    
+    // if you want the assignment clients' metrics scraped, pass in the local port to serve them on
+    const char METRICS_PORT_OPTION[] = "--metricsPort";
+    const char* metricsPortString = getCmdOption(argc, argv, METRICS_PORT_OPTION);
+    
+    if (metricsPortString) {
+        ::metricsPort = atoi(metricsPortString);
+    }
+    
     const char* NUM_FORKS_PARAMETER = "-n";
     const char* numForksString = getCmdOption(argc, argv, NUM_FORKS_PARAMETER);
     
     int processID = 0;
+    int forkIndex = 0;
     
     if (numForksString) {
         ::numForks = atoi(numForksString);
@@ -225,6 +264,7 @@ int main(int argc, const char* argv[]) {
             
             if (processID == 0) {
                 // this is in one of the children, break so we don't start a fork bomb
+                forkIndex = i;
                 break;
             } else {
                 // this is in the parent, save the ID of the forked process
@@ -234,7 +274,7 @@ int main(int argc, const char* argv[]) {
     }
     
     if (processID == 0 || ::numForks == 0) {
-        childClient();
+        childClient(forkIndex);
     } else {
         parentMonitor();
     }
@@ -0,0 +1,187 @@
+//
+//  main.cpp
+//  Audio Mixer Bench
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Runs the audio mixer's frame loop over synthetic listeners on more and more mixing threads, timing each frame's mix
+//  into the same kind of histogram as the mixer's audio_mixer_mix_usecs metric, to see how mixing scales with cores.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <vector>
+
+#include <QtCore/QThread>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <Metrics.h>
+#include <NodeList.h>
+#include <NodeTypes.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include <AudioMixKernel.h>
+#include <AvatarAudioRingBuffer.h>
+#include <ListenerMixer.h>
+
+const int DEFAULT_NUM_LISTENERS = 100;
+const float DEFAULT_LISTENER_SPACING_METERS = 1.0f;
+const int DEFAULT_NUM_FRAMES = 2000;
+
+const int LISTENERS_PER_ROW = 10;
+const int NUM_WARMUP_FRAMES = 50;
+const int NUM_BUFFERED_FRAMES = 3;
+
+// the listeners' mixes are sent to ports nothing listens on, starting here, so they're thrown away by the network stack
+const unsigned short FIRST_LISTENER_PORT = 40000;
+
+const float PERCENTILES[] = { 0.5f, 0.9f, 0.99f, 0.999f };
+const int NUM_PERCENTILES = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+// writes a frame of microphone audio from a listener into its ring buffer, as if it had come in over the network
+void writeMicrophoneAudio(Node* node, int listenerIndex, int frame, float spacing) {
+    unsigned char packet[MAX_PACKET_SIZE];
+    unsigned char* currentPosition = packet + populateTypeAndVersion(packet, PACKET_TYPE_MICROPHONE_AUDIO_NO_ECHO);
+
+    uint16_t sourceID = node->getNodeID();
+    memcpy(currentPosition, &sourceID, sizeof(sourceID));
+    currentPosition += sizeof(sourceID);
+
+    int listenMode = AudioRingBuffer::NORMAL;
+    memcpy(currentPosition, &listenMode, sizeof(listenMode));
+    currentPosition += sizeof(listenMode);
+
+    // the listeners stand in a grid, each facing a different way
+    glm::vec3 position((listenerIndex % LISTENERS_PER_ROW) * spacing, 0.0f,
+                       (listenerIndex / LISTENERS_PER_ROW) * spacing);
+    memcpy(currentPosition, &position, sizeof(position));
+    currentPosition += sizeof(position);
+
+    glm::quat orientation = glm::angleAxis(listenerIndex * 20.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    memcpy(currentPosition, &orientation, sizeof(orientation));
+    currentPosition += sizeof(orientation);
+
+    for (int i = 0; i < BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        int16_t sample = ((i * (listenerIndex + 3) + frame * 77) % 2000) - 1000;
+        memcpy(currentPosition, &sample, sizeof(sample));
+        currentPosition += sizeof(sample);
+    }
+
+    node->getLinkedData()->parseData(packet, currentPosition - packet);
+}
+
+// one frame of AudioMixer::run(), minus the network, returning how long the mix took in usecs
+uint64_t mixFrame(ListenerMixerPool& mixerPool, std::vector<Node*>& listeners, int frame, float spacing) {
+    std::vector<Node*> sources;
+
+    for (int i = 0; i < listeners.size(); i++) {
+        PositionalAudioRingBuffer* ringBuffer = (PositionalAudioRingBuffer*) listeners[i]->getLinkedData();
+        if (ringBuffer->shouldBeAddedToMix(0)) {
+            ringBuffer->setWillBeAddedToMix(true);
+            ringBuffer->updateNextOutputLoudness();
+            sources.push_back(listeners[i]);
+        }
+    }
+
+    uint64_t mixStart = usecTimestampNow();
+    mixerPool.mixFrame(listeners, sources);
+    uint64_t mixUsecs = usecTimestampNow() - mixStart;
+
+    // push the buffers forward and give each listener its next frame of audio
+    for (int i = 0; i < listeners.size(); i++) {
+        PositionalAudioRingBuffer* ringBuffer = (PositionalAudioRingBuffer*) listeners[i]->getLinkedData();
+        if (ringBuffer->willBeAddedToMix()) {
+            ringBuffer->setNextOutput(ringBuffer->getNextOutput() + BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+
+            if (ringBuffer->getNextOutput() >= ringBuffer->getBuffer() + RING_BUFFER_LENGTH_SAMPLES) {
+                ringBuffer->setNextOutput(ringBuffer->getBuffer());
+            }
+            ringBuffer->setWillBeAddedToMix(false);
+        }
+        writeMicrophoneAudio(listeners[i], i, frame + NUM_BUFFERED_FRAMES, spacing);
+    }
+
+    return mixUsecs;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* numListenersString = getCmdOption(argc, argv, "--listeners");
+    const char* spacingString = getCmdOption(argc, argv, "--spacing");
+    const char* numFramesString = getCmdOption(argc, argv, "--frames");
+    const char* maxThreadsString = getCmdOption(argc, argv, "--maxThreads");
+
+    int numListeners = numListenersString ? atoi(numListenersString) : DEFAULT_NUM_LISTENERS;
+    float spacing = spacingString ? atof(spacingString) : DEFAULT_LISTENER_SPACING_METERS;
+    int numFrames = numFramesString ? atoi(numFramesString) : DEFAULT_NUM_FRAMES;
+    int maxThreads = maxThreadsString ? atoi(maxThreadsString) : QThread::idealThreadCount();
+
+    NodeList* nodeList = NodeList::createInstance(NODE_TYPE_AUDIO_MIXER);
+
+    std::vector<Node*> listeners;
+    for (int i = 0; i < numListeners; i++) {
+        sockaddr_in listenerSocket = {};
+        listenerSocket.sin_family = AF_INET;
+        listenerSocket.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listenerSocket.sin_port = htons(FIRST_LISTENER_PORT + i);
+
+        Node* listener = nodeList->addOrUpdateNode((sockaddr*) &listenerSocket, (sockaddr*) &listenerSocket,
+                                                   NODE_TYPE_AGENT, i + 1);
+        listener->setLinkedData(new AvatarAudioRingBuffer());
+
+        for (int frame = 0; frame < NUM_BUFFERED_FRAMES; frame++) {
+            writeMicrophoneAudio(listener, i, frame, spacing);
+        }
+        listeners.push_back(listener);
+    }
+
+    printf("%d listeners %g meters apart, %d frames per run, %d cores, %s mix loops\n", numListeners, spacing,
+           numFrames, QThread::idealThreadCount(), getAudioMixInstructionSetName(getAudioMixInstructionSet()));
+    printf("threads  pairs/frame  p50 usecs  p90 usecs  p99 usecs  p99.9 usecs  p50 speedup\n");
+
+    // double the threads each run, finishing on maxThreads
+    std::vector<int> threadCounts;
+    for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(std::max(maxThreads, 1));
+
+    uint64_t singleThreadMedianUsecs = 0;
+    int frame = 0;
+
+    for (int run = 0; run < threadCounts.size(); run++) {
+        int numThreads = threadCounts[run];
+        ListenerMixerPool mixerPool(numThreads);
+        MetricHistogram mixUsecs;
+
+        for (int i = 0; i < NUM_WARMUP_FRAMES; i++) {
+            mixFrame(mixerPool, listeners, frame++, spacing);
+        }
+        mixerPool.takeNumMixedSourcePairs();
+
+        for (int i = 0; i < numFrames; i++) {
+            mixUsecs.record(mixFrame(mixerPool, listeners, frame++, spacing));
+        }
+
+        uint64_t values[NUM_PERCENTILES];
+        uint64_t count, sum;
+        mixUsecs.getPercentiles(PERCENTILES, NUM_PERCENTILES, values, count, sum);
+
+        if (run == 0) {
+            singleThreadMedianUsecs = values[0];
+        }
+
+        printf("%7d %12d %10llu %10llu %10llu %12llu %11.2fx\n", numThreads,
+               mixerPool.takeNumMixedSourcePairs() / std::max(numFrames, 1), (unsigned long long) values[0],
+               (unsigned long long) values[1], (unsigned long long) values[2], (unsigned long long) values[3],
+               values[0] ? (float) singleThreadMedianUsecs / values[0] : 0.0f);
+    }
+
+    return 0;
+}
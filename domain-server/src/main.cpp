@@ -32,6 +32,7 @@
 #include "NodeList.h"
 #include "NodeTypes.h"
 #include "Logging.h"
+#include "Metrics.h"
 #include "PacketHeaders.h"
 #include "SharedUtil.h"
 
@@ -65,6 +66,25 @@ static int mongooseRequestHandler(struct mg_connection *conn) {
         // upload the file
         mg_upload(conn, "/tmp");
         
+        return 1;
+    } else if (strcmp(ri->uri, "/metrics") == 0 && strcmp(ri->request_method, "GET") == 0) {
+        MetricsRegistry* metrics = MetricsRegistry::getInstance();
+        
+        // these are only worth knowing when someone asks, so they're taken now rather than kept up to date
+        metrics->getGauge("domain_server_nodes", "Nodes alive")->set(NodeList::getInstance()->getNumAliveNodes());
+        
+        ::assignmentQueueMutex.lock();
+        metrics->getGauge("domain_server_queued_assignments", "Assignments waiting to be handed out")
+            ->set(::assignmentQueue.size());
+        ::assignmentQueueMutex.unlock();
+        
+        std::string metricsText;
+        metrics->writeText(metricsText);
+        
+        mg_printf(conn, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\n\r\n",
+                  (int) metricsText.size());
+        mg_write(conn, metricsText.data(), metricsText.size());
+        
         return 1;
     } else {
         // have mongoose process this request from the document_root
@@ -1324,7 +1324,8 @@ struct SendVoxelsOperationArgs {
 bool Application::sendVoxelsOperation(VoxelNode* node, void* extraData) {
     SendVoxelsOperationArgs* args = (SendVoxelsOperationArgs*)extraData;
     if (node->isColored()) {
-        unsigned char* nodeOctalCode = node->getOctalCode();
+        unsigned char nodeOctalCode[MAX_MORTON_KEY_OCTAL_CODE_BYTES];
+        node->copyOctalCode(nodeOctalCode);
         
         unsigned char* codeColorBuffer = NULL;
         int codeLength  = 0;
@@ -1410,6 +1411,7 @@ void Application::copyVoxels() {
 
 void Application::pasteVoxels() {
     unsigned char* calculatedOctCode = NULL;
+    unsigned char selectedOctCode[MAX_MORTON_KEY_OCTAL_CODE_BYTES];
     VoxelNode* selectedNode = _voxels.getVoxelAt(_mouseVoxel.x, _mouseVoxel.y, _mouseVoxel.z, _mouseVoxel.s);
 
     // Recurse the clipboard tree, where everything is root relative, and send all the colored voxels to 
@@ -1420,7 +1422,8 @@ void Application::pasteVoxels() {
     // voxel size/position details. If we don't have an actual selectedNode then use the mouseVoxel to create a 
     // target octalCode for where the user is pointing.
     if (selectedNode) {
-        args.newBaseOctCode = selectedNode->getOctalCode();
+        selectedNode->copyOctalCode(selectedOctCode);
+        args.newBaseOctCode = selectedOctCode;
     } else {
         args.newBaseOctCode = calculatedOctCode = pointToVoxel(_mouseVoxel.x, _mouseVoxel.y, _mouseVoxel.z, _mouseVoxel.s);
     }
@@ -427,6 +427,13 @@ Menu::Menu() :
                                            appInstance->getAvatar(),
                                            SLOT(setWantOcclusionCulling(bool)));
     
+    addCheckableActionToQMenuAndActionHash(developerMenu,
+                                           MenuOption::CompressVoxelPackets,
+                                           0,
+                                           true,
+                                           appInstance->getAvatar(),
+                                           SLOT(setWantCompression(bool)));
+    
     addCheckableActionToQMenuAndActionHash(developerMenu, MenuOption::CoverageMap, Qt::SHIFT | Qt::CTRL | Qt::Key_O);
     addCheckableActionToQMenuAndActionHash(developerMenu, MenuOption::CoverageMapV2, Qt::SHIFT | Qt::CTRL | Qt::Key_P);
     addCheckableActionToQMenuAndActionHash(developerMenu, MenuOption::SimulateLeapHand);
@@ -124,6 +124,7 @@ namespace MenuOption {
     const QString BandwidthDetails = "Bandwidth Details";
     const QString CheckForUpdates = "Check for Updates...";
     const QString Collisions = "Collisions";
+    const QString CompressVoxelPackets = "Compress Voxel Packets";
     const QString CopyVoxels = "Copy";
     const QString CoverageMap = "Render Coverage Map";
     const QString CoverageMapV2 = "Render Coverage Map V2";
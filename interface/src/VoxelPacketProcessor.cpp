@@ -44,9 +44,18 @@ void VoxelPacketProcessor::processPacket(sockaddr& senderAddress, unsigned char*
         }
     } // fall through to piggyback message
 
-    if (Menu::getInstance()->isOptionChecked(MenuOption::Voxels)) {
-        Node* voxelServer = NodeList::getInstance()->nodeWithAddress(&senderAddress);
-        if (voxelServer && socketMatch(voxelServer->getActiveSocket(), &senderAddress)) {
+    Node* voxelServer = NodeList::getInstance()->nodeWithAddress(&senderAddress);
+    if (voxelServer && socketMatch(voxelServer->getActiveSocket(), &senderAddress)) {
+
+        // ack voxel data even if we're not showing voxels, the server paces its sending by what gets through to us
+        if ((packetData[0] == PACKET_TYPE_VOXEL_DATA || packetData[0] == PACKET_TYPE_VOXEL_DATA_MONOCHROME)
+            && messageLength >= numBytesForPacketHeader(packetData) + (int) sizeof(VOXEL_PACKET_SEQUENCE)) {
+            VOXEL_PACKET_SEQUENCE sequence;
+            memcpy(&sequence, packetData + numBytesForPacketHeader(packetData), sizeof(sequence));
+            ackVoxelPacket(voxelServer, sequence);
+        }
+
+        if (Menu::getInstance()->isOptionChecked(MenuOption::Voxels)) {
             voxelServer->lock();
             if (packetData[0] == PACKET_TYPE_ENVIRONMENT_DATA) {
                 app->_environment.parseData(&senderAddress, packetData, messageLength);
@@ -60,3 +69,34 @@ void VoxelPacketProcessor::processPacket(sockaddr& senderAddress, unsigned char*
     }
 }
 
+void VoxelPacketProcessor::ackVoxelPacket(Node* voxelServer, VOXEL_PACKET_SEQUENCE sequence) {
+    uint64_t now = usecTimestampNow();
+
+    std::map<uint16_t, VoxelServerAckState>::iterator found = _voxelServerAckStates.find(voxelServer->getNodeID());
+    if (found == _voxelServerAckStates.end()) {
+        VoxelServerAckState newState = { sequence, 0, 0 };
+        found = _voxelServerAckStates.insert(std::make_pair(voxelServer->getNodeID(), newState)).first;
+    }
+    VoxelServerAckState& state = found->second;
+    state.packetsReceived++;
+
+    // sequence numbers wrap around, so compare them by their difference
+    if ((int16_t)(sequence - state.newestSequence) > 0) {
+        state.newestSequence = sequence;
+    }
+
+    // we ack as soon as we get a packet once the interval is up, so the server can time its round trip from it
+    if (now - state.lastAckSent >= VOXEL_PACKET_ACK_INTERVAL_USECS) {
+        unsigned char ackPacket[MAX_PACKET_HEADER_BYTES + sizeof(state.newestSequence) + sizeof(state.packetsReceived)];
+        unsigned char* ackPacketAt = ackPacket;
+        ackPacketAt += populateTypeAndVersion(ackPacket, PACKET_TYPE_VOXEL_DATA_ACK);
+        memcpy(ackPacketAt, &state.newestSequence, sizeof(state.newestSequence));
+        ackPacketAt += sizeof(state.newestSequence);
+        memcpy(ackPacketAt, &state.packetsReceived, sizeof(state.packetsReceived));
+        ackPacketAt += sizeof(state.packetsReceived);
+
+        NodeList::getInstance()->getNodeSocket()->send(voxelServer->getActiveSocket(), ackPacket, ackPacketAt - ackPacket);
+        state.lastAckSent = now;
+    }
+}
+
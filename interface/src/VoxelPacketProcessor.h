@@ -11,12 +11,28 @@
 #ifndef __shared__VoxelPacketProcessor__
 #define __shared__VoxelPacketProcessor__
 
+#include <map>
+
+#include <Node.h>
 #include <ReceivedPacketProcessor.h>
+#include <VoxelConstants.h>
 
 /// Handles processing of incoming voxel packets for the interface application. As with other ReceivedPacketProcessor classes 
 /// the user is responsible for reading inbound packets and adding them to the processing queue by calling queueReceivedPacket()
 class VoxelPacketProcessor : public ReceivedPacketProcessor {
 protected:
     virtual void processPacket(sockaddr& senderAddress, unsigned char*  packetData, ssize_t packetLength);
+
+private:
+    /// What we've received from a voxel server, which we periodically ack so that it can pace its sending to our link
+    struct VoxelServerAckState {
+        VOXEL_PACKET_SEQUENCE   newestSequence;
+        uint32_t                packetsReceived;
+        uint64_t                lastAckSent;
+    };
+
+    void ackVoxelPacket(Node* voxelServer, VOXEL_PACKET_SEQUENCE sequence);
+
+    std::map<uint16_t, VoxelServerAckState> _voxelServerAckStates;
 };
 #endif // __shared__VoxelPacketProcessor__
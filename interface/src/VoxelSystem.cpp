@@ -202,7 +202,25 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
 
     unsigned char command = *sourceBuffer;
     int numBytesPacketHeader = numBytesForPacketHeader(sourceBuffer);
-    unsigned char* voxelData = sourceBuffer + numBytesPacketHeader;
+
+    // voxel data packets have a sequence number between the header and the voxels, the VoxelPacketProcessor acks it,
+    // and then flags about how the voxels are packed
+    int numBytesBeforeVoxels = numBytesPacketHeader + sizeof(VOXEL_PACKET_SEQUENCE) + sizeof(VOXEL_PACKET_FLAGS);
+    unsigned char* voxelData = sourceBuffer + numBytesBeforeVoxels;
+    int voxelDataBytes = numBytes - numBytesBeforeVoxels;
+
+    if (command == PACKET_TYPE_VOXEL_DATA || command == PACKET_TYPE_VOXEL_DATA_MONOCHROME) {
+        VOXEL_PACKET_FLAGS flags = sourceBuffer[numBytesBeforeVoxels - sizeof(VOXEL_PACKET_FLAGS)];
+        if (oneAtBit(flags, VOXEL_PACKET_COMPRESSED_BIT)) {
+            voxelDataBytes = _packetCompressor.uncompress(voxelData, voxelDataBytes, _uncompressedVoxelData,
+                                                          sizeof(_uncompressedVoxelData));
+            voxelData = _uncompressedVoxelData;
+            if (voxelDataBytes < 0) {
+                qDebug("VoxelSystem::parseData() couldn't uncompress voxel packet, ignoring it\n");
+                return numBytes;
+            }
+        }
+    }
 
     pthread_mutex_lock(&_treeLock);
 
@@ -212,7 +230,7 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
                                     "readBitstreamToTree()");
             // ask the VoxelTree to read the bitstream into the tree
             ReadBitstreamToTreeParams args(WANT_COLOR, WANT_EXISTS_BITS, NULL, getDataSourceID());
-            _tree->readBitstreamToTree(voxelData, numBytes - numBytesPacketHeader, args);
+            _tree->readBitstreamToTree(voxelData, voxelDataBytes, args);
         }
             break;
         case PACKET_TYPE_VOXEL_DATA_MONOCHROME: {
@@ -220,7 +238,7 @@ int VoxelSystem::parseData(unsigned char* sourceBuffer, int numBytes) {
                                     "readBitstreamToTree()");
             // ask the VoxelTree to read the MONOCHROME bitstream into the tree
             ReadBitstreamToTreeParams args(NO_COLOR, WANT_EXISTS_BITS, NULL, getDataSourceID());
-            _tree->readBitstreamToTree(voxelData, numBytes - numBytesPacketHeader, args);
+            _tree->readBitstreamToTree(voxelData, voxelDataBytes, args);
         }
             break;
         case PACKET_TYPE_Z_COMMAND:
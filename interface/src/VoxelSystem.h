@@ -18,6 +18,7 @@
 #include <CoverageMapV2.h>
 #include <NodeData.h>
 #include <ViewFrustum.h>
+#include <VoxelPacketCompressor.h>
 #include <VoxelTree.h>
 
 #include "Camera.h"
@@ -197,6 +198,9 @@ private:
     pthread_mutex_t _bufferWriteLock;
     pthread_mutex_t _treeLock;
 
+    VoxelPacketCompressor _packetCompressor;
+    unsigned char _uncompressedVoxelData[MAX_UNCOMPRESSED_VOXEL_PACKET_DATA_SIZE];
+
     ViewFrustum _lastKnowViewFrustum;
     ViewFrustum _lastStableViewFrustum;
     ViewFrustum* _viewFrustum;
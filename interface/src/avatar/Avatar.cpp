@@ -816,10 +816,10 @@ bool Avatar::findRayIntersection(const glm::vec3& origin, const glm::vec3& direc
     return true;
 }
 
-int Avatar::parseData(unsigned char* sourceBuffer, int numBytes) {
+int Avatar::parseData(unsigned char* packetData, int numBytes, int offset) {
     // change in position implies movement
     glm::vec3 oldPosition = _position;
-    int bytesRead = AvatarData::parseData(sourceBuffer, numBytes);
+    int bytesRead = AvatarData::parseData(packetData, numBytes, offset);
     const float MOVE_DISTANCE_THRESHOLD = 0.001f;
     _moving = glm::distance(oldPosition, _position) > MOVE_DISTANCE_THRESHOLD;
     return bytesRead;
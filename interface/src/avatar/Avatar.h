@@ -170,7 +170,7 @@ public:
     /// \return whether or not the ray intersected
     bool findRayIntersection(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
 
-    virtual int parseData(unsigned char* sourceBuffer, int numBytes);
+    virtual int parseData(unsigned char* packetData, int numBytes, int offset);
 
     static void renderJointConnectingCone(glm::vec3 position1, glm::vec3 position2, float radius1, float radius2);
     
@@ -0,0 +1,190 @@
+//
+//  AudioMixKernel.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The inner loops of the audio mixer, vectorized with SSE2 or AVX2 when the processor has them.
+//
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// each vectorized path is compiled for its own instruction set and picked at run time, so a build for any x86 processor
+// still gets AVX2 on the processors that have it
+#define AUDIO_MIX_X86
+#include <immintrin.h>
+#define AUDIO_MIX_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#endif
+
+#include "AudioMixKernel.h"
+
+static void addSamplesToMixScalar(int32_t* mix, const int16_t* sourceSamples, int numSamples, float gain) {
+    for (int i = 0; i < numSamples; i++) {
+        mix[i] += (int32_t) (sourceSamples[i] * gain);
+    }
+}
+
+static void clampMixToSamplesScalar(const int32_t* mix, int16_t* destinationSamples, int numSamples) {
+    const int32_t MAX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
+    const int32_t MIN_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
+
+    for (int i = 0; i < numSamples; i++) {
+        destinationSamples[i] = std::min(std::max(mix[i], MIN_SAMPLE_VALUE), MAX_SAMPLE_VALUE);
+    }
+}
+
+#ifdef AUDIO_MIX_X86
+
+AUDIO_MIX_TARGET("sse2")
+static void addSamplesToMixSSE2(int32_t* mix, const int16_t* sourceSamples, int numSamples, float gain) {
+    __m128 gainVector = _mm_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i*) (sourceSamples + i));
+
+        // sign extend to 32 bits by putting each sample in the high half and shifting it back down
+        __m128i lowSamples = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i highSamples = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+        lowSamples = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lowSamples), gainVector));
+        highSamples = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(highSamples), gainVector));
+
+        __m128i lowMixed = _mm_loadu_si128((const __m128i*) (mix + i));
+        __m128i highMixed = _mm_loadu_si128((const __m128i*) (mix + i + 4));
+        _mm_storeu_si128((__m128i*) (mix + i), _mm_add_epi32(lowMixed, lowSamples));
+        _mm_storeu_si128((__m128i*) (mix + i + 4), _mm_add_epi32(highMixed, highSamples));
+    }
+
+    addSamplesToMixScalar(mix + i, sourceSamples + i, numSamples - i, gain);
+}
+
+AUDIO_MIX_TARGET("sse2")
+static void clampMixToSamplesSSE2(const int32_t* mix, int16_t* destinationSamples, int numSamples) {
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i lowMixed = _mm_loadu_si128((const __m128i*) (mix + i));
+        __m128i highMixed = _mm_loadu_si128((const __m128i*) (mix + i + 4));
+        _mm_storeu_si128((__m128i*) (destinationSamples + i), _mm_packs_epi32(lowMixed, highMixed));
+    }
+
+    clampMixToSamplesScalar(mix + i, destinationSamples + i, numSamples - i);
+}
+
+AUDIO_MIX_TARGET("avx2")
+static void addSamplesToMixAVX2(int32_t* mix, const int16_t* sourceSamples, int numSamples, float gain) {
+    __m256 gainVector = _mm256_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8) {
+        __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (sourceSamples + i)));
+        samples = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(samples), gainVector));
+
+        __m256i mixed = _mm256_loadu_si256((const __m256i*) (mix + i));
+        _mm256_storeu_si256((__m256i*) (mix + i), _mm256_add_epi32(mixed, samples));
+    }
+
+    addSamplesToMixScalar(mix + i, sourceSamples + i, numSamples - i, gain);
+}
+
+AUDIO_MIX_TARGET("avx2")
+static void clampMixToSamplesAVX2(const int32_t* mix, int16_t* destinationSamples, int numSamples) {
+    int i = 0;
+
+    for (; i + 16 <= numSamples; i += 16) {
+        __m256i lowMixed = _mm256_loadu_si256((const __m256i*) (mix + i));
+        __m256i highMixed = _mm256_loadu_si256((const __m256i*) (mix + i + 8));
+
+        // the pack saturates, but works within each 128 bit lane, so put the 64 bit quarters back in order after
+        __m256i samples = _mm256_permute4x64_epi64(_mm256_packs_epi32(lowMixed, highMixed), 0xD8);
+        _mm256_storeu_si256((__m256i*) (destinationSamples + i), samples);
+    }
+
+    clampMixToSamplesScalar(mix + i, destinationSamples + i, numSamples - i);
+}
+
+#endif // AUDIO_MIX_X86
+
+typedef void (*AddSamplesToMixFunction)(int32_t*, const int16_t*, int, float);
+typedef void (*ClampMixToSamplesFunction)(const int32_t*, int16_t*, int);
+
+static AddSamplesToMixFunction addSamplesToMixFunction = addSamplesToMixScalar;
+static ClampMixToSamplesFunction clampMixToSamplesFunction = clampMixToSamplesScalar;
+static AudioMixInstructionSet audioMixInstructionSet = setBestAudioMixInstructionSet();
+
+bool isAudioMixInstructionSetSupported(AudioMixInstructionSet instructionSet) {
+    switch (instructionSet) {
+        case AUDIO_MIX_SCALAR:
+            return true;
+#ifdef AUDIO_MIX_X86
+        case AUDIO_MIX_SSE2:
+            // this can run before the static constructors that normally set up __builtin_cpu_supports()
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case AUDIO_MIX_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+bool setAudioMixInstructionSet(AudioMixInstructionSet instructionSet) {
+    if (!isAudioMixInstructionSetSupported(instructionSet)) {
+        return false;
+    }
+
+    switch (instructionSet) {
+#ifdef AUDIO_MIX_X86
+        case AUDIO_MIX_SSE2:
+            addSamplesToMixFunction = addSamplesToMixSSE2;
+            clampMixToSamplesFunction = clampMixToSamplesSSE2;
+            break;
+        case AUDIO_MIX_AVX2:
+            addSamplesToMixFunction = addSamplesToMixAVX2;
+            clampMixToSamplesFunction = clampMixToSamplesAVX2;
+            break;
+#endif
+        default:
+            addSamplesToMixFunction = addSamplesToMixScalar;
+            clampMixToSamplesFunction = clampMixToSamplesScalar;
+            break;
+    }
+    audioMixInstructionSet = instructionSet;
+    return true;
+}
+
+AudioMixInstructionSet setBestAudioMixInstructionSet() {
+    if (!setAudioMixInstructionSet(AUDIO_MIX_AVX2) && !setAudioMixInstructionSet(AUDIO_MIX_SSE2)) {
+        setAudioMixInstructionSet(AUDIO_MIX_SCALAR);
+    }
+    return audioMixInstructionSet;
+}
+
+AudioMixInstructionSet getAudioMixInstructionSet() {
+    return audioMixInstructionSet;
+}
+
+const char* getAudioMixInstructionSetName(AudioMixInstructionSet instructionSet) {
+    switch (instructionSet) {
+        case AUDIO_MIX_SSE2:
+            return "SSE2";
+        case AUDIO_MIX_AVX2:
+            return "AVX2";
+        default:
+            return "scalar";
+    }
+}
+
+void addSamplesToMix(int32_t* mix, const int16_t* sourceSamples, int numSamples, float gain) {
+    addSamplesToMixFunction(mix, sourceSamples, numSamples, gain);
+}
+
+void clampMixToSamples(const int32_t* mix, int16_t* destinationSamples, int numSamples) {
+    clampMixToSamplesFunction(mix, destinationSamples, numSamples);
+}
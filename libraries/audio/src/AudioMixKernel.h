@@ -0,0 +1,43 @@
+//
+//  AudioMixKernel.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The inner loops of the audio mixer, vectorized with SSE2 or AVX2 when the processor has them.
+//
+
+#ifndef __hifi__AudioMixKernel__
+#define __hifi__AudioMixKernel__
+
+#include <stdint.h>
+
+/// Adds numSamples source samples, scaled by gain, into a 32 bit mix. Mixing into 32 bits means a listener's sources can
+/// all be added before saturating, rather than clamping after every add.
+void addSamplesToMix(int32_t* mix, const int16_t* sourceSamples, int numSamples, float gain);
+
+/// Saturates numSamples of a 32 bit mix down to 16 bit samples.
+void clampMixToSamples(const int32_t* mix, int16_t* destinationSamples, int numSamples);
+
+/// The versions of the mix loops. On x86 builds with GCC or Clang every version is compiled in, and the best one the
+/// processor supports is picked when the program starts. Other builds only have the scalar version.
+enum AudioMixInstructionSet {
+    AUDIO_MIX_SCALAR,
+    AUDIO_MIX_SSE2,
+    AUDIO_MIX_AVX2
+};
+
+bool isAudioMixInstructionSetSupported(AudioMixInstructionSet instructionSet);
+
+/// Switches the mix loops over to another version, for comparing them. Returns false, and leaves them alone, if the
+/// processor doesn't support it. Not thread safe, only call it while nothing is mixing.
+bool setAudioMixInstructionSet(AudioMixInstructionSet instructionSet);
+
+/// Switches to the best version the processor supports, and returns it
+AudioMixInstructionSet setBestAudioMixInstructionSet();
+
+AudioMixInstructionSet getAudioMixInstructionSet();
+const char* getAudioMixInstructionSetName(AudioMixInstructionSet instructionSet);
+
+#endif /* defined(__hifi__AudioMixKernel__) */
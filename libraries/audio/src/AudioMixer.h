@@ -12,8 +12,8 @@
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
 class AudioMixer {
 public:
-    /// runs the audio mixer
-    static void run();
+    /// runs the audio mixer, mixing on numMixingThreads threads, or on a thread per core if it's 0
+    static void run(int numMixingThreads = 0);
 };
 
 #endif /* defined(__hifi__AudioMixer__) */
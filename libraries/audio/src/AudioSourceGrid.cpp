@@ -0,0 +1,49 @@
+//
+//  AudioSourceGrid.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The sources being mixed in a frame, bucketed by position.
+//
+
+#include <NodeTypes.h>
+
+#include "InjectedAudioRingBuffer.h"
+
+#include "AudioSourceGrid.h"
+
+// appends each source it visits to a list of source indices
+class AppendSourceIndex {
+public:
+    AppendSourceIndex(std::vector<int>& sourceIndices) : _sourceIndices(sourceIndices) { }
+    
+    void operator()(int sourceIndex) { _sourceIndices.push_back(sourceIndex); }
+    
+private:
+    std::vector<int>& _sourceIndices;
+};
+
+void AudioSourceGrid::build(const std::vector<Node*>& sources, float cellSize) {
+    _cells.clear(cellSize);
+    _unboundedSources.clear();
+    
+    for (int i = 0; i < sources.size(); i++) {
+        PositionalAudioRingBuffer* sourceBuffer = (PositionalAudioRingBuffer*) sources[i]->getLinkedData();
+        
+        if (sources[i]->getType() == NODE_TYPE_AUDIO_INJECTOR
+            && ((InjectedAudioRingBuffer*) sourceBuffer)->getRadius() > 0.0f) {
+            _unboundedSources.push_back(i);
+        } else {
+            _cells.insert(sourceBuffer->getPosition(), i);
+        }
+    }
+}
+
+void AudioSourceGrid::findNearbySources(const glm::vec3& position, std::vector<int>& sourceIndices) const {
+    AppendSourceIndex appendSourceIndex(sourceIndices);
+    _cells.visitNearby(position, appendSourceIndex);
+    
+    sourceIndices.insert(sourceIndices.end(), _unboundedSources.begin(), _unboundedSources.end());
+}
@@ -0,0 +1,39 @@
+//
+//  AudioSourceGrid.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The sources being mixed in a frame, bucketed by position.
+//
+
+#ifndef __hifi__AudioSourceGrid__
+#define __hifi__AudioSourceGrid__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Node.h>
+#include <UniformGrid.h>
+
+/// Buckets a frame's sources into cubic cells, so a listener only has to look at the sources near enough to hear. With
+/// cells as big as the furthest any source can be heard, everything a listener can hear is in its own cell or the 26
+/// around it.
+class AudioSourceGrid {
+public:
+    /// Buckets the sources, by index, into cells cellSize on a side
+    void build(const std::vector<Node*>& sources, float cellSize);
+    
+    /// Appends the indices of the sources that could be heard from position to sourceIndices
+    void findNearbySources(const glm::vec3& position, std::vector<int>& sourceIndices) const;
+    
+private:
+    UniformGrid<int> _cells;
+    
+    // spherical injectors can be heard from anywhere inside them, so they're near every listener
+    std::vector<int> _unboundedSources;
+};
+
+#endif /* defined(__hifi__AudioSourceGrid__) */
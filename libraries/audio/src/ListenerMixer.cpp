@@ -0,0 +1,353 @@
+//
+//  ListenerMixer.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  Mixes and sends the audio each listener hears, split across a pool of mixing threads.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include <glm/gtx/vector_angle.hpp>
+
+#include <PacketHeaders.h>
+
+#include "AudioMixKernel.h"
+#include "AvatarAudioRingBuffer.h"
+#include "InjectedAudioRingBuffer.h"
+
+#include "ListenerMixer.h"
+
+const int PHASE_DELAY_AT_90 = 20;
+
+const float DISTANCE_SCALE = 2.5f;
+const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
+const float DISTANCE_LOG_BASE = 2.5f;
+const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
+
+const float MIN_AUDIO_GRID_CELL_SIZE = 1.0f;
+
+// the attenuation of a source this far away
+static float distanceCoefficientForDistanceSquared(float distanceSquareToSource) {
+    float distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
+                                     DISTANCE_SCALE_LOG +
+                                     (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
+    return std::min(1.0f, distanceCoefficient);
+}
+
+// how far away a source this loud is still audible, the inverse of distanceCoefficientForDistanceSquared()
+static float audibleDistanceForLoudness(float loudness) {
+    if (loudness <= MIN_AUDIBLE_LOUDNESS) {
+        return 0.0f;
+    }
+    
+    float exponent = logf(MIN_AUDIBLE_LOUDNESS / loudness) / logf(GEOMETRIC_AMPLITUDE_SCALAR);
+    return powf(DISTANCE_LOG_BASE, exponent - DISTANCE_SCALE_LOG + 1);
+}
+
+static bool isLouderSource(const AudibleSource& source, const AudibleSource& otherSource) {
+    return source.loudness > otherSource.loudness;
+}
+
+ListenerMixer::ListenerMixer() :
+    _stkFrameBuffer(BUFFER_LENGTH_SAMPLES_PER_CHANNEL, 1),
+    _numBytesPacketHeader(numBytesForPacketHeader((unsigned char*) &PACKET_TYPE_MIXED_AUDIO)),
+    _clientPacketLength(BUFFER_LENGTH_BYTES_STEREO + _numBytesPacketHeader),
+    _clientPackets(new unsigned char[MAX_BATCH_PACKETS * _clientPacketLength]),
+    _numClientPackets(0),
+    _numMixedSourcePairs(0)
+{
+    for (int i = 0; i < MAX_BATCH_PACKETS; i++) {
+        populateTypeAndVersion(_clientPackets + (i * _clientPacketLength), PACKET_TYPE_MIXED_AUDIO);
+        _clientPacketBatch[i].data = _clientPackets + (i * _clientPacketLength);
+        _clientPacketBatch[i].byteLength = _clientPacketLength;
+    }
+}
+
+ListenerMixer::~ListenerMixer() {
+    delete[] _clientPackets;
+}
+
+void ListenerMixer::findAudibleSources(Node* node, const std::vector<Node*>& sources, const AudioSourceGrid& sourceGrid) {
+    AvatarAudioRingBuffer* nodeRingBuffer = (AvatarAudioRingBuffer*) node->getLinkedData();
+    bool isAttenuating = nodeRingBuffer->getListeningMode() == AudioRingBuffer::NORMAL;
+    
+    _audibleSources.clear();
+    _nearbySourceIndices.clear();
+    
+    if (isAttenuating) {
+        sourceGrid.findNearbySources(nodeRingBuffer->getPosition(), _nearbySourceIndices);
+    } else {
+        // without distance attenuation any source could be heard
+        for (int i = 0; i < sources.size(); i++) {
+            _nearbySourceIndices.push_back(i);
+        }
+    }
+    
+    for (int i = 0; i < _nearbySourceIndices.size(); i++) {
+        Node* otherNode = sources[_nearbySourceIndices[i]];
+        
+        if (otherNode == node && !nodeRingBuffer->shouldLoopbackForNode()) {
+            continue;
+        }
+        
+        // based on our listen mode we will do this mixing...
+        if (!nodeRingBuffer->isListeningToNode(*otherNode)) {
+            continue;
+        }
+        
+        PositionalAudioRingBuffer* otherNodeBuffer = (PositionalAudioRingBuffer*) otherNode->getLinkedData();
+        
+        AudibleSource audibleSource;
+        audibleSource.node = otherNode;
+        audibleSource.distanceCoefficient = 1.0f;
+        audibleSource.loudness = otherNodeBuffer->getNextOutputLoudness();
+        
+        if (otherNode != node && isAttenuating) {
+            glm::vec3 relativePosition = otherNodeBuffer->getPosition() - nodeRingBuffer->getPosition();
+            float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
+            float radius = 0.0f;
+            
+            if (otherNode->getType() == NODE_TYPE_AUDIO_INJECTOR) {
+                InjectedAudioRingBuffer* injectedBuffer = (InjectedAudioRingBuffer*) otherNodeBuffer;
+                radius = injectedBuffer->getRadius();
+                audibleSource.loudness *= injectedBuffer->getAttenuationRatio();
+            }
+            
+            if (radius == 0 || (distanceSquareToSource > radius * radius)) {
+                // this is either not a spherical source, or the listener is outside the sphere
+                // for a spherical source the distance used for the coefficient
+                // needs to be the closest point on the boundary to the source
+                audibleSource.distanceCoefficient = distanceCoefficientForDistanceSquared(distanceSquareToSource
+                                                                                          - (radius * radius));
+            }
+            
+            audibleSource.loudness *= audibleSource.distanceCoefficient;
+        }
+        
+        // off axis attenuation only ever makes a source quieter, so this is as loud as it can be
+        if (audibleSource.loudness >= MIN_AUDIBLE_LOUDNESS) {
+            _audibleSources.push_back(audibleSource);
+        }
+    }
+    
+    if (_audibleSources.size() > MAX_MIXED_SOURCES_PER_LISTENER) {
+        // only the loudest get mixed
+        std::nth_element(_audibleSources.begin(), _audibleSources.begin() + MAX_MIXED_SOURCES_PER_LISTENER - 1,
+                         _audibleSources.end(), isLouderSource);
+        _audibleSources.resize(MAX_MIXED_SOURCES_PER_LISTENER);
+    }
+}
+
+void ListenerMixer::mixForListener(Node* node, const std::vector<Node*>& sources, const AudioSourceGrid& sourceGrid) {
+    AvatarAudioRingBuffer* nodeRingBuffer = (AvatarAudioRingBuffer*) node->getLinkedData();
+    
+    // zero out the client mix for this node
+    memset(_clientMix, 0, sizeof(_clientMix));
+    
+    findAudibleSources(node, sources, sourceGrid);
+    
+    // loop through the loudest of the sources this node can hear
+    for (int i = 0; i < _audibleSources.size(); i++) {
+        Node* otherNode = _audibleSources[i].node;
+        PositionalAudioRingBuffer* otherNodeBuffer = (PositionalAudioRingBuffer*) otherNode->getLinkedData();
+        
+        float bearingRelativeAngleToSource = 0.0f;
+        float attenuationCoefficient = 1.0f;
+        int numSamplesDelay = 0;
+        float weakChannelAmplitudeRatio = 1.0f;
+        
+        stk::TwoPole* otherNodeTwoPole = NULL;
+        
+        // only do axis/distance attenuation when in normal mode
+        if (otherNode != node && nodeRingBuffer->getListeningMode() == AudioRingBuffer::NORMAL) {
+            
+            glm::vec3 listenerPosition = nodeRingBuffer->getPosition();
+            glm::vec3 relativePosition = otherNodeBuffer->getPosition() - nodeRingBuffer->getPosition();
+            glm::quat inverseOrientation = glm::inverse(nodeRingBuffer->getOrientation());
+            
+            float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
+            float radius = 0.0f;
+            
+            if (otherNode->getType() == NODE_TYPE_AUDIO_INJECTOR) {
+                InjectedAudioRingBuffer* injectedBuffer = (InjectedAudioRingBuffer*) otherNodeBuffer;
+                radius = injectedBuffer->getRadius();
+                attenuationCoefficient *= injectedBuffer->getAttenuationRatio();
+            }
+            
+            if (radius == 0 || (distanceSquareToSource > radius * radius)) {
+                // this is either not a spherical source, or the listener is outside the sphere
+                
+                if (radius == 0) {
+                    // calculate the angle delivery for off-axis attenuation
+                    glm::vec3 rotatedListenerPosition = glm::inverse(otherNodeBuffer->getOrientation())
+                    * relativePosition;
+                    
+                    float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                                       glm::normalize(rotatedListenerPosition));
+                    
+                    const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
+                    const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
+                    
+                    float offAxisCoefficient = MAX_OFF_AXIS_ATTENUATION +
+                    (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / 90.0f));
+                    
+                    // multiply the current attenuation coefficient by the calculated off axis coefficient
+                    attenuationCoefficient *= offAxisCoefficient;
+                }
+                
+                glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
+                
+                // multiply the current attenuation coefficient by the distance coefficient, which was worked out
+                // from the distance to this node when it was picked as one of the audible sources
+                attenuationCoefficient *= _audibleSources[i].distanceCoefficient;
+                
+                // project the rotated source position vector onto the XZ plane
+                rotatedSourcePosition.y = 0.0f;
+                
+                // produce an oriented angle about the y-axis
+                bearingRelativeAngleToSource = glm::orientedAngle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                                                  glm::normalize(rotatedSourcePosition),
+                                                                  glm::vec3(0.0f, 1.0f, 0.0f));
+                
+                const float PHASE_AMPLITUDE_RATIO_AT_90 = 0.5;
+                
+                // figure out the number of samples of delay and the ratio of the amplitude
+                // in the weak channel for audio spatialization
+                float sinRatio = fabsf(sinf(glm::radians(bearingRelativeAngleToSource)));
+                numSamplesDelay = PHASE_DELAY_AT_90 * sinRatio;
+                weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+                
+                // grab the TwoPole object for this source, add it if it doesn't exist
+                TwoPoleNodeMap& nodeTwoPoles = nodeRingBuffer->getTwoPoles();
+                TwoPoleNodeMap::iterator twoPoleIterator = nodeTwoPoles.find(otherNode->getNodeID());
+                
+                if (twoPoleIterator == nodeTwoPoles.end()) {
+                    // setup the freeVerb effect for this source for this client
+                    otherNodeTwoPole = nodeTwoPoles[otherNode->getNodeID()] = new stk::TwoPole;
+                } else {
+                    otherNodeTwoPole = twoPoleIterator->second;
+                }
+                
+                // calculate the reasonance for this TwoPole based on angle to source
+                float TWO_POLE_CUT_OFF_FREQUENCY = 800.0f;
+                float TWO_POLE_MAX_FILTER_STRENGTH = 0.4f;
+                
+                otherNodeTwoPole->setResonance(TWO_POLE_CUT_OFF_FREQUENCY,
+                                               TWO_POLE_MAX_FILTER_STRENGTH
+                                               * fabsf(bearingRelativeAngleToSource) / 180.0f,
+                                               true);
+            }
+        }
+        
+        int16_t* sourceBuffer = otherNodeBuffer->getNextOutput();
+        
+        int32_t* goodChannel = (bearingRelativeAngleToSource > 0.0f)
+        ? _clientMix
+        : _clientMix + BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+        int32_t* delayedChannel = (bearingRelativeAngleToSource > 0.0f)
+        ? _clientMix + BUFFER_LENGTH_SAMPLES_PER_CHANNEL
+        : _clientMix;
+        
+        int16_t* delaySamplePointer = otherNodeBuffer->getNextOutput() == otherNodeBuffer->getBuffer()
+        ? otherNodeBuffer->getBuffer() + RING_BUFFER_LENGTH_SAMPLES - numSamplesDelay
+        : otherNodeBuffer->getNextOutput() - numSamplesDelay;
+        
+        if (otherNodeTwoPole) {
+            // run this source's samples through the TwoPole effect
+            for (int s = 0; s < BUFFER_LENGTH_SAMPLES_PER_CHANNEL; s++) {
+                _stkFrameBuffer[s] = (stk::StkFloat) sourceBuffer[s];
+            }
+            
+            otherNodeTwoPole->tick(_stkFrameBuffer);
+            
+            for (int s = 0; s < BUFFER_LENGTH_SAMPLES_PER_CHANNEL; s++) {
+                _filteredSamples[s] = (int16_t) _stkFrameBuffer[s];
+            }
+            
+            sourceBuffer = _filteredSamples;
+        }
+        
+        float weakChannelAttenuation = attenuationCoefficient * weakChannelAmplitudeRatio;
+        
+        addSamplesToMix(goodChannel, sourceBuffer, BUFFER_LENGTH_SAMPLES_PER_CHANNEL,
+                        attenuationCoefficient);
+        
+        // the delayed channel starts with the end of the last frame, then takes this one
+        addSamplesToMix(delayedChannel, delaySamplePointer, numSamplesDelay, weakChannelAttenuation);
+        addSamplesToMix(delayedChannel + numSamplesDelay, sourceBuffer,
+                        BUFFER_LENGTH_SAMPLES_PER_CHANNEL - numSamplesDelay, weakChannelAttenuation);
+        
+        _numMixedSourcePairs++;
+    }
+    
+    clampMixToSamples(_clientMix, _clientSamples, BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2);
+    
+    unsigned char* clientPacket = (unsigned char*) _clientPacketBatch[_numClientPackets].data;
+    memcpy(clientPacket + _numBytesPacketHeader, _clientSamples, sizeof(_clientSamples));
+    _clientPacketBatch[_numClientPackets].address = node->getPublicSocket();
+    
+    if (++_numClientPackets == MAX_BATCH_PACKETS) {
+        sendQueuedMixes();
+    }
+}
+
+void ListenerMixer::sendQueuedMixes() {
+    if (_numClientPackets > 0) {
+        NodeList::getInstance()->getNodeSocket()->sendBatch(_clientPacketBatch, _numClientPackets);
+        _numClientPackets = 0;
+    }
+}
+
+ListenerMixerPool::ListenerMixerPool(int numThreads) :
+    TickWorkerPool(numThreads),
+    _listeners(NULL),
+    _sources(NULL)
+{
+    for (int i = 0; i < getNumThreads(); i++) {
+        _mixers.push_back(new ListenerMixer());
+    }
+}
+
+ListenerMixerPool::~ListenerMixerPool() {
+    for (int i = 0; i < _mixers.size(); i++) {
+        delete _mixers[i];
+    }
+}
+
+void ListenerMixerPool::mixFrame(const std::vector<Node*>& listeners, const std::vector<Node*>& sources) {
+    // with grid cells as big as the loudest source can be heard from, a listener only needs to look in its own cell and
+    // the ones around it
+    float maxLoudness = 0.0f;
+    for (int i = 0; i < sources.size(); i++) {
+        maxLoudness = std::max(maxLoudness, ((PositionalAudioRingBuffer*) sources[i]->getLinkedData())->getNextOutputLoudness());
+    }
+    _sourceGrid.build(sources, std::max(audibleDistanceForLoudness(maxLoudness), MIN_AUDIO_GRID_CELL_SIZE));
+    
+    _listeners = &listeners;
+    _sources = &sources;
+    runTick(listeners.size());
+}
+
+int ListenerMixerPool::takeNumMixedSourcePairs() {
+    int numMixedSourcePairs = 0;
+    for (int i = 0; i < _mixers.size(); i++) {
+        numMixedSourcePairs += _mixers[i]->getNumMixedSourcePairs();
+        _mixers[i]->resetNumMixedSourcePairs();
+    }
+    return numMixedSourcePairs;
+}
+
+void ListenerMixerPool::workItem(int threadIndex, int itemIndex) {
+    _mixers[threadIndex]->mixForListener((*_listeners)[itemIndex], *_sources, _sourceGrid);
+}
+
+void ListenerMixerPool::finishTick(int threadIndex) {
+    _mixers[threadIndex]->sendQueuedMixes();
+}
@@ -0,0 +1,107 @@
+//
+//  ListenerMixer.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  Mixes and sends the audio each listener hears, split across a pool of mixing threads.
+//
+
+#ifndef __hifi__ListenerMixer__
+#define __hifi__ListenerMixer__
+
+#include <stdint.h>
+#include <vector>
+
+#include <Stk.h>
+
+#include <NodeList.h>
+#include <TickWorkerPool.h>
+#include <UDPSocket.h>
+
+#include "AudioRingBuffer.h"
+#include "AudioSourceGrid.h"
+
+/// Sources quieter than this, as an average sample magnitude after distance attenuation, aren't mixed
+const float MIN_AUDIBLE_LOUDNESS = 1.0f;
+
+/// Each listener hears at most this many sources, the loudest ones
+const int MAX_MIXED_SOURCES_PER_LISTENER = 16;
+
+struct AudibleSource {
+    Node* node;
+    float distanceCoefficient;
+    float loudness; // after attenuation, as the listener hears it
+};
+
+/// Mixes the audio for one listener at a time. Each mixing thread has its own, so they have their own buffers to mix in
+/// and their own packets to queue the mixes in.
+class ListenerMixer {
+public:
+    ListenerMixer();
+    ~ListenerMixer();
+    
+    /// Mixes the loudest sources a listener can hear into its mix, and queues the mix up to be sent. The sources are only
+    /// read, and the only state changed is the listener's own.
+    void mixForListener(Node* node, const std::vector<Node*>& sources, const AudioSourceGrid& sourceGrid);
+    
+    /// Sends the mixes that are still queued
+    void sendQueuedMixes();
+    
+    int getNumMixedSourcePairs() const { return _numMixedSourcePairs; }
+    void resetNumMixedSourcePairs() { _numMixedSourcePairs = 0; }
+    
+private:
+    // intentionally not implemented
+    ListenerMixer(const ListenerMixer&);
+    ListenerMixer& operator= (const ListenerMixer&);
+    
+    /// Picks the sources near the listener that are loud enough to hear, keeping the MAX_MIXED_SOURCES_PER_LISTENER
+    /// loudest of them
+    void findAudibleSources(Node* node, const std::vector<Node*>& sources, const AudioSourceGrid& sourceGrid);
+    
+    std::vector<int> _nearbySourceIndices;
+    std::vector<AudibleSource> _audibleSources;
+    
+    // each client's sources are mixed at 32 bits and only clamped down to _clientSamples once they're all in
+    int32_t _clientMix[BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2];
+    int16_t _clientSamples[BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 2];
+    int16_t _filteredSamples[BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    stk::StkFrames _stkFrameBuffer;
+    
+    // the mixes are queued up and sent together, MAX_BATCH_PACKETS at a time
+    int _numBytesPacketHeader;
+    int _clientPacketLength;
+    unsigned char* _clientPackets;
+    UDPBatchPacket _clientPacketBatch[MAX_BATCH_PACKETS];
+    int _numClientPackets;
+    
+    int _numMixedSourcePairs;
+};
+
+/// Mixes a frame for all the listeners across numThreads threads, the calling thread being one of them, with a mixer each
+class ListenerMixerPool : public TickWorkerPool {
+public:
+    ListenerMixerPool(int numThreads);
+    ~ListenerMixerPool();
+    
+    /// Mixes and sends this frame for all of the listeners, returning once every mix has been sent
+    void mixFrame(const std::vector<Node*>& listeners, const std::vector<Node*>& sources);
+    
+    /// The number of listener and source pairs mixed since the last call
+    int takeNumMixedSourcePairs();
+    
+protected:
+    virtual void workItem(int threadIndex, int itemIndex);
+    virtual void finishTick(int threadIndex);
+    
+private:
+    std::vector<ListenerMixer*> _mixers; // one for each thread, by index
+    
+    const std::vector<Node*>* _listeners;
+    const std::vector<Node*>* _sources;
+    AudioSourceGrid _sourceGrid;
+};
+
+#endif /* defined(__hifi__ListenerMixer__) */
@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <cstdlib>
 #include <cstring>
 
 #include <Node.h>
@@ -18,6 +19,7 @@ PositionalAudioRingBuffer::PositionalAudioRingBuffer() :
     _position(0.0f, 0.0f, 0.0f),
     _orientation(0.0f, 0.0f, 0.0f, 0.0f),
     _willBeAddedToMix(false),
+    _nextOutputLoudness(0.0f),
     _listenMode(AudioRingBuffer::NORMAL),
     _listenRadius(0.0f)
 {
@@ -123,3 +125,12 @@ bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
     printf("packet mismatch...\n");
     return false;
 }
+
+void PositionalAudioRingBuffer::updateNextOutputLoudness() {
+    int sumOfMagnitudes = 0;
+    for (int i = 0; i < BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        sumOfMagnitudes += abs(_nextOutput[i]);
+    }
+    
+    _nextOutputLoudness = (float) sumOfMagnitudes / BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+}
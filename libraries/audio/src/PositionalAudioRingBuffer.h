@@ -28,6 +28,10 @@ public:
     bool willBeAddedToMix() const { return _willBeAddedToMix; }
     void setWillBeAddedToMix(bool willBeAddedToMix) { _willBeAddedToMix = willBeAddedToMix; }
     
+    /// The average magnitude of the samples about to be mixed, as of the last updateNextOutputLoudness()
+    float getNextOutputLoudness() const { return _nextOutputLoudness; }
+    void updateNextOutputLoudness();
+    
     const glm::vec3& getPosition() const { return _position; }
     const glm::quat& getOrientation() const { return _orientation; }
 
@@ -42,6 +46,7 @@ protected:
     glm::vec3 _position;
     glm::quat _orientation;
     bool _willBeAddedToMix;
+    float _nextOutputLoudness;
     
     ListenMode          _listenMode;
     float               _listenRadius;
@@ -0,0 +1,205 @@
+//
+//  AvatarBroadcaster.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  Builds and sends the avatar data each receiver gets, split across a pool of broadcasting threads.
+//
+
+#include <algorithm>
+#include <limits.h>
+
+#include <PacketHeaders.h>
+
+#include "AvatarBroadcaster.h"
+
+// how big an avatar is, for seeing if it's in a receiver's view
+const float AVATAR_VIEW_RADIUS = 1.0f;
+
+// avatars out of view are sent after in view ones this much closer
+const float OUT_OF_VIEW_DISTANCE_SCALE = 2.0f;
+
+bool avatarToSendComesFirst(const AvatarToSend& a, const AvatarToSend& b) {
+    return a.priority < b.priority;
+}
+
+AvatarBroadcaster::AvatarBroadcaster() :
+    _packetsSentMetric(MetricsRegistry::getInstance()->getCounter("avatar_mixer_sent_packets_total",
+                                                                   "Bulk avatar data packets sent")),
+    _bytesSentMetric(MetricsRegistry::getInstance()->getCounter("avatar_mixer_sent_bytes_total",
+                                                                 "Bulk avatar data bytes sent"))
+{
+}
+
+void AvatarBroadcaster::broadcastToReceiver(Node* receiverNode, const AvatarGrid& avatarGrid, int tick) {
+    AvatarMixerNodeData* receiverData = (AvatarMixerNodeData*) receiverNode->getLinkedData();
+    if (receiverData->getNumBroadcastsReceived() % AVATAR_KEYFRAME_INTERVAL_TICKS == 0) {
+        receiverData->pruneBroadcastHistories(tick);
+    }
+    
+    _avatarsToSend.clear();
+    findAvatarsToSend(receiverNode, avatarGrid);
+    
+    // positions are sent relative to a whole meter near the receiver, so the avatars come out in the same place however
+    // the receiver moves around in it
+    sendAvatars(receiverNode->getActiveSocket(), glm::floor(receiverData->getBroadcastPosition()), receiverData, tick,
+                MAX_BROADCAST_BYTES_PER_RECEIVER);
+}
+
+void AvatarBroadcaster::broadcastToAddress(sockaddr* address, const std::vector<Node*>& avatars) {
+    _avatarsToSend.clear();
+    for (int i = 0; i < avatars.size(); i++) {
+        AvatarToSend avatarToSend = { (AvatarMixerNodeData*) avatars[i]->getLinkedData(), 0.0f };
+        _avatarsToSend.push_back(avatarToSend);
+    }
+    sendAvatars(address, glm::vec3(0.0f, 0.0f, 0.0f), NULL, 0, INT_MAX);
+}
+
+void AvatarBroadcaster::findAvatarsToSend(Node* receiverNode, const AvatarGrid& avatarGrid) {
+    _nearbyAvatars.clear();
+    
+    AvatarMixerNodeData* receiverData = (AvatarMixerNodeData*) receiverNode->getLinkedData();
+    const glm::vec3& receiverPosition = receiverData->getBroadcastPosition();
+    int broadcastNumber = receiverData->getNumBroadcastsReceived();
+    receiverData->incrementNumBroadcastsReceived();
+    
+    avatarGrid.findNearbyAvatars(receiverPosition, MAX_AVATAR_BROADCAST_DISTANCE, _nearbyAvatars);
+    
+    for (int i = 0; i < _nearbyAvatars.size(); i++) {
+        Node* node = _nearbyAvatars[i];
+        if (node == receiverNode) {
+            continue;
+        }
+        
+        AvatarMixerNodeData* nodeData = (AvatarMixerNodeData*) node->getLinkedData();
+        float distance = glm::distance(receiverPosition, nodeData->getBroadcastPosition());
+        
+        // the reduced rate avatars are spread out over the interval by their IDs, so each broadcast gets a share of them
+        bool isReducedRateTurn = (broadcastNumber + node->getNodeID()) % REDUCED_RATE_BROADCAST_INTERVAL == 0;
+        if (distance > FULL_RATE_AVATAR_BROADCAST_DISTANCE && !isReducedRateTurn) {
+            continue;
+        }
+        
+        bool isInView = receiverData->isInView(nodeData->getBroadcastPosition(), AVATAR_VIEW_RADIUS);
+        if (!isInView && !isReducedRateTurn) {
+            continue;
+        }
+        
+        AvatarToSend avatarToSend = { nodeData, isInView ? distance : distance * OUT_OF_VIEW_DISTANCE_SCALE };
+        _avatarsToSend.push_back(avatarToSend);
+    }
+    
+    if (_avatarsToSend.size() > MAX_AVATARS_PER_BROADCAST) {
+        std::nth_element(_avatarsToSend.begin(), _avatarsToSend.begin() + MAX_AVATARS_PER_BROADCAST, _avatarsToSend.end(),
+                         avatarToSendComesFirst);
+        _avatarsToSend.resize(MAX_AVATARS_PER_BROADCAST);
+    }
+    std::sort(_avatarsToSend.begin(), _avatarsToSend.end(), avatarToSendComesFirst);
+}
+
+int AvatarBroadcaster::startPacket(unsigned char* broadcastPacket, const glm::vec3& origin) {
+    unsigned char* currentBufferPosition = broadcastPacket;
+    currentBufferPosition += populateTypeAndVersion(currentBufferPosition, PACKET_TYPE_BULK_AVATAR_DATA);
+    memcpy(currentBufferPosition, &origin, BULK_AVATAR_DATA_ORIGIN_BYTES);
+    currentBufferPosition += BULK_AVATAR_DATA_ORIGIN_BYTES;
+    return currentBufferPosition - broadcastPacket;
+}
+
+void AvatarBroadcaster::sendAvatars(sockaddr* address, const glm::vec3& origin, AvatarMixerNodeData* receiverData,
+                                    int tick, int maxBroadcastBytes) {
+    UDPSocket* nodeSocket = NodeList::getInstance()->getNodeSocket();
+    int packetsQueued = 0;
+    
+    unsigned char* broadcastPacket = _packetBuffers[packetsQueued];
+    int packetLength = startPacket(broadcastPacket, origin);
+    int broadcastBytes = 0;
+    int numPacketsSent = 0;
+    int numBytesSent = 0;
+    
+    // each avatar's data is already serialized, so it's just copied in along with its position
+    for (int i = 0; i < _avatarsToSend.size(); i++) {
+        AvatarMixerNodeData* nodeData = _avatarsToSend[i].nodeData;
+        AvatarBroadcastHistory* history = receiverData
+            ? &receiverData->getBroadcastHistory(nodeData->getOwningNode()->getNodeID(), tick)
+            : NULL;
+        bool isKeyframe = !history || history->needsKeyframe(tick);
+        int maxAvatarDataLength = nodeData->getMaxBroadcastRecordLength(isKeyframe);
+        
+        if (broadcastBytes + maxAvatarDataLength > maxBroadcastBytes) {
+            // the rest are further away, they'll have to wait
+            break;
+        }
+        
+        if (maxAvatarDataLength + packetLength > MAX_PACKET_SIZE) {
+            // this packet is full, queue it up
+            _packets[packetsQueued].address = address;
+            _packets[packetsQueued].data = broadcastPacket;
+            _packets[packetsQueued].byteLength = packetLength;
+            packetsQueued++;
+            numPacketsSent++;
+            numBytesSent += packetLength;
+            
+            if (packetsQueued == MAX_BATCH_PACKETS) {
+                nodeSocket->sendBatch(_packets, packetsQueued);
+                packetsQueued = 0;
+            }
+            
+            // start the next packet
+            broadcastPacket = _packetBuffers[packetsQueued];
+            packetLength = startPacket(broadcastPacket, origin);
+        }
+        
+        int avatarDataLength = nodeData->packBroadcastRecord(broadcastPacket + packetLength, origin, isKeyframe);
+        packetLength += avatarDataLength;
+        broadcastBytes += avatarDataLength;
+        
+        if (history) {
+            history->recordBroadcast(tick);
+        }
+    }
+    
+    _packets[packetsQueued].address = address;
+    _packets[packetsQueued].data = broadcastPacket;
+    _packets[packetsQueued].byteLength = packetLength;
+    packetsQueued++;
+    nodeSocket->sendBatch(_packets, packetsQueued);
+    
+    _packetsSentMetric->add(numPacketsSent + 1);
+    _bytesSentMetric->add(numBytesSent + packetLength);
+}
+
+AvatarBroadcasterPool::AvatarBroadcasterPool(int numThreads) :
+    TickWorkerPool(numThreads),
+    _broadcastTick(0),
+    _receivers(NULL)
+{
+    for (int i = 0; i < getNumThreads(); i++) {
+        _broadcasters.push_back(new AvatarBroadcaster());
+    }
+}
+
+AvatarBroadcasterPool::~AvatarBroadcasterPool() {
+    for (int i = 0; i < _broadcasters.size(); i++) {
+        delete _broadcasters[i];
+    }
+}
+
+void AvatarBroadcasterPool::broadcastTick(const std::vector<Node*>& avatars, int tick) {
+    // with grid cells as big as the furthest an avatar is sent, a receiver only needs to look in its own cell and the
+    // ones around it
+    _avatarGrid.build(avatars, MAX_AVATAR_BROADCAST_DISTANCE);
+    
+    _broadcastTick = tick;
+    _receivers = &avatars;
+    runTick(avatars.size());
+}
+
+void AvatarBroadcasterPool::broadcastToAddress(sockaddr* address, const std::vector<Node*>& avatars) {
+    _broadcasters[0]->broadcastToAddress(address, avatars);
+}
+
+void AvatarBroadcasterPool::workItem(int threadIndex, int itemIndex) {
+    _broadcasters[threadIndex]->broadcastToReceiver((*_receivers)[itemIndex], _avatarGrid, _broadcastTick);
+}
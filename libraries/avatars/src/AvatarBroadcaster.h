@@ -0,0 +1,108 @@
+//
+//  AvatarBroadcaster.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  Builds and sends the avatar data each receiver gets, split across a pool of broadcasting threads.
+//
+
+#ifndef __hifi__AvatarBroadcaster__
+#define __hifi__AvatarBroadcaster__
+
+#include <vector>
+
+#include <Metrics.h>
+#include <NodeList.h>
+#include <TickWorkerPool.h>
+#include <UDPSocket.h>
+
+#include "AvatarGrid.h"
+#include "AvatarMixerNodeData.h"
+
+/// Avatars further away than this from a receiver aren't sent to it at all
+const float MAX_AVATAR_BROADCAST_DISTANCE = 100.0f;
+
+/// Avatars further away than this from a receiver, or out of its view, are only sent every
+/// REDUCED_RATE_BROADCAST_INTERVAL broadcasts, which is as often as their changes are repeated so they still get them all
+const float FULL_RATE_AVATAR_BROADCAST_DISTANCE = 20.0f;
+const int REDUCED_RATE_BROADCAST_INTERVAL = AVATAR_CHANGE_REPEAT_TICKS;
+
+/// The most a receiver is sent in one broadcast, the closest avatars go first
+const int MAX_AVATARS_PER_BROADCAST = 64;
+const int MAX_BROADCAST_BYTES_PER_RECEIVER = 4 * MAX_PACKET_SIZE;
+
+struct AvatarToSend {
+    AvatarMixerNodeData* nodeData;
+    float priority; // lower goes first
+};
+
+/// Builds and sends the broadcast for one receiver at a time. Each broadcasting thread has its own, so they have their own
+/// packets to build the broadcasts in.
+class AvatarBroadcaster {
+public:
+    AvatarBroadcaster();
+    
+    /// Sends the avatars near a receiver to it for tick. Only the avatars' broadcast data is read, and the only state
+    /// changed is the receiver's own.
+    void broadcastToReceiver(Node* receiverNode, const AvatarGrid& avatarGrid, int tick);
+    
+    /// Sends every avatar to an address that isn't an avatar itself (like an injector), as keyframes since we don't
+    /// know what it's been sent before
+    void broadcastToAddress(sockaddr* address, const std::vector<Node*>& avatars);
+    
+private:
+    // intentionally not implemented
+    AvatarBroadcaster(const AvatarBroadcaster&);
+    AvatarBroadcaster& operator= (const AvatarBroadcaster&);
+    
+    /// Picks the avatars that go in this broadcast to the receiver, closest first
+    void findAvatarsToSend(Node* receiverNode, const AvatarGrid& avatarGrid);
+    
+    /// Writes the header and origin of a bulk avatar data packet, returning how long they are
+    int startPacket(unsigned char* broadcastPacket, const glm::vec3& origin);
+    
+    /// Packs the avatars picked for this broadcast into as many packets as they need, up to maxBroadcastBytes of them,
+    /// and sends them to address with their positions relative to origin. Only what's changed lately is sent of the
+    /// avatars the receiver's been sent recently, the rest are keyframes. With no receiver they're all keyframes.
+    void sendAvatars(sockaddr* address, const glm::vec3& origin, AvatarMixerNodeData* receiverData, int tick,
+                     int maxBroadcastBytes);
+    
+    std::vector<Node*> _nearbyAvatars;
+    std::vector<AvatarToSend> _avatarsToSend;
+    
+    // the packets for a receiver are built up and then sent together, MAX_BATCH_PACKETS at a time
+    unsigned char _packetBuffers[MAX_BATCH_PACKETS][MAX_PACKET_SIZE];
+    UDPBatchPacket _packets[MAX_BATCH_PACKETS];
+    
+    MetricCounter* _packetsSentMetric;
+    MetricCounter* _bytesSentMetric;
+};
+
+/// Sends a tick's broadcasts to all the avatars across numThreads threads, the calling thread being one of them, with a
+/// broadcaster each
+class AvatarBroadcasterPool : public TickWorkerPool {
+public:
+    AvatarBroadcasterPool(int numThreads);
+    ~AvatarBroadcasterPool();
+    
+    /// Sends this tick's broadcasts to every one of the avatars, returning once they've all been sent. The avatars need
+    /// their broadcast data updated for this tick.
+    void broadcastTick(const std::vector<Node*>& avatars, int tick);
+    
+    /// Sends every one of this tick's avatars to an address that isn't an avatar itself, from the calling thread
+    void broadcastToAddress(sockaddr* address, const std::vector<Node*>& avatars);
+    
+protected:
+    virtual void workItem(int threadIndex, int itemIndex);
+    
+private:
+    std::vector<AvatarBroadcaster*> _broadcasters; // one for each thread, by index
+    
+    int _broadcastTick;
+    const std::vector<Node*>* _receivers;
+    AvatarGrid _avatarGrid;
+};
+
+#endif /* defined(__hifi__AvatarBroadcaster__) */
@@ -41,6 +41,7 @@ AvatarData::AvatarData(Node* owningNode) :
     _wantDelta(true),
     _wantLowResMoving(true),
     _wantOcclusionCulling(true),
+    _wantCompression(true),
     _headData(NULL),
     _handData(NULL)
 {
@@ -103,9 +104,39 @@ void AvatarData::sendData() {
 int AvatarData::getBroadcastData(unsigned char* destinationBuffer) {
     unsigned char* bufferStart = destinationBuffer;
     
-    // TODO: DRY this up to a shared method
-    // that can pack any type given the number of bytes
-    // and return the number of bytes to push the pointer
+    // everything goes in, with the position as it is since there's no origin in a head data packet
+    uint16_t fields = ALL_AVATAR_FIELDS;
+    memcpy(destinationBuffer, &fields, sizeof(fields));
+    destinationBuffer += sizeof(fields);
+    
+    destinationBuffer += packAvatarPosition(destinationBuffer, _position, NULL, fields);
+    
+    for (int i = 1; i < NUM_AVATAR_FIELDS; i++) {
+        destinationBuffer += packBroadcastField(destinationBuffer, 1 << i);
+    }
+    
+    return destinationBuffer - bufferStart;
+}
+
+// Fixed point offsets are smaller than floats, and these are all within a few meters of the avatar, except the look at
+// position, which is left a long way to go
+static const int HAND_POSITION_RADIX = 10;
+static const int LOOK_AT_POSITION_RADIX = 6;
+static const int CAMERA_POSITION_RADIX = 8;
+static const int EYE_OFFSET_POSITION_RADIX = 10;
+
+// Scales an offset down, if it has to be, so it fits in fixed point at radix without wrapping around
+static int packClampedFloatVec3ToSignedTwoByteFixed(unsigned char* destBuffer, const glm::vec3& srcVector, int radix) {
+    const float MAX_FIXED_VALUE = (std::numeric_limits<int16_t>::max() >> radix) - 1;
+    float largestComponent = std::max(fabsf(srcVector.x), std::max(fabsf(srcVector.y), fabsf(srcVector.z)));
+    if (largestComponent > MAX_FIXED_VALUE) {
+        return packFloatVec3ToSignedTwoByteFixed(destBuffer, srcVector * (MAX_FIXED_VALUE / largestComponent), radix);
+    }
+    return packFloatVec3ToSignedTwoByteFixed(destBuffer, srcVector, radix);
+}
+
+int AvatarData::packBroadcastField(unsigned char* destinationBuffer, uint16_t field) {
+    unsigned char* bufferStart = destinationBuffer;
     
     // lazily allocate memory for HeadData in case we're not an Avatar instance
     if (!_headData) {
@@ -116,202 +147,258 @@ int AvatarData::getBroadcastData(unsigned char* destinationBuffer) {
         _handData = new HandData(this);
     }
     
-    // Body world position
-    memcpy(destinationBuffer, &_position, sizeof(float) * 3);
-    destinationBuffer += sizeof(float) * 3;
-    
-    // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyYaw);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyPitch);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyRoll);
-
-    // Body scale
-    destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _newScale);
-    
-    // Follow mode info
-    memcpy(destinationBuffer, &_leaderID, sizeof(uint16_t));
-    destinationBuffer += sizeof(uint16_t);
-
-    // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_yaw);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_pitch);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_roll);
-    
-    // Head lean X,Z (head lateral and fwd/back motion relative to torso)
-    memcpy(destinationBuffer, &_headData->_leanSideways, sizeof(_headData->_leanSideways));
-    destinationBuffer += sizeof(_headData->_leanSideways);
-    memcpy(destinationBuffer, &_headData->_leanForward, sizeof(_headData->_leanForward));
-    destinationBuffer += sizeof(_headData->_leanForward);
-
-    // Hand Position - is relative to body position
-    glm::vec3 handPositionRelative = _handPosition - _position;
-    memcpy(destinationBuffer, &handPositionRelative, sizeof(float) * 3);
-    destinationBuffer += sizeof(float) * 3;
-
-    // Lookat Position
-    memcpy(destinationBuffer, &_headData->_lookAtPosition, sizeof(_headData->_lookAtPosition));
-    destinationBuffer += sizeof(_headData->_lookAtPosition);
-     
-    // Instantaneous audio loudness (used to drive facial animation)
-    //destinationBuffer += packFloatToByte(destinationBuffer, std::min(MAX_AUDIO_LOUDNESS, _audioLoudness), MAX_AUDIO_LOUDNESS);
-    memcpy(destinationBuffer, &_headData->_audioLoudness, sizeof(float));
-    destinationBuffer += sizeof(float); 
-
-    // camera details
-    memcpy(destinationBuffer, &_cameraPosition, sizeof(_cameraPosition));
-    destinationBuffer += sizeof(_cameraPosition);
-    destinationBuffer += packOrientationQuatToBytes(destinationBuffer, _cameraOrientation);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _cameraFov);
-    destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _cameraAspectRatio);
-    destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraNearClip);
-    destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraFarClip);
-    memcpy(destinationBuffer, &_cameraEyeOffsetPosition, sizeof(_cameraEyeOffsetPosition));
-    destinationBuffer += sizeof(_cameraEyeOffsetPosition);
-
-    // chat message
-    *destinationBuffer++ = _chatMessage.size();
-    memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
-    destinationBuffer += _chatMessage.size() * sizeof(char);
-    
-    // bitMask of less than byte wide items
-    unsigned char bitItems = 0;
-    if (_wantLowResMoving)     { setAtBit(bitItems, WANT_LOW_RES_MOVING_BIT); }
-    if (_wantColor)            { setAtBit(bitItems, WANT_COLOR_AT_BIT); }
-    if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
-    if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
-
-    // key state
-    setSemiNibbleAt(bitItems,KEY_STATE_START_BIT,_keyState);
-    // hand state
-    setSemiNibbleAt(bitItems,HAND_STATE_START_BIT,_handState);
-    *destinationBuffer++ = bitItems;
-    
-    // leap hand data
-    destinationBuffer += _handData->encodeRemoteData(destinationBuffer);
-    
-    // skeleton joints
-    *destinationBuffer++ = (unsigned char)_joints.size();
-    for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
-        *destinationBuffer++ = (unsigned char)it->jointID;
-        destinationBuffer += packOrientationQuatToBytes(destinationBuffer, it->rotation);
+    switch (field) {
+        case AVATAR_BODY_FIELD:
+            // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyYaw);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyPitch);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyRoll);
+            
+            // Body scale
+            destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _newScale);
+            
+            // Follow mode info
+            memcpy(destinationBuffer, &_leaderID, sizeof(uint16_t));
+            destinationBuffer += sizeof(uint16_t);
+            break;
+        case AVATAR_HEAD_FIELD:
+            // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_yaw);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_pitch);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_roll);
+            
+            // Head lean X,Z (head lateral and fwd/back motion relative to torso), in degrees
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_leanSideways);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_leanForward);
+            break;
+        case AVATAR_HAND_POSITION_FIELD:
+            // Hand Position - is relative to body position
+            destinationBuffer += packClampedFloatVec3ToSignedTwoByteFixed(destinationBuffer, _handPosition - _position,
+                                                                          HAND_POSITION_RADIX);
+            break;
+        case AVATAR_LOOK_AT_FIELD:
+            // Lookat Position - is relative to body position
+            destinationBuffer += packClampedFloatVec3ToSignedTwoByteFixed(destinationBuffer,
+                                                                          _headData->_lookAtPosition - _position,
+                                                                          LOOK_AT_POSITION_RADIX);
+            break;
+        case AVATAR_AUDIO_LOUDNESS_FIELD:
+            // Instantaneous audio loudness (used to drive facial animation)
+            destinationBuffer += packFloatToByte(destinationBuffer,
+                                                 std::min(MAX_AUDIO_LOUDNESS, _headData->_audioLoudness),
+                                                 MAX_AUDIO_LOUDNESS);
+            break;
+        case AVATAR_CAMERA_FIELD:
+            // camera position is relative to body position
+            destinationBuffer += packClampedFloatVec3ToSignedTwoByteFixed(destinationBuffer, _cameraPosition - _position,
+                                                                          CAMERA_POSITION_RADIX);
+            destinationBuffer += packOrientationQuatToFourBytes(destinationBuffer, _cameraOrientation);
+            break;
+        case AVATAR_CAMERA_LENS_FIELD:
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _cameraFov);
+            destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _cameraAspectRatio);
+            destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraNearClip);
+            destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraFarClip);
+            destinationBuffer += packClampedFloatVec3ToSignedTwoByteFixed(destinationBuffer, _cameraEyeOffsetPosition,
+                                                                          EYE_OFFSET_POSITION_RADIX);
+            break;
+        case AVATAR_CHAT_MESSAGE_FIELD:
+            *destinationBuffer++ = _chatMessage.size();
+            memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
+            destinationBuffer += _chatMessage.size() * sizeof(char);
+            break;
+        case AVATAR_BIT_ITEMS_FIELD: {
+            // bitMask of less than byte wide items
+            unsigned char bitItems = 0;
+            if (_wantLowResMoving)     { setAtBit(bitItems, WANT_LOW_RES_MOVING_BIT); }
+            if (_wantColor)            { setAtBit(bitItems, WANT_COLOR_AT_BIT); }
+            if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
+            if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
+            
+            // key state
+            setSemiNibbleAt(bitItems,KEY_STATE_START_BIT,_keyState);
+            // hand state
+            setSemiNibbleAt(bitItems,HAND_STATE_START_BIT,_handState);
+            *destinationBuffer++ = bitItems;
+            
+            // more bit items, that didn't fit in the first byte
+            bitItems = 0;
+            if (_wantCompression)      { setAtBit(bitItems, WANT_COMPRESSION_BIT); }
+            *destinationBuffer++ = bitItems;
+            break;
+        }
+        case AVATAR_HAND_DATA_FIELD:
+            // leap hand data
+            destinationBuffer += _handData->encodeRemoteData(destinationBuffer);
+            break;
+        case AVATAR_JOINTS_FIELD:
+            // skeleton joints
+            *destinationBuffer++ = (unsigned char)_joints.size();
+            for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
+                *destinationBuffer++ = (unsigned char)it->jointID;
+                destinationBuffer += packOrientationQuatToFourBytes(destinationBuffer, it->rotation);
+            }
+            break;
     }
     
     return destinationBuffer - bufferStart;
 }
 
-// called on the other nodes - assigns it to my views of the others
 int AvatarData::parseData(unsigned char* sourceBuffer, int numBytes) {
+    return parseData(sourceBuffer, numBytes, numBytesForPacketHeader(sourceBuffer));
+}
 
-    // lazily allocate memory for HeadData in case we're not an Avatar instance
-    if (!_headData) {
-        _headData = new HeadData(this);
-    }
-    
-    // lazily allocate memory for HandData in case we're not an Avatar instance
-    if (!_handData) {
-        _handData = new HandData(this);
-    }
-    
-    // increment to push past the packet header
-    int numBytesPacketHeader = numBytesForPacketHeader(sourceBuffer);
-    sourceBuffer += numBytesPacketHeader;
+// called on the other nodes - assigns it to my views of the others
+int AvatarData::parseData(unsigned char* packetData, int numBytes, int offset) {
     
+    // the data's read straight out of the packet, whether it's our own packet or one record of a bulk packet
+    unsigned char* sourceBuffer = packetData + offset;
     unsigned char* startPosition = sourceBuffer;
     
     // push past the node ID
     sourceBuffer += sizeof(uint16_t);
     
-    // Body world position
-    memcpy(&_position, sourceBuffer, sizeof(float) * 3);
-    sourceBuffer += sizeof(float) * 3;
+    // the fields that are in this record, the rest haven't changed
+    uint16_t fields;
+    memcpy(&fields, sourceBuffer, sizeof(fields));
+    sourceBuffer += sizeof(fields);
     
-    // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyYaw);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyPitch);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyRoll);
-
-    // Body scale
-    sourceBuffer += unpackFloatRatioFromTwoByte(            sourceBuffer,  _newScale);
-
-    // Follow mode info
-    memcpy(&_leaderID, sourceBuffer, sizeof(uint16_t));
-    sourceBuffer += sizeof(uint16_t);
+    // Body world position, which the fields after it that are relative to it need first
+    if (fields & AVATAR_POSITION_FIELD) {
+        glm::vec3 origin(0, 0, 0);
+        if (fields & AVATAR_RELATIVE_POSITION_FLAG) {
+            // bulk avatar data packets start with the origin
+            memcpy(&origin, packetData + numBytesForPacketHeader(packetData), sizeof(origin));
+        }
+        sourceBuffer += unpackAvatarPosition(sourceBuffer, _position, origin, fields);
+    }
+    
+    for (int i = 1; i < NUM_AVATAR_FIELDS; i++) {
+        if (fields & (1 << i)) {
+            sourceBuffer += unpackBroadcastField(sourceBuffer, 1 << i);
+        }
+    }
+    
+    return sourceBuffer - startPosition;
+}
 
-    // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
-    float headYaw, headPitch, headRoll;
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headYaw);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headPitch);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headRoll);
-    
-    _headData->setYaw(headYaw);
-    _headData->setPitch(headPitch);
-    _headData->setRoll(headRoll);
-
-    //  Head position relative to pelvis
-    memcpy(&_headData->_leanSideways, sourceBuffer, sizeof(_headData->_leanSideways));
-    sourceBuffer += sizeof(float);
-    memcpy(&_headData->_leanForward, sourceBuffer, sizeof(_headData->_leanForward));
-    sourceBuffer += sizeof(_headData->_leanForward);
-
-    // Hand Position - is relative to body position
-    glm::vec3 handPositionRelative;
-    memcpy(&handPositionRelative, sourceBuffer, sizeof(float) * 3);
-    _handPosition = _position + handPositionRelative;
-    sourceBuffer += sizeof(float) * 3;
-
-    // Lookat Position
-    memcpy(&_headData->_lookAtPosition, sourceBuffer, sizeof(_headData->_lookAtPosition));
-    sourceBuffer += sizeof(_headData->_lookAtPosition);
-
-    // Instantaneous audio loudness (used to drive facial animation)
-    //sourceBuffer += unpackFloatFromByte(sourceBuffer, _audioLoudness, MAX_AUDIO_LOUDNESS);
-    memcpy(&_headData->_audioLoudness, sourceBuffer, sizeof(float));
-    sourceBuffer += sizeof(float);
-    
-    // camera details
-    memcpy(&_cameraPosition, sourceBuffer, sizeof(_cameraPosition));
-    sourceBuffer += sizeof(_cameraPosition);
-    sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, _cameraOrientation);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_cameraFov);
-    sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer,_cameraAspectRatio);
-    sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraNearClip);
-    sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraFarClip);
-    memcpy(&_cameraEyeOffsetPosition, sourceBuffer, sizeof(_cameraEyeOffsetPosition));
-    sourceBuffer += sizeof(_cameraEyeOffsetPosition);
-
-    // the rest is a chat message
-    int chatMessageSize = *sourceBuffer++;
-    _chatMessage = string((char*)sourceBuffer, chatMessageSize);
-    sourceBuffer += chatMessageSize * sizeof(char);
-
-    // voxel sending features...
-    unsigned char bitItems = 0;
-    bitItems = (unsigned char)*sourceBuffer++;
-    _wantLowResMoving     = oneAtBit(bitItems, WANT_LOW_RES_MOVING_BIT);
-    _wantColor            = oneAtBit(bitItems, WANT_COLOR_AT_BIT);
-    _wantDelta            = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
-    _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
-
-    // key state, stored as a semi-nibble in the bitItems
-    _keyState = (KeyState)getSemiNibbleAt(bitItems,KEY_STATE_START_BIT);
-
-    // hand state, stored as a semi-nibble in the bitItems
-    _handState = getSemiNibbleAt(bitItems,HAND_STATE_START_BIT);
-
-    // leap hand data
-    if (sourceBuffer - startPosition < numBytes) {
-        // check passed, bytes match
-        sourceBuffer += _handData->decodeRemoteData(sourceBuffer);
+int AvatarData::unpackBroadcastField(unsigned char* sourceBuffer, uint16_t field) {
+    unsigned char* startPosition = sourceBuffer;
+    
+    // lazily allocate memory for HeadData in case we're not an Avatar instance
+    if (!_headData) {
+        _headData = new HeadData(this);
+    }
+    
+    // lazily allocate memory for HandData in case we're not an Avatar instance
+    if (!_handData) {
+        _handData = new HandData(this);
     }
     
-    // skeleton joints
-    if (sourceBuffer - startPosition < numBytes) {
-        // check passed, bytes match
-        _joints.resize(*sourceBuffer++);
-        for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
-            it->jointID = *sourceBuffer++;
-            sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, it->rotation); 
+    switch (field) {
+        case AVATAR_BODY_FIELD:
+            // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyYaw);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyPitch);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyRoll);
+            
+            // Body scale
+            sourceBuffer += unpackFloatRatioFromTwoByte(            sourceBuffer,  _newScale);
+            
+            // Follow mode info
+            memcpy(&_leaderID, sourceBuffer, sizeof(uint16_t));
+            sourceBuffer += sizeof(uint16_t);
+            break;
+        case AVATAR_HEAD_FIELD: {
+            // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
+            float headYaw, headPitch, headRoll;
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headYaw);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headPitch);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headRoll);
+            
+            _headData->setYaw(headYaw);
+            _headData->setPitch(headPitch);
+            _headData->setRoll(headRoll);
+            
+            //  Head position relative to pelvis
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_headData->_leanSideways);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_headData->_leanForward);
+            break;
+        }
+        case AVATAR_HAND_POSITION_FIELD: {
+            // Hand Position - is relative to body position
+            glm::vec3 handPositionRelative;
+            sourceBuffer += unpackFloatVec3FromSignedTwoByteFixed(sourceBuffer, handPositionRelative, HAND_POSITION_RADIX);
+            _handPosition = _position + handPositionRelative;
+            break;
+        }
+        case AVATAR_LOOK_AT_FIELD: {
+            // Lookat Position - is relative to body position
+            glm::vec3 lookAtPositionRelative;
+            sourceBuffer += unpackFloatVec3FromSignedTwoByteFixed(sourceBuffer, lookAtPositionRelative,
+                                                                  LOOK_AT_POSITION_RADIX);
+            _headData->_lookAtPosition = _position + lookAtPositionRelative;
+            break;
+        }
+        case AVATAR_AUDIO_LOUDNESS_FIELD:
+            // Instantaneous audio loudness (used to drive facial animation)
+            sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_audioLoudness, MAX_AUDIO_LOUDNESS);
+            break;
+        case AVATAR_CAMERA_FIELD: {
+            // camera position is relative to body position
+            glm::vec3 cameraPositionRelative;
+            sourceBuffer += unpackFloatVec3FromSignedTwoByteFixed(sourceBuffer, cameraPositionRelative,
+                                                                  CAMERA_POSITION_RADIX);
+            _cameraPosition = _position + cameraPositionRelative;
+            sourceBuffer += unpackOrientationQuatFromFourBytes(sourceBuffer, _cameraOrientation);
+            break;
+        }
+        case AVATAR_CAMERA_LENS_FIELD:
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_cameraFov);
+            sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer,_cameraAspectRatio);
+            sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraNearClip);
+            sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraFarClip);
+            sourceBuffer += unpackFloatVec3FromSignedTwoByteFixed(sourceBuffer, _cameraEyeOffsetPosition,
+                                                                  EYE_OFFSET_POSITION_RADIX);
+            break;
+        case AVATAR_CHAT_MESSAGE_FIELD: {
+            int chatMessageSize = *sourceBuffer++;
+            _chatMessage = string((char*)sourceBuffer, chatMessageSize);
+            sourceBuffer += chatMessageSize * sizeof(char);
+            break;
         }
+        case AVATAR_BIT_ITEMS_FIELD: {
+            // voxel sending features...
+            unsigned char bitItems = 0;
+            bitItems = (unsigned char)*sourceBuffer++;
+            _wantLowResMoving     = oneAtBit(bitItems, WANT_LOW_RES_MOVING_BIT);
+            _wantColor            = oneAtBit(bitItems, WANT_COLOR_AT_BIT);
+            _wantDelta            = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
+            _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
+            
+            // key state, stored as a semi-nibble in the bitItems
+            _keyState = (KeyState)getSemiNibbleAt(bitItems,KEY_STATE_START_BIT);
+            
+            // hand state, stored as a semi-nibble in the bitItems
+            _handState = getSemiNibbleAt(bitItems,HAND_STATE_START_BIT);
+            
+            // more voxel sending features
+            bitItems = (unsigned char)*sourceBuffer++;
+            _wantCompression      = oneAtBit(bitItems, WANT_COMPRESSION_BIT);
+            break;
+        }
+        case AVATAR_HAND_DATA_FIELD:
+            // leap hand data
+            sourceBuffer += _handData->decodeRemoteData(sourceBuffer);
+            break;
+        case AVATAR_JOINTS_FIELD:
+            // skeleton joints
+            _joints.resize(*sourceBuffer++);
+            for (vector<JointData>::iterator it = _joints.begin(); it != _joints.end(); it++) {
+                it->jointID = *sourceBuffer++;
+                sourceBuffer += unpackOrientationQuatFromFourBytes(sourceBuffer, it->rotation);
+            }
+            break;
     }
     
     return sourceBuffer - startPosition;
@@ -390,6 +477,91 @@ int unpackOrientationQuatFromBytes(unsigned char* buffer, glm::quat& quatOutput)
     return sizeof(quatParts);
 }
 
+int packOrientationQuatToFourBytes(unsigned char* buffer, const glm::quat& quatInput) {
+    float components[4] = { quatInput.x, quatInput.y, quatInput.z, quatInput.w };
+    
+    int largestIndex = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+    
+    // flip the quat if we have to so the left out component is positive
+    const float SMALLEST_THREE_RANGE = sqrtf(0.5f);
+    const float CONVERSION_RATIO = 1023 / (2 * SMALLEST_THREE_RANGE);
+    float sign = (components[largestIndex] < 0.0f) ? -1.0f : 1.0f;
+    
+    uint32_t packedQuat = largestIndex;
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            float component = glm::clamp(sign * components[i], -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE);
+            packedQuat = (packedQuat << 10) | (uint32_t) floorf((component + SMALLEST_THREE_RANGE) * CONVERSION_RATIO + 0.5f);
+        }
+    }
+    
+    memcpy(buffer, &packedQuat, sizeof(packedQuat));
+    return sizeof(packedQuat);
+}
+
+int unpackOrientationQuatFromFourBytes(unsigned char* buffer, glm::quat& quatOutput) {
+    uint32_t packedQuat;
+    memcpy(&packedQuat, buffer, sizeof(packedQuat));
+    
+    const float SMALLEST_THREE_RANGE = sqrtf(0.5f);
+    const float CONVERSION_RATIO = (2 * SMALLEST_THREE_RANGE) / 1023;
+    int largestIndex = packedQuat >> 30;
+    
+    float components[4];
+    float sumOfSquares = 0.0f;
+    for (int i = 3; i >= 0; i--) {
+        if (i != largestIndex) {
+            components[i] = (packedQuat & 1023) * CONVERSION_RATIO - SMALLEST_THREE_RANGE;
+            sumOfSquares += components[i] * components[i];
+            packedQuat >>= 10;
+        }
+    }
+    components[largestIndex] = sqrtf(std::max(0.0f, 1.0f - sumOfSquares));
+    
+    quatOutput.x = components[0];
+    quatOutput.y = components[1];
+    quatOutput.z = components[2];
+    quatOutput.w = components[3];
+    
+    return sizeof(packedQuat);
+}
+
+const int RELATIVE_AVATAR_POSITION_RADIX = 8;
+
+int packAvatarPosition(unsigned char* buffer, const glm::vec3& position, const glm::vec3* origin, uint16_t& fields) {
+    if (origin) {
+        const float MAX_RELATIVE_POSITION = (std::numeric_limits<int16_t>::max() >> RELATIVE_AVATAR_POSITION_RADIX) - 1;
+        glm::vec3 relativePosition = position - *origin;
+        
+        if (fabsf(relativePosition.x) < MAX_RELATIVE_POSITION && fabsf(relativePosition.y) < MAX_RELATIVE_POSITION &&
+            fabsf(relativePosition.z) < MAX_RELATIVE_POSITION) {
+            fields |= AVATAR_RELATIVE_POSITION_FLAG;
+            return packFloatVec3ToSignedTwoByteFixed(buffer, relativePosition, RELATIVE_AVATAR_POSITION_RADIX);
+        }
+    }
+    
+    fields &= ~AVATAR_RELATIVE_POSITION_FLAG;
+    memcpy(buffer, &position, sizeof(float) * 3);
+    return sizeof(float) * 3;
+}
+
+int unpackAvatarPosition(unsigned char* buffer, glm::vec3& position, const glm::vec3& origin, uint16_t fields) {
+    if (fields & AVATAR_RELATIVE_POSITION_FLAG) {
+        glm::vec3 relativePosition;
+        int numBytes = unpackFloatVec3FromSignedTwoByteFixed(buffer, relativePosition, RELATIVE_AVATAR_POSITION_RADIX);
+        position = origin + relativePosition;
+        return numBytes;
+    }
+    
+    memcpy(&position, buffer, sizeof(float) * 3);
+    return sizeof(float) * 3;
+}
+
 float SMALL_LIMIT = 10.0;
 float LARGE_LIMIT = 1000.0;
 
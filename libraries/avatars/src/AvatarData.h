@@ -29,9 +29,30 @@ const int WANT_DELTA_AT_BIT = 2;
 const int KEY_STATE_START_BIT = 3;  // 4th and 5th bits
 const int HAND_STATE_START_BIT = 5; // 6th and 7th bits
 const int WANT_OCCLUSION_CULLING_BIT = 7; // 8th bit
+const int WANT_COMPRESSION_BIT = 0; // 1st bit of the second byte of bit items
 
 const float MAX_AUDIO_LOUDNESS = 1000.0; // close enough for mouth animation
 
+// The parts of an avatar's data a record can carry. Each record starts with a two byte mask of the ones that are in it,
+// in this order, and the ones left out keep the values they had.
+const uint16_t AVATAR_POSITION_FIELD = 1 << 0;
+const uint16_t AVATAR_BODY_FIELD = 1 << 1;          // body rotation, scale and leader
+const uint16_t AVATAR_HEAD_FIELD = 1 << 2;          // head rotation and lean
+const uint16_t AVATAR_HAND_POSITION_FIELD = 1 << 3;
+const uint16_t AVATAR_LOOK_AT_FIELD = 1 << 4;
+const uint16_t AVATAR_AUDIO_LOUDNESS_FIELD = 1 << 5;
+const uint16_t AVATAR_CAMERA_FIELD = 1 << 6;        // camera position and orientation
+const uint16_t AVATAR_CAMERA_LENS_FIELD = 1 << 7;   // field of view, aspect ratio, clip planes and eye offset
+const uint16_t AVATAR_CHAT_MESSAGE_FIELD = 1 << 8;
+const uint16_t AVATAR_BIT_ITEMS_FIELD = 1 << 9;
+const uint16_t AVATAR_HAND_DATA_FIELD = 1 << 10;
+const uint16_t AVATAR_JOINTS_FIELD = 1 << 11;
+const int NUM_AVATAR_FIELDS = 12;
+const uint16_t ALL_AVATAR_FIELDS = (1 << NUM_AVATAR_FIELDS) - 1;
+
+// set in the mask when the position is relative to the origin at the start of a bulk avatar data packet
+const uint16_t AVATAR_RELATIVE_POSITION_FLAG = 1 << 15;
+
 enum KeyState
 {
     NO_KEY_DOWN = 0,
@@ -65,8 +86,14 @@ public:
     void setHandPositionFromVariantMap(QVariantMap handPositionMap);
     QVariantMap getHandPositionVariantMap();
     
+    /// Packs a record with all of the avatar's data, minus the node ID that goes in front of it
     int getBroadcastData(unsigned char* destinationBuffer);
     int parseData(unsigned char* sourceBuffer, int numBytes);
+    virtual int parseData(unsigned char* packetData, int numBytes, int offset);
+    
+    /// Packs one of the fields of a record, other than the position
+    int packBroadcastField(unsigned char* destinationBuffer, uint16_t field);
+    int unpackBroadcastField(unsigned char* sourceBuffer, uint16_t field);
     
     //  Body Rotation
     float getBodyYaw() const { return _bodyYaw; }
@@ -116,6 +143,7 @@ public:
     bool getWantDelta() const { return _wantDelta; }
     bool getWantLowResMoving() const { return _wantLowResMoving; }
     bool getWantOcclusionCulling() const { return _wantOcclusionCulling; }
+    bool getWantCompression() const { return _wantCompression; }
     uint16_t getLeaderID() const { return _leaderID; }
     
     void setHeadData(HeadData* headData) { _headData = headData; }
@@ -127,6 +155,7 @@ public slots:
     void setWantColor(bool wantColor) { _wantColor = wantColor; }
     void setWantDelta(bool wantDelta) { _wantDelta = wantDelta; }
     void setWantOcclusionCulling(bool wantOcclusionCulling) { _wantOcclusionCulling = wantOcclusionCulling; }
+    void setWantCompression(bool wantCompression) { _wantCompression = wantCompression; }
     
 protected:
     glm::vec3 _position;
@@ -166,6 +195,7 @@ protected:
     bool _wantDelta;
     bool _wantLowResMoving;
     bool _wantOcclusionCulling;
+    bool _wantCompression;
     
     std::vector<JointData> _joints;
     
@@ -211,6 +241,17 @@ int unpackClipValueFromTwoByte(unsigned char* buffer, float& clipValue);
 int packFloatToByte(unsigned char* buffer, float value, float scaleBy);
 int unpackFloatFromByte(unsigned char* buffer, float& value, float scaleBy);
 
+// Unit quats always have a component of at least 1/sqrt(2) in size, so the largest can be left out and rebuilt from the
+// other three, which are then no bigger than 1/sqrt(2). With its sign dropped too (q and -q are the same rotation) a
+// quat fits in 32 bits: the index of the left out component and 10 bits for each of the others.
+int packOrientationQuatToFourBytes(unsigned char* buffer, const glm::quat& quatInput);
+int unpackOrientationQuatFromFourBytes(unsigned char* buffer, glm::quat& quatOutput);
+
+// Avatar positions near enough to an origin go as 8.8 fixed point offsets from it, setting AVATAR_RELATIVE_POSITION_FLAG
+// in fields, and the rest go as floats. A NULL origin always sends floats.
+int packAvatarPosition(unsigned char* buffer, const glm::vec3& position, const glm::vec3* origin, uint16_t& fields);
+int unpackAvatarPosition(unsigned char* buffer, glm::vec3& position, const glm::vec3& origin, uint16_t fields);
+
 // Allows sending of fixed-point numbers: radix 1 makes 15.1 number, radix 8 makes 8.8 number, etc
 int packFloatScalarToSignedTwoByteFixed(unsigned char* buffer, float scalar, int radix);
 int unpackFloatScalarFromSignedTwoByteFixed(int16_t* byteFixedPointer, float* destinationPointer, int radix);
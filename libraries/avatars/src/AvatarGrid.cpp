@@ -0,0 +1,48 @@
+//
+//  AvatarGrid.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The avatars being broadcast in a tick, bucketed by position.
+//
+
+#include "AvatarMixerNodeData.h"
+
+#include "AvatarGrid.h"
+
+// appends each avatar it visits that's within range of a position to a list of avatars
+class AvatarGrid::AppendAvatarInRange {
+public:
+    AppendAvatarInRange(const glm::vec3& position, float maxDistance, std::vector<Node*>& avatars) :
+        _position(position),
+        _maxDistanceSquared(maxDistance * maxDistance),
+        _avatars(avatars) { }
+    
+    void operator()(const GridAvatar& avatar) {
+        glm::vec3 offset = avatar.position - _position;
+        if (glm::dot(offset, offset) <= _maxDistanceSquared) {
+            _avatars.push_back(avatar.node);
+        }
+    }
+    
+private:
+    glm::vec3 _position;
+    float _maxDistanceSquared;
+    std::vector<Node*>& _avatars;
+};
+
+void AvatarGrid::build(const std::vector<Node*>& avatars, float cellSize) {
+    _cells.clear(cellSize);
+    
+    for (int i = 0; i < avatars.size(); i++) {
+        GridAvatar gridAvatar = { avatars[i], ((AvatarMixerNodeData*) avatars[i]->getLinkedData())->getBroadcastPosition() };
+        _cells.insert(gridAvatar.position, gridAvatar);
+    }
+}
+
+void AvatarGrid::findNearbyAvatars(const glm::vec3& position, float maxDistance, std::vector<Node*>& avatars) const {
+    AppendAvatarInRange appendAvatarInRange(position, maxDistance, avatars);
+    _cells.visitNearby(position, appendAvatarInRange);
+}
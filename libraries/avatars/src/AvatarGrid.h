@@ -0,0 +1,43 @@
+//
+//  AvatarGrid.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The avatars being broadcast in a tick, bucketed by position.
+//
+
+#ifndef __hifi__AvatarGrid__
+#define __hifi__AvatarGrid__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Node.h>
+#include <UniformGrid.h>
+
+/// Buckets the avatars into cubic cells, so a receiver only has to look at the avatars near enough to be sent to it. With
+/// cells as big as the furthest an avatar is sent, everything a receiver can be sent is in its own cell or the 26 around it.
+class AvatarGrid {
+public:
+    /// Buckets the avatars, by their broadcast positions, into cells cellSize on a side
+    void build(const std::vector<Node*>& avatars, float cellSize);
+    
+    /// Appends the avatars within maxDistance of position to avatars. maxDistance can't be more than the cell size.
+    void findNearbyAvatars(const glm::vec3& position, float maxDistance, std::vector<Node*>& avatars) const;
+    
+private:
+    // the position's kept alongside the node, so the ones that are too far away are skipped without going to the node
+    struct GridAvatar {
+        Node* node;
+        glm::vec3 position;
+    };
+    
+    class AppendAvatarInRange;
+    
+    UniformGrid<GridAvatar> _cells;
+};
+
+#endif /* defined(__hifi__AvatarGrid__) */
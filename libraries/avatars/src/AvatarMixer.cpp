@@ -8,82 +8,147 @@
 //  Original avatar-mixer main created by Leonardo Murillo on 03/25/13.
 //
 //  The avatar mixer receives head, hand and positional data from all connected
-//  nodes, and broadcasts that data back to them, every BROADCAST_INTERVAL ms.
+//  nodes, and every broadcast tick sends each one the data of the avatars near it.
+
+#include <map>
+#include <pthread.h>
+#include <vector>
+
+#include <QtCore/QThread>
 
 #include <Logging.h>
+#include <Metrics.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 
-#include "AvatarData.h"
+#include "AvatarBroadcaster.h"
+#include "AvatarMixerNodeData.h"
 
 #include "AvatarMixer.h"
 
 const char AVATAR_MIXER_LOGGING_NAME[] = "avatar-mixer";
 
-unsigned char* addNodeToBroadcastPacket(unsigned char *currentPosition, Node *nodeToAdd) {
-    currentPosition += packNodeId(currentPosition, nodeToAdd->getNodeID());
-    
-    AvatarData *nodeData = (AvatarData *)nodeToAdd->getLinkedData();
-    currentPosition += nodeData->getBroadcastData(currentPosition);
-    
-    return currentPosition;
-}
-
 void attachAvatarDataToNode(Node* newNode) {
     if (newNode->getLinkedData() == NULL) {
-        newNode->setLinkedData(new AvatarData(newNode));
+        newNode->setLinkedData(new AvatarMixerNodeData(newNode));
     }
 }
 
-// NOTE: some additional optimizations to consider.
-//    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
-//       if the avatar is not in view or in the keyhole.
-//    2) after culling for view frustum, sort order the avatars by distance, send the closest ones first.
-//    3) if we need to rate limit the amount of data we send, we can use a distance weighted "semi-random" function to
-//       determine which avatars are included in the packet stream
-//    4) we should optimize the avatar data format to be more compact (100 bytes is pretty wasteful).
-void broadcastAvatarData(NodeList* nodeList, sockaddr* nodeAddress) {
-    static unsigned char broadcastPacketBuffer[MAX_PACKET_SIZE];
-    static unsigned char avatarDataBuffer[MAX_PACKET_SIZE];
-    unsigned char* broadcastPacket = (unsigned char*)&broadcastPacketBuffer[0];
-    int numHeaderBytes = populateTypeAndVersion(broadcastPacket, PACKET_TYPE_BULK_AVATAR_DATA);
-    unsigned char* currentBufferPosition = broadcastPacket + numHeaderBytes;
-    int packetLength = currentBufferPosition - broadcastPacket;
-    int packetsSent = 0;
-    
-    // send back a packet with other active node data to this node
-    for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
-        if (node->getLinkedData() && !socketMatch(nodeAddress, node->getActiveSocket())) {
-            unsigned char* avatarDataEndpoint = addNodeToBroadcastPacket((unsigned char*)&avatarDataBuffer[0], &*node);
-            int avatarDataLength = avatarDataEndpoint - (unsigned char*)&avatarDataBuffer;
+// how often the broadcast thread sends its timing stats
+const uint64_t BROADCAST_STATS_INTERVAL_USECS = 1 * 1000000;
+
+bool broadcastThreadStopFlag = false;
+
+// injectors aren't avatars, so the receive thread hands their addresses over to be sent every avatar on the next tick.
+// They're keyed by address and port, so an injector that sent several packets since the last tick is only sent once.
+pthread_mutex_t injectorAddressesMutex = PTHREAD_MUTEX_INITIALIZER;
+std::map<uint64_t, sockaddr_in> injectorAddresses;
+
+uint64_t injectorAddressKey(const sockaddr_in* address) {
+    return ((uint64_t) address->sin_addr.s_addr << 16) | address->sin_port;
+}
+
+void* broadcastAvatarData(void* args) {
+    uint64_t broadcastIntervalUsecs = *(uint64_t*) args;
+    NodeList* nodeList = NodeList::getInstance();
+    
+    // every receiver's broadcast is independent of the others, so they're spread over a thread per core
+    AvatarBroadcasterPool broadcasterPool(QThread::idealThreadCount());
+    
+    std::vector<Node*> avatars;
+    std::map<uint64_t, sockaddr_in> tickInjectorAddresses;
+    
+    int nextTick = 0;
+    timeval startTime;
+    gettimeofday(&startTime, NULL);
+    
+    timeval beginTickTime, endTickTime;
+    uint64_t lastStatsSend = usecTimestampNow();
+    uint64_t sumTickUsecs = 0;
+    int numStatCollections = 0;
+    
+    MetricsRegistry* metrics = MetricsRegistry::getInstance();
+    MetricHistogram* tickUsecsMetric = metrics->getHistogram("avatar_mixer_broadcast_tick_usecs",
+                                                             "Time taken by each broadcast tick, in usecs");
+    MetricGauge* avatarsMetric = metrics->getGauge("avatar_mixer_avatars", "Avatars broadcast in the last tick");
+    
+    // if we'll be sending stats, call the Logstash::socket() method to make it load the logstash IP outside the loop
+    if (Logging::shouldSendStats()) {
+        Logging::socket();
+    }
+    
+    while (!broadcastThreadStopFlag) {
+        gettimeofday(&beginTickTime, NULL);
+        
+        // take this tick's copy of each avatar, the receive thread can keep updating them while the broadcasts go out
+        avatars.clear();
+        for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
+            node->lock();
+            
+            AvatarMixerNodeData* nodeData = (AvatarMixerNodeData*) node->getLinkedData();
+            if (nodeData && node->getActiveSocket()) {
+                nodeData->updateBroadcastData(nextTick);
+                
+                if (nodeData->hasBroadcastData()) {
+                    avatars.push_back(&*node);
+                }
+            }
+            
+            node->unlock();
+        }
+        
+        broadcasterPool.broadcastTick(avatars, nextTick);
+        
+        pthread_mutex_lock(&injectorAddressesMutex);
+        tickInjectorAddresses.swap(injectorAddresses);
+        pthread_mutex_unlock(&injectorAddressesMutex);
+        
+        for (std::map<uint64_t, sockaddr_in>::iterator injectorAddress = tickInjectorAddresses.begin();
+             injectorAddress != tickInjectorAddresses.end(); injectorAddress++) {
+            broadcasterPool.broadcastToAddress((sockaddr*) &injectorAddress->second, avatars);
+        }
+        tickInjectorAddresses.clear();
+        
+        gettimeofday(&endTickTime, NULL);
+        uint64_t tickUsecs = usecTimestamp(&endTickTime) - usecTimestamp(&beginTickTime);
+        
+        tickUsecsMetric->record(tickUsecs);
+        avatarsMetric->set(avatars.size());
+        
+        if (Logging::shouldSendStats()) {
+            sumTickUsecs += tickUsecs;
+            numStatCollections++;
             
-            if (avatarDataLength + packetLength <= MAX_PACKET_SIZE) {
-                memcpy(currentBufferPosition, &avatarDataBuffer[0], avatarDataLength);
-                packetLength += avatarDataLength;
-                currentBufferPosition += avatarDataLength;
-            } else {
-                packetsSent++;
-                //printf("packetsSent=%d packetLength=%d\n", packetsSent, packetLength);
-                nodeList->getNodeSocket()->send(nodeAddress, broadcastPacket, currentBufferPosition - broadcastPacket);
+            if (usecTimestamp(&endTickTime) - lastStatsSend >= BROADCAST_STATS_INTERVAL_USECS) {
+                // how long a broadcast tick takes, and how much of the interval that is
+                const char BROADCAST_TIME_LOGSTASH_METRIC_NAME[] = "avatar-mixer-broadcast-usecs";
+                const char BROADCAST_TIME_USAGE_LOGSTASH_METRIC_NAME[] = "avatar-mixer-broadcast-time-usage";
                 
-                // reset the packet
-                currentBufferPosition = broadcastPacket + numHeaderBytes;
-                packetLength = currentBufferPosition - broadcastPacket;
+                float averageTickUsecs = (float) sumTickUsecs / numStatCollections;
+                Logging::stashValue(STAT_TYPE_TIMER, BROADCAST_TIME_LOGSTASH_METRIC_NAME, averageTickUsecs);
+                Logging::stashValue(STAT_TYPE_TIMER, BROADCAST_TIME_USAGE_LOGSTASH_METRIC_NAME,
+                                    (averageTickUsecs / broadcastIntervalUsecs) * 100.0f);
                 
-                // copy the avatar that didn't fit into the next packet
-                memcpy(currentBufferPosition, &avatarDataBuffer[0], avatarDataLength);
-                packetLength += avatarDataLength;
-                currentBufferPosition += avatarDataLength;
+                lastStatsSend = usecTimestamp(&endTickTime);
+                sumTickUsecs = 0;
+                numStatCollections = 0;
             }
         }
+        
+        int usecToSleep = usecTimestamp(&startTime) + (++nextTick * broadcastIntervalUsecs) - usecTimestampNow();
+        
+        if (usecToSleep > 0) {
+            usleep(usecToSleep);
+        } else {
+            qDebug("Broadcast tick took %llu usecs, not sleeping!\n", (unsigned long long) tickUsecs);
+        }
     }
-    packetsSent++;
-    //printf("packetsSent=%d packetLength=%d\n", packetsSent, packetLength);
-    nodeList->getNodeSocket()->send(nodeAddress, broadcastPacket, currentBufferPosition - broadcastPacket);
+    
+    return NULL;
 }
 
-void AvatarMixer::run() {
+void AvatarMixer::run(int broadcastIntervalMsecs) {
     // change the logging target name while AvatarMixer is running
     Logging::setTargetName(AVATAR_MIXER_LOGGING_NAME);
     
@@ -102,10 +167,23 @@ void AvatarMixer::run() {
     uint16_t nodeID = 0;
     Node* avatarNode = NULL;
     
+    UDPBatchPacket forwardPackets[MAX_BATCH_PACKETS];
+    int packetsToForward = 0;
+    
+    MetricCounter* receivedPacketsMetric = MetricsRegistry::getInstance()->getCounter(
+        "avatar_mixer_received_packets_total", "Packets pulled off the network");
+    
     timeval lastDomainServerCheckIn = {};
     // we only need to hear back about avatar nodes from the DS
     nodeList->setNodeTypesOfInterest(&NODE_TYPE_AGENT, 1);
     
+    // this thread only takes in updates, the broadcasts go out from their own thread at a fixed rate however fast the
+    // updates come in
+    uint64_t broadcastIntervalUsecs = broadcastIntervalMsecs * 1000;
+    broadcastThreadStopFlag = false;
+    pthread_t broadcastThread;
+    pthread_create(&broadcastThread, NULL, broadcastAvatarData, (void*) &broadcastIntervalUsecs);
+    
     while (true) {
         
         if (NodeList::getInstance()->getNumNoReplyDomainCheckIns() == MAX_SILENT_DOMAIN_SERVER_CHECK_INS) {
@@ -120,6 +198,8 @@ void AvatarMixer::run() {
         
         if (nodeList->getNodeSocket()->receive(nodeAddress, packetData, &receivedBytes) &&
             packetVersionMatch(packetData)) {
+            receivedPacketsMetric->add();
+            
             switch (packetData[0]) {
                 case PACKET_TYPE_HEAD_DATA:
                     // grab the node ID from the packet
@@ -130,8 +210,11 @@ void AvatarMixer::run() {
                     
                     // parse positional data from an node
                     nodeList->updateNodeWithData(avatarNode, packetData, receivedBytes);
+                    break;
                 case PACKET_TYPE_INJECT_AUDIO:
-                    broadcastAvatarData(nodeList, nodeAddress);
+                    pthread_mutex_lock(&injectorAddressesMutex);
+                    injectorAddresses[injectorAddressKey((sockaddr_in*) nodeAddress)] = *(sockaddr_in*) nodeAddress;
+                    pthread_mutex_unlock(&injectorAddressesMutex);
                     break;
                 case PACKET_TYPE_AVATAR_VOXEL_URL:
                 case PACKET_TYPE_AVATAR_FACE_VIDEO:
@@ -141,9 +224,20 @@ void AvatarMixer::run() {
                     // let everyone else know about the update
                     for (NodeList::iterator node = nodeList->begin(); node != nodeList->end(); node++) {
                         if (node->getActiveSocket() && node->getNodeID() != nodeID) {
-                            nodeList->getNodeSocket()->send(node->getActiveSocket(), packetData, receivedBytes);
+                            forwardPackets[packetsToForward].address = node->getActiveSocket();
+                            forwardPackets[packetsToForward].data = packetData;
+                            forwardPackets[packetsToForward].byteLength = receivedBytes;
+                            
+                            if (++packetsToForward == MAX_BATCH_PACKETS) {
+                                nodeList->getNodeSocket()->sendBatch(forwardPackets, packetsToForward);
+                                packetsToForward = 0;
+                            }
                         }
                     }
+                    if (packetsToForward > 0) {
+                        nodeList->getNodeSocket()->sendBatch(forwardPackets, packetsToForward);
+                        packetsToForward = 0;
+                    }
                     break;
                 default:
                     // hand this off to the NodeList
@@ -153,5 +247,8 @@ void AvatarMixer::run() {
         }
     }
     
+    broadcastThreadStopFlag = true;
+    pthread_join(broadcastThread, NULL);
+    
     nodeList->stopSilentNodeRemovalThread();
 }
\ No newline at end of file
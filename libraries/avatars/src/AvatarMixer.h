@@ -11,11 +11,14 @@
 
 #include <iostream>
 
+/// How often each client is sent the avatars around it, unless the mixer's run with something else
+const int DEFAULT_AVATAR_BROADCAST_INTERVAL_MSECS = 16;
+
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer {
 public:
-    /// runs the avatar mixer
-    static void run();
+    /// runs the avatar mixer, broadcasting every broadcastIntervalMsecs
+    static void run(int broadcastIntervalMsecs = DEFAULT_AVATAR_BROADCAST_INTERVAL_MSECS);
 };
 
 #endif /* defined(__hifi__AvatarMixer__) */
@@ -0,0 +1,181 @@
+//
+//  AvatarMixerNodeData.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The avatar mixer's data for each avatar, along with the avatar's serialized broadcast data
+//
+
+#include <cstring>
+
+#include <Node.h>
+
+#include "AvatarMixerNodeData.h"
+
+// moves smaller than this aren't worth sending, they're about the precision of a relative position
+const float BROADCAST_POSITION_CHANGE_THRESHOLD = 1.0f / 256.0f;
+
+AvatarMixerNodeData::AvatarMixerNodeData(Node* owningNode) :
+    AvatarData(owningNode),
+    _hasNewData(false),
+    _hasBroadcastData(false),
+    _changedFields(0),
+    _broadcastPosition(0, 0, 0),
+    _hasViewFrustum(false),
+    _numBroadcastsReceived(0)
+{
+    for (int i = 0; i < NUM_AVATAR_FIELDS; i++) {
+        _fieldChangeTicks[i] = -AVATAR_CHANGE_REPEAT_TICKS;
+    }
+    _viewFrustum.calculate();
+}
+
+int AvatarMixerNodeData::parseData(unsigned char* packetData, int numBytes, int offset) {
+    int numParsedBytes = AvatarData::parseData(packetData, numBytes, offset);
+
+    // it's packed up for broadcasting on the next tick, however many updates arrive before then
+    _hasNewData = true;
+
+    return numParsedBytes;
+}
+
+void AvatarMixerNodeData::updateBroadcastData(int tick) {
+    bool hasChanged = false;
+
+    if (_hasNewData) {
+        _hasNewData = false;
+
+        if (!_hasBroadcastData || glm::distance(_position, _broadcastPosition) > BROADCAST_POSITION_CHANGE_THRESHOLD) {
+            _broadcastPosition = _position;
+            _fieldChangeTicks[0] = tick;
+            hasChanged = true;
+        }
+
+        // serialize once here, rather than once for every client the avatar's sent to, and compare the packed fields
+        // so changes too small to make it into a packet don't count
+        unsigned char packedField[MAX_PACKET_SIZE];
+        for (int i = 1; i < NUM_AVATAR_FIELDS; i++) {
+            int packedFieldLength = packBroadcastField(packedField, 1 << i);
+            std::vector<unsigned char>& lastPackedField = _packedFields[i];
+
+            if (!_hasBroadcastData || packedFieldLength != lastPackedField.size()
+                || memcmp(packedField, &lastPackedField[0], packedFieldLength) != 0) {
+                lastPackedField.assign(packedField, packedField + packedFieldLength);
+                _fieldChangeTicks[i] = tick;
+                hasChanged = true;
+            }
+        }
+        _hasBroadcastData = true;
+
+        // get position and orientation details from the camera
+        ViewFrustum newestViewFrustum;
+        newestViewFrustum.setPosition(getCameraPosition());
+        newestViewFrustum.setOrientation(getCameraOrientation());
+        newestViewFrustum.setFieldOfView(getCameraFov());
+        newestViewFrustum.setAspectRatio(getCameraAspectRatio());
+        newestViewFrustum.setNearClip(getCameraNearClip());
+        newestViewFrustum.setFarClip(getCameraFarClip());
+        newestViewFrustum.setEyeOffsetPosition(getCameraEyeOffsetPosition());
+
+        // only recalculate the planes if the camera's moved
+        if (!newestViewFrustum.matches(_viewFrustum)) {
+            _viewFrustum = newestViewFrustum;
+            _viewFrustum.calculate();
+        }
+        _hasViewFrustum = getCameraFov() > 0.0f;
+    }
+
+    // changes drop out of the records once they've been repeated enough
+    uint16_t changedFields = 0;
+    for (int i = 0; i < NUM_AVATAR_FIELDS; i++) {
+        if (tick - _fieldChangeTicks[i] < AVATAR_CHANGE_REPEAT_TICKS) {
+            changedFields |= 1 << i;
+        }
+    }
+
+    if (hasChanged || changedFields != _changedFields) {
+        _changedFields = changedFields;
+        _changedFieldData.clear();
+        _allFieldData.clear();
+
+        for (int i = 1; i < NUM_AVATAR_FIELDS; i++) {
+            _allFieldData.insert(_allFieldData.end(), _packedFields[i].begin(), _packedFields[i].end());
+            if (_changedFields & (1 << i)) {
+                _changedFieldData.insert(_changedFieldData.end(), _packedFields[i].begin(), _packedFields[i].end());
+            }
+        }
+    }
+}
+
+int AvatarMixerNodeData::packBroadcastRecord(unsigned char* destinationBuffer, const glm::vec3& origin,
+                                             bool isKeyframe) const {
+    unsigned char* bufferStart = destinationBuffer;
+    destinationBuffer += packNodeId(destinationBuffer, _owningNode->getNodeID());
+
+    // the mask goes in once we know if the position's relative
+    uint16_t fields = isKeyframe ? ALL_AVATAR_FIELDS : _changedFields;
+    unsigned char* fieldsPosition = destinationBuffer;
+    destinationBuffer += sizeof(fields);
+
+    if (fields & AVATAR_POSITION_FIELD) {
+        destinationBuffer += packAvatarPosition(destinationBuffer, _broadcastPosition, &origin, fields);
+    }
+    memcpy(fieldsPosition, &fields, sizeof(fields));
+
+    const std::vector<unsigned char>& fieldData = isKeyframe ? _allFieldData : _changedFieldData;
+    if (!fieldData.empty()) {
+        memcpy(destinationBuffer, &fieldData[0], fieldData.size());
+        destinationBuffer += fieldData.size();
+    }
+
+    return destinationBuffer - bufferStart;
+}
+
+int AvatarMixerNodeData::getMaxBroadcastRecordLength(bool isKeyframe) const {
+    // node ID, mask and a position as floats, the most it can take up
+    return sizeof(uint16_t) + sizeof(uint16_t) + sizeof(float) * 3
+        + (isKeyframe ? _allFieldData.size() : _changedFieldData.size());
+}
+
+bool AvatarMixerNodeData::isInView(const glm::vec3& position, float radius) const {
+    // clients that haven't told us about their camera get everything treated as in view
+    return !_hasViewFrustum || _viewFrustum.sphereInFrustum(position, radius) != ViewFrustum::OUTSIDE;
+}
+
+AvatarBroadcastHistory& AvatarMixerNodeData::getBroadcastHistory(uint16_t avatarID, int tick) {
+    QHash<uint16_t, AvatarBroadcastHistory>::iterator history = _broadcastHistories.find(avatarID);
+    if (history == _broadcastHistories.end()) {
+        // it's never been sent, so it needs a keyframe, and after that the keyframes that come due are spread out by
+        // avatar, so the ones that show up together don't keep coming due together
+        AvatarBroadcastHistory newHistory = { tick - AVATAR_CHANGE_REPEAT_TICKS - 1,
+                                              tick - avatarID % AVATAR_KEYFRAME_INTERVAL_TICKS };
+        history = _broadcastHistories.insert(avatarID, newHistory);
+    }
+    return *history;
+}
+
+void AvatarMixerNodeData::pruneBroadcastHistories(int tick) {
+    QHash<uint16_t, AvatarBroadcastHistory>::iterator history = _broadcastHistories.begin();
+    while (history != _broadcastHistories.end()) {
+        if (tick - history->lastSentTick > AVATAR_CHANGE_REPEAT_TICKS) {
+            history = _broadcastHistories.erase(history);
+        } else {
+            history++;
+        }
+    }
+}
+
+bool AvatarBroadcastHistory::needsKeyframe(int tick) const {
+    return tick - lastSentTick > AVATAR_CHANGE_REPEAT_TICKS || tick - lastKeyframeTick >= AVATAR_KEYFRAME_INTERVAL_TICKS;
+}
+
+void AvatarBroadcastHistory::recordBroadcast(int tick) {
+    // keyframes sent because changes were missed don't put off the next one that's due, so the avatars' keyframes stay
+    // spread out
+    if (tick - lastKeyframeTick >= AVATAR_KEYFRAME_INTERVAL_TICKS) {
+        lastKeyframeTick = tick;
+    }
+    lastSentTick = tick;
+}
@@ -0,0 +1,106 @@
+//
+//  AvatarMixerNodeData.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
+//
+//  The avatar mixer's data for each avatar, along with the avatar's serialized broadcast data
+//
+
+#ifndef __hifi__AvatarMixerNodeData__
+#define __hifi__AvatarMixerNodeData__
+
+#include <vector>
+
+#include <QtCore/QHash>
+
+#include <NodeList.h>
+#include <ViewFrustum.h>
+
+#include "AvatarData.h"
+
+/// A change to an avatar goes out in every broadcast for this many ticks after it's made, so a receiver sent the avatar
+/// at least this often gets all of its changes, and one lost packet doesn't lose any
+const int AVATAR_CHANGE_REPEAT_TICKS = 4;
+
+/// Receivers are sent everything about an avatar at least this often, in case they've lost some of its changes
+const int AVATAR_KEYFRAME_INTERVAL_TICKS = 64;
+
+/// When an avatar was last sent to a receiver
+struct AvatarBroadcastHistory {
+    int lastSentTick;
+    int lastKeyframeTick;
+    
+    /// Whether the avatar has to go as a keyframe on tick, because it hasn't been sent recently enough for its changes
+    /// to be enough, or it's due one
+    bool needsKeyframe(int tick) const;
+    void recordBroadcast(int tick);
+};
+
+/// Avatar data that keeps its broadcast data packed and ready to go, so the mixer can copy it straight into every bulk
+/// avatar data packet it sends. The receiving thread parses new data as it arrives, and once a broadcast tick the
+/// broadcasting thread takes a copy of what it needs with updateBroadcastData(): the packed fields, which of them have
+/// changed lately, and where the avatar is and what it can see for deciding which other avatars to send to it.
+/// Everything a broadcast reads comes from that copy, so the avatar can keep changing while broadcasts go out.
+class AvatarMixerNodeData : public AvatarData {
+public:
+    AvatarMixerNodeData(Node* owningNode);
+
+    int parseData(unsigned char* packetData, int numBytes, int offset);
+
+    /// Packs the fields of the avatar's data that have changed, if any has arrived since the last call, and copies its
+    /// position and view for this tick's broadcasts. Call with the owning node locked, on every tick.
+    void updateBroadcastData(int tick);
+
+    /// False until data's first been parsed
+    bool hasBroadcastData() const { return _hasBroadcastData; }
+
+    /// Packs the avatar's record for a broadcast, with its position relative to origin. A keyframe has all the fields,
+    /// otherwise there's only the ones changed in the last AVATAR_CHANGE_REPEAT_TICKS ticks.
+    int packBroadcastRecord(unsigned char* destinationBuffer, const glm::vec3& origin, bool isKeyframe) const;
+    int getMaxBroadcastRecordLength(bool isKeyframe) const;
+
+    const glm::vec3& getBroadcastPosition() const { return _broadcastPosition; }
+
+    /// True if a sphere at position is in this avatar's camera's view, or if we don't know what the camera can see yet
+    bool isInView(const glm::vec3& position, float radius) const;
+
+    /// The number of broadcasts sent to this avatar, for spreading out the ones sent at a reduced rate
+    int getNumBroadcastsReceived() const { return _numBroadcastsReceived; }
+    void incrementNumBroadcastsReceived() { _numBroadcastsReceived++; }
+
+    /// When another avatar was last sent to this one, starting a history that needs a keyframe if it hasn't been
+    AvatarBroadcastHistory& getBroadcastHistory(uint16_t avatarID, int tick);
+
+    /// Forgets the avatars that haven't been sent to this one lately, they'll need keyframes anyway
+    void pruneBroadcastHistories(int tick);
+
+private:
+    // intentionally not implemented
+    AvatarMixerNodeData(const AvatarMixerNodeData&);
+    AvatarMixerNodeData& operator= (const AvatarMixerNodeData&);
+
+    bool _hasNewData;
+    bool _hasBroadcastData;
+
+    // each field as it was last packed (there's no packed position, it's packed for each packet's origin), and the tick
+    // it last changed on
+    std::vector<unsigned char> _packedFields[NUM_AVATAR_FIELDS];
+    int _fieldChangeTicks[NUM_AVATAR_FIELDS];
+
+    // the fields that go in this tick's records, and all of them for keyframes, packed one after the other
+    uint16_t _changedFields;
+    std::vector<unsigned char> _changedFieldData;
+    std::vector<unsigned char> _allFieldData;
+
+    glm::vec3 _broadcastPosition;
+    ViewFrustum _viewFrustum;
+    bool _hasViewFrustum;
+    int _numBroadcastsReceived;
+
+    // when the other avatars were last sent to this one, only touched by the thread sending to this one
+    QHash<uint16_t, AvatarBroadcastHistory> _broadcastHistories;
+};
+
+#endif /* defined(__hifi__AvatarMixerNodeData__) */
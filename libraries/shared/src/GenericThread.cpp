@@ -8,17 +8,25 @@
 //  Generic Threaded or non-threaded processing class
 //
 
+#include <sys/time.h>
+#include <unistd.h>
+
 #include "GenericThread.h"
 
 GenericThread::GenericThread() :
+    _isWakePending(false),
     _stopThread(false),
     _isThreaded(false) // assume non-threaded, must call initialize()
 {
     pthread_mutex_init(&_mutex, 0);
+    pthread_mutex_init(&_wakeMutex, 0);
+    pthread_cond_init(&_wakeCondition, 0);
 }
 
 GenericThread::~GenericThread() {
     terminate();
+    pthread_cond_destroy(&_wakeCondition);
+    pthread_mutex_destroy(&_wakeMutex);
     pthread_mutex_destroy(&_mutex);
 }
 
@@ -32,6 +40,7 @@ void GenericThread::initialize(bool isThreaded) {
 void GenericThread::terminate() {
     if (_isThreaded) {
         _stopThread = true;
+        wakeUp(); // in case it's waiting for work
         pthread_join(_thread, NULL); 
         _isThreaded = false;
     }
@@ -58,6 +67,43 @@ void* GenericThread::threadRoutine() {
     return NULL; 
 }
 
+void GenericThread::wakeUp() {
+    pthread_mutex_lock(&_wakeMutex);
+    _isWakePending = true;
+    pthread_cond_signal(&_wakeCondition);
+    pthread_mutex_unlock(&_wakeMutex);
+}
+
+void GenericThread::waitForWork(uint64_t timeoutUsecs) {
+    if (!_isThreaded) {
+        if (timeoutUsecs != WAIT_UNTIL_WOKEN) {
+            usleep(timeoutUsecs);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&_wakeMutex);
+    if (timeoutUsecs == WAIT_UNTIL_WOKEN) {
+        while (!_isWakePending && !_stopThread) {
+            pthread_cond_wait(&_wakeCondition, &_wakeMutex);
+        }
+    } else {
+        timeval now;
+        gettimeofday(&now, NULL);
+        uint64_t wakeTime = (uint64_t)now.tv_sec * 1000000 + now.tv_usec + timeoutUsecs;
+        timespec wakeTimeSpec = { (time_t)(wakeTime / 1000000), (long)(wakeTime % 1000000) * 1000 };
+
+        while (!_isWakePending && !_stopThread) {
+            if (pthread_cond_timedwait(&_wakeCondition, &_wakeMutex, &wakeTimeSpec) != 0) {
+                break; // timed out
+            }
+        }
+    }
+    // whatever woke us up is taken care of by the process() call after this
+    _isWakePending = false;
+    pthread_mutex_unlock(&_wakeMutex);
+}
+
 extern "C" void* GenericThreadEntry(void* arg) {
     GenericThread* genericThread = (GenericThread*)arg;
     return genericThread->threadRoutine();
@@ -12,6 +12,10 @@
 #define __shared__GenericThread__
 
 #include <pthread.h>
+#include <stdint.h>
+
+/// Timeout for GenericThread::waitForWork() that waits for as long as it takes to be woken up
+const uint64_t WAIT_UNTIL_WOKEN = 0;
 
 /// A basic generic "thread" class. Handles a single thread of control within the application. Can operate in non-threaded
 /// mode but caller must regularly call threadRoutine() method.
@@ -33,7 +37,16 @@ public:
     /// Override this function to do whatever your class actually does, return false to exit thread early.
     virtual bool process() = 0;
 
+    /// Wakes the thread up if it's waiting in waitForWork(), or keeps its next waitForWork() from waiting. Call this
+    /// whenever you give the thread something to do.
+    /// \thread any thread
+    void wakeUp();
+
 protected:
+    /// Call from process() when there's nothing to do. In threaded mode this blocks until wakeUp() is called, the thread
+    /// is terminated, or timeoutUsecs passes, if it's not WAIT_UNTIL_WOKEN. In non-threaded mode nothing can wake us up
+    /// while we wait, so this just sleeps for timeoutUsecs, and returns right away if there isn't one.
+    void waitForWork(uint64_t timeoutUsecs = WAIT_UNTIL_WOKEN);
 
     /// Locks all the resources of the thread.
     void lock() { pthread_mutex_lock(&_mutex); }
@@ -42,10 +55,16 @@ protected:
     void unlock() { pthread_mutex_unlock(&_mutex); }
     
     bool isStillRunning() const { return !_stopThread; }
+
+    bool isThreaded() const { return _isThreaded; }
     
 private:
     pthread_mutex_t _mutex;
 
+    pthread_mutex_t _wakeMutex;
+    pthread_cond_t _wakeCondition;
+    bool _isWakePending;
+
     bool        _stopThread;
     bool        _isThreaded;
     pthread_t   _thread;
@@ -0,0 +1,262 @@
+//
+//  Metrics.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Counters, gauges and latency histograms that any thread can update without locking, kept in one registry
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdlib.h>
+
+#include "SharedUtil.h"
+
+#include "Metrics.h"
+
+static pthread_once_t metricShardKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t metricShardKey;
+static int nextMetricShard = 0;
+
+static void createMetricShardKey() {
+    pthread_key_create(&metricShardKey, NULL);
+}
+
+int currentMetricShard() {
+    pthread_once(&metricShardKeyOnce, createMetricShardKey);
+
+    // the key holds the shard plus one, so a thread that hasn't been handed one yet reads NULL
+    intptr_t shardPlusOne = (intptr_t) pthread_getspecific(metricShardKey);
+    if (shardPlusOne == 0) {
+        shardPlusOne = __sync_fetch_and_add(&nextMetricShard, 1) % NUM_METRIC_SHARDS + 1;
+        pthread_setspecific(metricShardKey, (void*) shardPlusOne);
+    }
+    return shardPlusOne - 1;
+}
+
+void* allocateMetric(size_t size) {
+    void* metric;
+    if (posix_memalign(&metric, METRIC_CACHE_LINE_BYTES, size) != 0) {
+        throw std::bad_alloc();
+    }
+    return metric;
+}
+
+void freeMetric(void* metric) {
+    free(metric);
+}
+
+MetricCounter::MetricCounter() {
+    memset(_shards, 0, sizeof(_shards));
+}
+
+uint64_t MetricCounter::getValue() const {
+    uint64_t value = 0;
+    for (int i = 0; i < NUM_METRIC_SHARDS; i++) {
+        value += _shards[i].value;
+    }
+    return value;
+}
+
+MetricGauge::MetricGauge() {
+    set(0.0);
+}
+
+void MetricGauge::set(double value) {
+    int64_t valueBits;
+    memcpy(&valueBits, &value, sizeof(value));
+    __sync_lock_test_and_set(&_valueBits, valueBits);
+}
+
+double MetricGauge::getValue() const {
+    int64_t valueBits = __sync_fetch_and_add(const_cast<int64_t*>(&_valueBits), 0);
+    double value;
+    memcpy(&value, &valueBits, sizeof(value));
+    return value;
+}
+
+MetricHistogram::MetricHistogram() {
+    memset(_shards, 0, sizeof(_shards));
+}
+
+void MetricHistogram::record(uint64_t value) {
+    Shard& shard = _shards[currentMetricShard()];
+    __sync_fetch_and_add(&shard.bucketCounts[bucketForValue(value)], 1);
+    __sync_fetch_and_add(&shard.sum, value);
+}
+
+int MetricHistogram::bucketForValue(uint64_t value) {
+    const uint64_t MAX_VALUE = (1ULL << HISTOGRAM_MAX_VALUE_BITS) - 1;
+    const int SUB_BUCKETS = 1 << (HISTOGRAM_SUB_BUCKET_BITS - 1);
+
+    if (value < (1 << HISTOGRAM_SUB_BUCKET_BITS)) {
+        return value;
+    }
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    // shift off all but the top HISTOGRAM_SUB_BUCKET_BITS bits, which pick the bucket within the value's power of two
+    int shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BUCKET_BITS + 1;
+    return shift * SUB_BUCKETS + (value >> shift);
+}
+
+uint64_t MetricHistogram::highestValueInBucket(int bucket) {
+    const int SUB_BUCKETS = 1 << (HISTOGRAM_SUB_BUCKET_BITS - 1);
+
+    if (bucket < (1 << HISTOGRAM_SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t topBits = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((topBits + 1) << shift) - 1;
+}
+
+void MetricHistogram::getPercentiles(const float* percentiles, int numPercentiles, uint64_t* values,
+                                     uint64_t& count, uint64_t& sum) const {
+    static uint64_t bucketCounts[NUM_HISTOGRAM_BUCKETS];
+    static pthread_mutex_t bucketCountsMutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&bucketCountsMutex);
+
+    memset(bucketCounts, 0, sizeof(bucketCounts));
+    count = 0;
+    sum = 0;
+    for (int i = 0; i < NUM_METRIC_SHARDS; i++) {
+        for (int j = 0; j < NUM_HISTOGRAM_BUCKETS; j++) {
+            bucketCounts[j] += _shards[i].bucketCounts[j];
+        }
+        sum += _shards[i].sum;
+    }
+    for (int j = 0; j < NUM_HISTOGRAM_BUCKETS; j++) {
+        count += bucketCounts[j];
+    }
+
+    for (int i = 0; i < numPercentiles; i++) {
+        values[i] = 0;
+        if (count == 0) {
+            continue;
+        }
+        uint64_t rank = std::max((uint64_t) ceil(percentiles[i] * count), (uint64_t) 1);
+        uint64_t seen = 0;
+        for (int j = 0; j < NUM_HISTOGRAM_BUCKETS; j++) {
+            seen += bucketCounts[j];
+            if (seen >= rank) {
+                values[i] = highestValueInBucket(j);
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&bucketCountsMutex);
+}
+
+MetricTimer::MetricTimer(MetricHistogram* histogram) :
+    _histogram(histogram),
+    _start(usecTimestampNow())
+{
+}
+
+MetricTimer::~MetricTimer() {
+    _histogram->record(usecTimestampNow() - _start);
+}
+
+MetricsRegistry* MetricsRegistry::getInstance() {
+    // never deleted, so threads still updating metrics while the process exits don't touch a destroyed registry
+    static MetricsRegistry* instance = new MetricsRegistry();
+    return instance;
+}
+
+MetricsRegistry::MetricsRegistry() {
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+template<class Metric>
+Metric* MetricsRegistry::getMetric(std::map<std::string, std::pair<Metric*, std::string> >& metrics,
+                                   const char* name, const char* help) {
+    // scrapers only take letters, digits, underscores and colons in names
+    std::string metricName(name);
+    for (size_t i = 0; i < metricName.size(); i++) {
+        char c = metricName[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9' && i > 0) || c == ':')) {
+            metricName[i] = '_';
+        }
+    }
+
+    pthread_mutex_lock(&_mutex);
+    std::pair<Metric*, std::string>& metric = metrics[metricName];
+    if (!metric.first) {
+        metric.first = new Metric();
+        metric.second = help;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return metric.first;
+}
+
+MetricCounter* MetricsRegistry::getCounter(const char* name, const char* help) {
+    return getMetric(_counters, name, help);
+}
+
+MetricGauge* MetricsRegistry::getGauge(const char* name, const char* help) {
+    return getMetric(_gauges, name, help);
+}
+
+MetricHistogram* MetricsRegistry::getHistogram(const char* name, const char* help) {
+    return getMetric(_histograms, name, help);
+}
+
+static void writeMetricHeader(std::string& text, const std::string& name, const std::string& help, const char* type) {
+    text += "# HELP " + name + " " + help + "\n";
+    text += "# TYPE " + name + " " + type + "\n";
+}
+
+void MetricsRegistry::writeText(std::string& text) {
+    const float PERCENTILES[] = { 0.5f, 0.9f, 0.99f, 0.999f };
+    const char* PERCENTILE_LABELS[] = { "0.5", "0.9", "0.99", "0.999" };
+    const int NUM_PERCENTILES = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+    const int MAX_METRIC_LINE_LENGTH = 256;
+    char line[MAX_METRIC_LINE_LENGTH];
+
+    // the maps only ever grow, and the metrics in them are never deleted, so they can be read without the lock once
+    // we've taken a copy
+    pthread_mutex_lock(&_mutex);
+    std::map<std::string, std::pair<MetricCounter*, std::string> > counters(_counters);
+    std::map<std::string, std::pair<MetricGauge*, std::string> > gauges(_gauges);
+    std::map<std::string, std::pair<MetricHistogram*, std::string> > histograms(_histograms);
+    pthread_mutex_unlock(&_mutex);
+
+    for (std::map<std::string, std::pair<MetricCounter*, std::string> >::iterator counter = counters.begin();
+         counter != counters.end(); counter++) {
+        writeMetricHeader(text, counter->first, counter->second.second, "counter");
+        snprintf(line, sizeof(line), "%s %llu\n", counter->first.c_str(),
+                 (unsigned long long) counter->second.first->getValue());
+        text += line;
+    }
+
+    for (std::map<std::string, std::pair<MetricGauge*, std::string> >::iterator gauge = gauges.begin();
+         gauge != gauges.end(); gauge++) {
+        writeMetricHeader(text, gauge->first, gauge->second.second, "gauge");
+        snprintf(line, sizeof(line), "%s %g\n", gauge->first.c_str(), gauge->second.first->getValue());
+        text += line;
+    }
+
+    for (std::map<std::string, std::pair<MetricHistogram*, std::string> >::iterator histogram = histograms.begin();
+         histogram != histograms.end(); histogram++) {
+        uint64_t values[NUM_PERCENTILES];
+        uint64_t count, sum;
+        histogram->second.first->getPercentiles(PERCENTILES, NUM_PERCENTILES, values, count, sum);
+
+        writeMetricHeader(text, histogram->first, histogram->second.second, "summary");
+        for (int i = 0; i < NUM_PERCENTILES; i++) {
+            snprintf(line, sizeof(line), "%s{quantile=\"%s\"} %llu\n", histogram->first.c_str(), PERCENTILE_LABELS[i],
+                     (unsigned long long) values[i]);
+            text += line;
+        }
+        snprintf(line, sizeof(line), "%s_sum %llu\n%s_count %llu\n", histogram->first.c_str(), (unsigned long long) sum,
+                 histogram->first.c_str(), (unsigned long long) count);
+        text += line;
+    }
+}
@@ -0,0 +1,158 @@
+//
+//  Metrics.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Counters, gauges and latency histograms that any thread can update without locking, kept in one registry
+//
+
+#ifndef __shared__Metrics__
+#define __shared__Metrics__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+
+/// Counters and histograms are split into this many shards, and each thread updates the one it's handed, so threads
+/// updating the same metric don't fight over its cache lines. Threads past this many share shards. Each shard starts on
+/// a cache line of its own, so counters and histograms are allocated on cache line boundaries.
+const int NUM_METRIC_SHARDS = 8;
+const int METRIC_CACHE_LINE_BYTES = 64;
+
+/// The shard the calling thread updates
+int currentMetricShard();
+
+/// Allocates and frees memory starting on a cache line boundary, for metrics that are split into shards
+void* allocateMetric(size_t size);
+void freeMetric(void* metric);
+
+/// A count that only goes up, like packets or bytes sent. Rates come from how fast it goes up between scrapes.
+class MetricCounter {
+public:
+    MetricCounter();
+
+    static void* operator new(size_t size) { return allocateMetric(size); }
+    static void operator delete(void* metric) { freeMetric(metric); }
+
+    /// \thread any thread
+    void add(uint64_t amount = 1) { __sync_fetch_and_add(&_shards[currentMetricShard()].value, amount); }
+
+    uint64_t getValue() const;
+
+private:
+    // intentionally not implemented
+    MetricCounter(const MetricCounter&);
+    MetricCounter& operator= (const MetricCounter&);
+
+    struct Shard {
+        uint64_t value;
+    } __attribute__((aligned(METRIC_CACHE_LINE_BYTES)));
+    Shard _shards[NUM_METRIC_SHARDS];
+};
+
+/// A value that goes up and down, like a queue depth. The last value set wins.
+class MetricGauge {
+public:
+    MetricGauge();
+
+    /// \thread any thread
+    void set(double value);
+
+    double getValue() const;
+
+private:
+    // intentionally not implemented
+    MetricGauge(const MetricGauge&);
+    MetricGauge& operator= (const MetricGauge&);
+
+    int64_t _valueBits; // the double's bits, so it can be swapped in atomically
+};
+
+/// Values below 2^HISTOGRAM_SUB_BUCKET_BITS are counted exactly, above that each power of two is split into
+/// 2^(HISTOGRAM_SUB_BUCKET_BITS - 1) buckets, so a value's bucket is within about 3% of it
+const int HISTOGRAM_SUB_BUCKET_BITS = 6;
+const int HISTOGRAM_MAX_VALUE_BITS = 32; // bigger values are counted as the biggest
+const int NUM_HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2)
+                                  << (HISTOGRAM_SUB_BUCKET_BITS - 1);
+
+/// HDR style histogram of values like latencies in usecs, with log-linear buckets so percentiles come out to within a
+/// few percent over the whole range, from a fixed amount of memory and without sorting anything
+class MetricHistogram {
+public:
+    MetricHistogram();
+
+    static void* operator new(size_t size) { return allocateMetric(size); }
+    static void operator delete(void* metric) { freeMetric(metric); }
+
+    /// \thread any thread
+    void record(uint64_t value);
+
+    /// Merges the shards and finds the value at each of the percentiles (between 0 and 1), along with the number and
+    /// sum of the values recorded
+    void getPercentiles(const float* percentiles, int numPercentiles, uint64_t* values,
+                        uint64_t& count, uint64_t& sum) const;
+
+    static int bucketForValue(uint64_t value);
+
+    /// The largest value that goes in a bucket
+    static uint64_t highestValueInBucket(int bucket);
+
+private:
+    // intentionally not implemented
+    MetricHistogram(const MetricHistogram&);
+    MetricHistogram& operator= (const MetricHistogram&);
+
+    struct Shard {
+        uint64_t bucketCounts[NUM_HISTOGRAM_BUCKETS];
+        uint64_t sum;
+    } __attribute__((aligned(METRIC_CACHE_LINE_BYTES)));
+    Shard _shards[NUM_METRIC_SHARDS];
+};
+
+/// Records how long it's alive in usecs into a histogram
+class MetricTimer {
+public:
+    MetricTimer(MetricHistogram* histogram);
+    ~MetricTimer();
+
+private:
+    MetricHistogram* _histogram;
+    uint64_t _start;
+};
+
+/// All of a process's metrics, by name. Metrics are created the first time they're asked for and live as long as the
+/// process, so callers can look them up once and keep the pointer. Looking one up takes a lock, updating one doesn't.
+class MetricsRegistry {
+public:
+    static MetricsRegistry* getInstance();
+
+    /// \thread any thread
+    MetricCounter* getCounter(const char* name, const char* help);
+    MetricGauge* getGauge(const char* name, const char* help);
+    MetricHistogram* getHistogram(const char* name, const char* help);
+
+    /// Appends every metric to text in the Prometheus text format, histograms as summaries of their percentiles
+    /// \thread any thread
+    void writeText(std::string& text);
+
+private:
+    MetricsRegistry();
+
+    // intentionally not implemented
+    MetricsRegistry(const MetricsRegistry&);
+    MetricsRegistry& operator= (const MetricsRegistry&);
+
+    template<class Metric> Metric* getMetric(std::map<std::string, std::pair<Metric*, std::string> >& metrics,
+                                             const char* name, const char* help);
+
+    pthread_mutex_t _mutex;
+    std::map<std::string, std::pair<MetricCounter*, std::string> > _counters;
+    std::map<std::string, std::pair<MetricGauge*, std::string> > _gauges;
+    std::map<std::string, std::pair<MetricHistogram*, std::string> > _histograms;
+};
+
+#endif // __shared__Metrics__
@@ -0,0 +1,140 @@
+//
+//  MetricsServer.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Tiny HTTP listener that hands the metrics registry out to scrapers
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include "Syssocket.h"
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+#include <QtCore/QDebug>
+
+#include "Metrics.h"
+#include "MetricsServer.h"
+
+const int MAX_METRICS_REQUEST_BYTES = 4096;
+const int METRICS_REQUEST_TIMEOUT_SECS = 1;
+
+// a scraper hanging up on us mid response shouldn't take the whole server down with a SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int METRICS_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int METRICS_SEND_FLAGS = 0;
+#endif
+
+MetricsServer::MetricsServer(unsigned short port) :
+    _port(port),
+    _listenSocket(-1)
+{
+}
+
+MetricsServer::~MetricsServer() {
+    terminate();
+    if (_listenSocket != -1) {
+        close(_listenSocket);
+    }
+}
+
+bool MetricsServer::start() {
+    _listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenSocket == -1) {
+        qDebug("Failed to create metrics socket.\n");
+        return false;
+    }
+
+    int reuseAddress = 1;
+    setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+    sockaddr_in bindAddress;
+    memset(&bindAddress, 0, sizeof(bindAddress));
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bindAddress.sin_port = htons(_port);
+
+    if (bind(_listenSocket, (sockaddr*) &bindAddress, sizeof(bindAddress)) == -1
+        || listen(_listenSocket, SOMAXCONN) == -1) {
+        qDebug("Failed to listen for metrics scrapers on port %d.\n", _port);
+        close(_listenSocket);
+        _listenSocket = -1;
+        return false;
+    }
+
+    qDebug("Serving metrics at http://127.0.0.1:%d/metrics\n", _port);
+    initialize();
+    return true;
+}
+
+bool MetricsServer::process() {
+    fd_set listenSockets;
+    FD_ZERO(&listenSockets);
+    FD_SET(_listenSocket, &listenSockets);
+
+    timeval timeout = { 0, METRICS_SERVER_ACCEPT_TIMEOUT_USECS };
+
+    if (select(_listenSocket + 1, &listenSockets, NULL, NULL, &timeout) > 0) {
+        int connection = accept(_listenSocket, NULL, NULL);
+        if (connection != -1) {
+            serveConnection(connection);
+            close(connection);
+        }
+    }
+    return isStillRunning();
+}
+
+void MetricsServer::serveConnection(int connection) {
+    // a scraper that never finishes its request shouldn't be able to hold up the ones behind it
+    timeval requestTimeout = { METRICS_REQUEST_TIMEOUT_SECS, 0 };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &requestTimeout, sizeof(requestTimeout));
+
+    // read up to the end of the request headers, there's nothing in them we need
+    char request[MAX_METRICS_REQUEST_BYTES + 1];
+    int requestBytes = 0;
+    while (requestBytes < MAX_METRICS_REQUEST_BYTES) {
+        ssize_t bytesRead = recv(connection, request + requestBytes, MAX_METRICS_REQUEST_BYTES - requestBytes, 0);
+        if (bytesRead <= 0) {
+            return;
+        }
+        requestBytes += bytesRead;
+        request[requestBytes] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            break;
+        }
+    }
+
+    std::string body;
+    MetricsRegistry::getInstance()->writeText(body);
+
+    const int MAX_RESPONSE_HEADER_LENGTH = 256;
+    char header[MAX_RESPONSE_HEADER_LENGTH];
+    int headerLength = snprintf(header, sizeof(header),
+                                "HTTP/1.0 200 OK\r\n"
+                                "Content-Type: text/plain; version=0.0.4\r\n"
+                                "Content-Length: %d\r\n"
+                                "Connection: close\r\n\r\n", (int) body.size());
+
+    std::string response(header, headerLength);
+    response += body;
+
+    for (size_t bytesSent = 0; bytesSent < response.size(); ) {
+        ssize_t sent = send(connection, response.data() + bytesSent, response.size() - bytesSent, METRICS_SEND_FLAGS);
+        if (sent <= 0) {
+            return;
+        }
+        bytesSent += sent;
+    }
+}
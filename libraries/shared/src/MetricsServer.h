@@ -0,0 +1,42 @@
+//
+//  MetricsServer.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Tiny HTTP listener that hands the metrics registry out to scrapers
+//
+
+#ifndef __shared__MetricsServer__
+#define __shared__MetricsServer__
+
+#include "GenericThread.h"
+
+/// How long the listener waits for a scraper before checking whether it's been terminated
+const int METRICS_SERVER_ACCEPT_TIMEOUT_USECS = 100 * 1000;
+
+/// Answers every HTTP request on its port with the text of MetricsRegistry, one connection at a time. It only listens
+/// on the loopback interface, so the metrics are for a scraper running on the same box.
+class MetricsServer : public GenericThread {
+public:
+    MetricsServer(unsigned short port);
+    ~MetricsServer();
+
+    /// Starts listening and serving in a thread of its own, returns false if the port couldn't be bound
+    bool start();
+
+    virtual bool process();
+
+private:
+    // intentionally not implemented
+    MetricsServer(const MetricsServer&);
+    MetricsServer& operator= (const MetricsServer&);
+
+    void serveConnection(int connection);
+
+    unsigned short _port;
+    int _listenSocket;
+};
+
+#endif // __shared__MetricsServer__
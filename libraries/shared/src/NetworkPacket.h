@@ -40,6 +40,8 @@ public:
     const unsigned char* getData() const { return &_packetData[0]; }
 
 private:
+    friend class NetworkPacketQueue; // fills in its preallocated packets in place
+
     void copyContents(const sockaddr& address, const unsigned char*  packetData, ssize_t packetLength);
     
     sockaddr _address;
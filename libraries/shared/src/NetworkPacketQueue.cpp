@@ -0,0 +1,58 @@
+//
+//  NetworkPacketQueue.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  A bounded queue of network packets between one producing and one consuming thread
+//
+
+#include "NetworkPacketQueue.h"
+
+NetworkPacketQueue::NetworkPacketQueue(int capacity) :
+    _slots(new NetworkPacket[capacity + 1]),
+    _slotCount(capacity + 1),
+    _readIndex(0),
+    _writeIndex(0)
+{
+}
+
+NetworkPacketQueue::~NetworkPacketQueue() {
+    delete[] _slots;
+}
+
+bool NetworkPacketQueue::push(const sockaddr& address, const unsigned char* packetData, ssize_t packetLength) {
+    int writeIndex = _writeIndex.load();
+    int nextWriteIndex = (writeIndex + 1) % _slotCount;
+
+    // acquire, so we don't write into the slot until the consumer is done with it
+    if (nextWriteIndex == _readIndex.loadAcquire()) {
+        return false;
+    }
+    _slots[writeIndex].copyContents(address, packetData, packetLength);
+
+    // release, so the consumer sees the packet once it sees the slot
+    _writeIndex.storeRelease(nextWriteIndex);
+    return true;
+}
+
+NetworkPacket* NetworkPacketQueue::front() {
+    int readIndex = _readIndex.load();
+    if (readIndex == _writeIndex.loadAcquire()) {
+        return NULL;
+    }
+    return &_slots[readIndex];
+}
+
+void NetworkPacketQueue::pop() {
+    int readIndex = _readIndex.load();
+    if (readIndex != _writeIndex.loadAcquire()) {
+        _readIndex.storeRelease((readIndex + 1) % _slotCount);
+    }
+}
+
+int NetworkPacketQueue::size() const {
+    int packets = _writeIndex.load() - _readIndex.load();
+    return (packets < 0) ? packets + _slotCount : packets;
+}
@@ -0,0 +1,53 @@
+//
+//  NetworkPacketQueue.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  A bounded queue of network packets between one producing and one consuming thread
+//
+
+#ifndef __shared__NetworkPacketQueue__
+#define __shared__NetworkPacketQueue__
+
+#include <QtCore/QAtomicInt>
+
+#include "NetworkPacket.h"
+
+/// A fixed size ring of preallocated packet slots, for handing packets from one thread to another without locking or
+/// allocating. Only one thread may push() and only one thread may front() and pop(), though they can be the same thread.
+/// The consumer works on the packet in its slot, so the only copy is the producer's copy in.
+class NetworkPacketQueue {
+public:
+    NetworkPacketQueue(int capacity);
+    ~NetworkPacketQueue();
+
+    /// Copies a packet into the next free slot. Returns false, leaving the queue as it was, if the queue is full.
+    /// \thread the producing thread
+    bool push(const sockaddr& address, const unsigned char* packetData, ssize_t packetLength);
+
+    /// The oldest packet in the queue, or NULL if it's empty. The packet stays valid until pop() is called.
+    /// \thread the consuming thread
+    NetworkPacket* front();
+
+    /// Frees the slot of the oldest packet in the queue, for the producer to reuse.
+    /// \thread the consuming thread
+    void pop();
+
+    bool isEmpty() const { return _readIndex.load() == _writeIndex.load(); }
+    int size() const;
+    int getCapacity() const { return _slotCount - 1; }
+
+private:
+    // intentionally not implemented
+    NetworkPacketQueue(const NetworkPacketQueue&);
+    NetworkPacketQueue& operator= (const NetworkPacketQueue&);
+
+    NetworkPacket* _slots;
+    int _slotCount; // one more than the capacity, the slot before _readIndex is always free so full and empty differ
+    QAtomicInt _readIndex; // only changed by the consumer
+    QAtomicInt _writeIndex; // only changed by the producer
+};
+
+#endif // __shared__NetworkPacketQueue__
@@ -6,6 +6,8 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <QDebug>
+
 #include "NodeData.h"
 
 NodeData::NodeData(Node* owningNode) :
@@ -14,4 +16,10 @@ NodeData::NodeData(Node* owningNode) :
     
 }
 
-NodeData::~NodeData() {}
\ No newline at end of file
+NodeData::~NodeData() {}
+
+int NodeData::parseData(unsigned char* packetData, int numBytes, int offset) {
+    // only data that can be packed into a bulk packet knows how to be parsed from the middle of one
+    qDebug("NodeData::parseData() can't parse data at an offset, skipping the rest of the packet\n");
+    return numBytes - offset;
+}
@@ -21,6 +21,10 @@ public:
     virtual ~NodeData() = 0;
     virtual int parseData(unsigned char* sourceBuffer, int numBytes) = 0;
     
+    /// Parses data that starts offset bytes into a packet of numBytes, rather than just past the packet's header, like the
+    /// records packed into a bulk packet. Returns the number of bytes parsed from offset.
+    virtual int parseData(unsigned char* packetData, int numBytes, int offset);
+    
     Node* getOwningNode() { return _owningNode; }
 protected:
     Node* _owningNode;
@@ -7,6 +7,7 @@
 //
 
 #include <pthread.h>
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
@@ -59,18 +60,21 @@ NodeList* NodeList::getInstance() {
 }
 
 NodeList::NodeList(char newOwnerType, unsigned short int newSocketListenPort) :
-    _nodeBuckets(),
-    _numNodes(0),
+    _nodeSlots(new NodeSlots()),
     _nodeSocket(newSocketListenPort),
     _ownerType(newOwnerType),
     _nodeTypesOfInterest(NULL),
     _ownerID(UNKNOWN_NODE_ID),
     _lastNodeID(UNKNOWN_NODE_ID + 1),
     _numNoReplyDomainCheckIns(0),
-    _assignmentServerSocket(NULL)
+    _assignmentServerSocket(NULL),
+    _hasDeadNodes(false),
+    _silentNodeWheel(NODE_SILENCE_CHECK_INTERVAL_USECS, usecTimestampNow())
 {
     memcpy(_domainHostname, DEFAULT_DOMAIN_HOSTNAME, sizeof(DEFAULT_DOMAIN_HOSTNAME));
     memcpy(_domainIP, DEFAULT_DOMAIN_IP, sizeof(DEFAULT_DOMAIN_IP));
+    pthread_rwlock_init(&_nodeIndexLock, NULL);
+    pthread_mutex_init(&_silentNodeWheelMutex, NULL);
 }
 
 NodeList::~NodeList() {
@@ -80,6 +84,11 @@ NodeList::~NodeList() {
     
     // stop the spawned threads, if they were started
     stopSilentNodeRemovalThread();
+    
+    releaseNodeSlots(_nodeSlots);
+    
+    pthread_rwlock_destroy(&_nodeIndexLock);
+    pthread_mutex_destroy(&_silentNodeWheelMutex);
 }
 
 void NodeList::setDomainHostname(const char* domainHostname) {    
@@ -146,25 +155,18 @@ void NodeList::processBulkNodeData(sockaddr *senderAddress, unsigned char *packe
     Node* bulkSendNode = nodeWithAddress(senderAddress);
 
     if (bulkSendNode) {
-        bulkSendNode->setLastHeardMicrostamp(usecTimestampNow());
+        uint64_t now = usecTimestampNow();
+        bulkSendNode->setLastHeardMicrostamp(now);
         bulkSendNode->recordBytesReceived(numTotalBytes);
         
-        int numBytesPacketHeader = numBytesForPacketHeader(packetData);
-        
-        unsigned char* startPosition = packetData;
-        unsigned char* currentPosition = startPosition + numBytesPacketHeader;
-        unsigned char packetHolder[numTotalBytes];
-        
-        // we've already verified packet version for the bulk packet, so all head data in the packet is also up to date
-        populateTypeAndVersion(packetHolder, PACKET_TYPE_HEAD_DATA);
+        // we've already verified packet version for the bulk packet, so all head data in the packet is also up to date,
+        // and each node parses its record straight out of the packet, after the origin their positions are relative to
+        int offset = numBytesForPacketHeader(packetData) + BULK_AVATAR_DATA_ORIGIN_BYTES;
         
         uint16_t nodeID = -1;
         
-        while ((currentPosition - startPosition) < numTotalBytes) {
-            unpackNodeId(currentPosition, &nodeID);
-            memcpy(packetHolder + numBytesPacketHeader,
-                   currentPosition,
-                   numTotalBytes - (currentPosition - startPosition));
+        while (offset < numTotalBytes) {
+            unpackNodeId(packetData + offset, &nodeID);
             
             Node* matchingNode = nodeWithID(nodeID);
             
@@ -173,10 +175,24 @@ void NodeList::processBulkNodeData(sockaddr *senderAddress, unsigned char *packe
                 matchingNode = addOrUpdateNode(NULL, NULL, NODE_TYPE_AGENT, nodeID);
             }
             
-            currentPosition += updateNodeWithData(matchingNode,
-                                                  packetHolder,
-                                                  numTotalBytes - (currentPosition - startPosition));
+            matchingNode->lock();
+            matchingNode->setLastHeardMicrostamp(now);
+            
+            if (!matchingNode->getLinkedData() && linkedDataCreateCallback) {
+                linkedDataCreateCallback(matchingNode);
+            }
+            
+            int numParsedBytes = matchingNode->getLinkedData()
+                ? matchingNode->getLinkedData()->parseData(packetData, numTotalBytes, offset)
+                : 0;
+            
+            matchingNode->unlock();
             
+            if (numParsedBytes <= 0) {
+                // we can't tell where the next record starts, so the rest of the packet is lost
+                break;
+            }
+            offset += numParsedBytes;
         }
     }    
 }
@@ -212,24 +228,47 @@ int NodeList::updateNodeWithData(Node *node, unsigned char *packetData, int data
     return numParsedBytes;
 }
 
+// nodes only have IPv4 addresses for now, so the address and port make the key
+static quint64 socketKey(const sockaddr* socket) {
+    const sockaddr_in* socketIn = (const sockaddr_in*) socket;
+    return ((quint64) socketIn->sin_addr.s_addr << 16) | socketIn->sin_port;
+}
+
 Node* NodeList::nodeWithAddress(sockaddr *senderAddress) {
-    for(NodeList::iterator node = begin(); node != end(); node++) {
-        if (node->getActiveSocket() && socketMatch(node->getActiveSocket(), senderAddress)) {
-            return &(*node);
+    if (!senderAddress) {
+        return NULL;
+    }
+    
+    Node* matchingNode = NULL;
+    quint64 key = socketKey(senderAddress);
+    
+    pthread_rwlock_rdlock(&_nodeIndexLock);
+    for (QMultiHash<quint64, Node*>::const_iterator node = _nodesByActiveSocket.constFind(key);
+         node != _nodesByActiveSocket.constEnd() && node.key() == key; node++) {
+        if ((*node)->isAlive() && socketMatch((*node)->getActiveSocket(), senderAddress)) {
+            matchingNode = *node;
+            break;
         }
     }
+    pthread_rwlock_unlock(&_nodeIndexLock);
     
-    return NULL;
+    return matchingNode;
 }
 
 Node* NodeList::nodeWithID(uint16_t nodeID) {
-    for(NodeList::iterator node = begin(); node != end(); node++) {
-        if (node->getNodeID() == nodeID) {
-            return &(*node);
+    Node* matchingNode = NULL;
+    
+    pthread_rwlock_rdlock(&_nodeIndexLock);
+    for (QMultiHash<uint16_t, Node*>::const_iterator node = _nodesByID.constFind(nodeID);
+         node != _nodesByID.constEnd() && node.key() == nodeID; node++) {
+        if ((*node)->isAlive()) {
+            matchingNode = *node;
+            break;
         }
     }
+    pthread_rwlock_unlock(&_nodeIndexLock);
 
-    return NULL;
+    return matchingNode;
 }
 
 int NodeList::getNumAliveNodes() const {
@@ -245,18 +284,30 @@ int NodeList::getNumAliveNodes() const {
 }
 
 void NodeList::clear() {
-    // delete all of the nodes in the list, set the pointers back to NULL and the number of nodes to 0
-    for (int i = 0; i < _numNodes; i++) {
-        Node** nodeBucket = _nodeBuckets[i / NODES_PER_BUCKET];
-        Node* node = nodeBucket[i % NODES_PER_BUCKET];
-        
-        node->lock();
-        delete node;
-        
-        node = NULL;
+    pthread_mutex_lock(&_silentNodeWheelMutex);
+    
+    std::vector<NodeTimerWheel::Timer> nodeTimers;
+    _silentNodeWheel.takeAll(nodeTimers);
+    
+    // every node still in the list is retired along with the slots, and deleted once no iterator is walking them
+    pthread_rwlock_wrlock(&_nodeIndexLock);
+    NodeSlots* oldNodeSlots = _nodeSlots;
+    for (int i = 0; i < oldNodeSlots->numNodes; i++) {
+        oldNodeSlots->retiredNodes.push_back(oldNodeSlots->buckets[i / NODES_PER_BUCKET][i % NODES_PER_BUCKET]);
     }
+    _nodeSlots = new NodeSlots();
+    oldNodeSlots->newerSlots = _nodeSlots;
+    _nodeSlots->refCount.ref();
+    _nodesByActiveSocket.clear();
+    _nodesByPublicSocket.clear();
+    _nodesByID.clear();
+    _hasDeadNodes = false;
+    pthread_rwlock_unlock(&_nodeIndexLock);
+    
+    releaseNodeSlots(oldNodeSlots);
+    
+    pthread_mutex_unlock(&_silentNodeWheelMutex);
     
-    _numNodes = 0;
     _numNoReplyDomainCheckIns = 0;
 }
 
@@ -397,18 +448,24 @@ void NodeList::sendAssignment(Assignment& assignment) {
 }
 
 Node* NodeList::addOrUpdateNode(sockaddr* publicSocket, sockaddr* localSocket, char nodeType, uint16_t nodeId) {
-    NodeList::iterator node = end();
+    Node* node = NULL;
     
     if (publicSocket) {
-        for (node = begin(); node != end(); node++) {
-            if (node->matches(publicSocket, localSocket, nodeType)) {
+        quint64 key = socketKey(publicSocket);
+        
+        pthread_rwlock_rdlock(&_nodeIndexLock);
+        for (QMultiHash<quint64, Node*>::const_iterator publicNode = _nodesByPublicSocket.constFind(key);
+             publicNode != _nodesByPublicSocket.constEnd() && publicNode.key() == key; publicNode++) {
+            if ((*publicNode)->isAlive() && (*publicNode)->matches(publicSocket, localSocket, nodeType)) {
                 // we already have this node, stop checking
+                node = *publicNode;
                 break;
             }
         }
+        pthread_rwlock_unlock(&_nodeIndexLock);
     }
     
-    if (node == end()) {
+    if (!node) {
         // if we already had this node AND it's a solo type then bust out of here
         if (soloNodeOfType(nodeType)) {
             return NULL;
@@ -444,27 +501,158 @@ Node* NodeList::addOrUpdateNode(sockaddr* publicSocket, sockaddr* localSocket, c
         }
         
         // we had this node already, do nothing for now
-        return &*node;
+        return node;
     }    
 }
 
 void NodeList::addNodeToList(Node* newNode) {
+    pthread_rwlock_wrlock(&_nodeIndexLock);
+    
     // find the correct array to add this node to
-    int bucketIndex = _numNodes / NODES_PER_BUCKET;
+    int bucketIndex = _nodeSlots->numNodes / NODES_PER_BUCKET;
     
-    if (!_nodeBuckets[bucketIndex]) {
-        _nodeBuckets[bucketIndex] = new Node*[NODES_PER_BUCKET]();
+    if (!_nodeSlots->buckets[bucketIndex]) {
+        _nodeSlots->buckets[bucketIndex] = new Node*[NODES_PER_BUCKET]();
     }
     
-    _nodeBuckets[bucketIndex][_numNodes % NODES_PER_BUCKET] = newNode;
+    _nodeSlots->buckets[bucketIndex][_nodeSlots->numNodes % NODES_PER_BUCKET] = newNode;
+    
+    ++_nodeSlots->numNodes;
     
-    ++_numNodes;
+    indexNode(newNode);
+    pthread_rwlock_unlock(&_nodeIndexLock);
+    
+    pthread_mutex_lock(&_silentNodeWheelMutex);
+    _silentNodeWheel.schedule(newNode, newNode->getLastHeardMicrostamp() + NODE_SILENCE_THRESHOLD_USECS);
+    pthread_mutex_unlock(&_silentNodeWheelMutex);
     
     qDebug() << "Added" << *newNode << "\n";
     
     notifyHooksOfAddedNode(newNode);
 }
 
+void NodeList::killNode(Node* node) {
+    // only one caller gets to kill a node, so the hooks only hear about it once. It keeps its slot, iterators skip over
+    // it until the list is compacted and they move on to the new slots.
+    pthread_rwlock_wrlock(&_nodeIndexLock);
+    bool wasAlive = node->isAlive();
+    NodeSlots* nodeSlots = _nodeSlots;
+    if (wasAlive) {
+        node->setAlive(false);
+        unindexNode(node);
+        _hasDeadNodes = true;
+        
+        // an alive node is always in the current slots, and can only be retired to them or newer ones, so holding onto
+        // them keeps the node from being deleted while the hooks are still looking at it
+        nodeSlots->refCount.ref();
+    }
+    pthread_rwlock_unlock(&_nodeIndexLock);
+    
+    if (!wasAlive) {
+        return;
+    }
+    
+    qDebug() << "Killed " << *node << "\n";
+    
+    notifyHooksOfKilledNode(node);
+    
+    releaseNodeSlots(nodeSlots);
+}
+
+void NodeList::compactDeadNodes() {
+    NodeSlots* newNodeSlots = new NodeSlots();
+    
+    for (int i = 0; i < _nodeSlots->numNodes; i++) {
+        Node* node = _nodeSlots->buckets[i / NODES_PER_BUCKET][i % NODES_PER_BUCKET];
+        
+        if (node->isAlive()) {
+            int bucketIndex = newNodeSlots->numNodes / NODES_PER_BUCKET;
+            
+            if (!newNodeSlots->buckets[bucketIndex]) {
+                newNodeSlots->buckets[bucketIndex] = new Node*[NODES_PER_BUCKET]();
+            }
+            
+            newNodeSlots->buckets[bucketIndex][newNodeSlots->numNodes % NODES_PER_BUCKET] = node;
+            ++newNodeSlots->numNodes;
+        } else {
+            _nodeSlots->retiredNodes.push_back(node);
+        }
+    }
+    
+    // the wheel mustn't hand out the retired nodes once they're deleted
+    std::vector<Node*> sortedRetiredNodes(_nodeSlots->retiredNodes);
+    std::sort(sortedRetiredNodes.begin(), sortedRetiredNodes.end());
+    _silentNodeWheel.cancel(sortedRetiredNodes);
+    
+    // iterators already walking the old slots keep them, and the nodes retired to them, until they're done
+    NodeSlots* oldNodeSlots = _nodeSlots;
+    _nodeSlots = newNodeSlots;
+    oldNodeSlots->newerSlots = newNodeSlots;
+    newNodeSlots->refCount.ref();
+    releaseNodeSlots(oldNodeSlots);
+    
+    _hasDeadNodes = false;
+}
+
+NodeSlots* NodeList::acquireNodeSlots() const {
+    // the lock keeps the slots from being swapped out and freed between reading the pointer and taking the reference
+    pthread_rwlock_rdlock(&_nodeIndexLock);
+    NodeSlots* nodeSlots = _nodeSlots;
+    nodeSlots->refCount.ref();
+    pthread_rwlock_unlock(&_nodeIndexLock);
+    
+    return nodeSlots;
+}
+
+void NodeList::releaseNodeSlots(NodeSlots* nodeSlots) {
+    // freeing a set of slots lets go of the set that replaced it, which may be freed in turn
+    while (nodeSlots && !nodeSlots->refCount.deref()) {
+        NodeSlots* newerSlots = nodeSlots->newerSlots;
+        delete nodeSlots;
+        nodeSlots = newerSlots;
+    }
+}
+
+NodeSlots::NodeSlots() :
+    buckets(),
+    numNodes(0),
+    refCount(1),
+    newerSlots(NULL)
+{
+}
+
+NodeSlots::~NodeSlots() {
+    for (int i = 0; i < MAX_NUM_NODES / NODES_PER_BUCKET; i++) {
+        delete[] buckets[i];
+    }
+    
+    for (int i = 0; i < retiredNodes.size(); i++) {
+        // wait out anyone who still has the node locked
+        retiredNodes[i]->lock();
+        delete retiredNodes[i];
+    }
+}
+
+void NodeList::indexNode(Node* node) {
+    if (node->getActiveSocket()) {
+        _nodesByActiveSocket.insert(socketKey(node->getActiveSocket()), node);
+    }
+    if (node->getPublicSocket()) {
+        _nodesByPublicSocket.insert(socketKey(node->getPublicSocket()), node);
+    }
+    _nodesByID.insert(node->getNodeID(), node);
+}
+
+void NodeList::unindexNode(Node* node) {
+    if (node->getActiveSocket()) {
+        _nodesByActiveSocket.remove(socketKey(node->getActiveSocket()), node);
+    }
+    if (node->getPublicSocket()) {
+        _nodesByPublicSocket.remove(socketKey(node->getPublicSocket()), node);
+    }
+    _nodesByID.remove(node->getNodeID(), node);
+}
+
 unsigned NodeList::broadcastToNodes(unsigned char* broadcastData, size_t dataBytes, const char* nodeTypes, int numNodeTypes) {
     unsigned n = 0;
     for(NodeList::iterator node = begin(); node != end(); node++) {
@@ -482,11 +670,20 @@ void NodeList::handlePingReply(sockaddr *nodeAddress) {
     for(NodeList::iterator node = begin(); node != end(); node++) {
         // check both the public and local addresses for each node to see if we find a match
         // prioritize the private address so that we prune erroneous local matches
-        if (socketMatch(node->getPublicSocket(), nodeAddress)) {
-            node->activatePublicSocket();
-            break;
-        } else if (socketMatch(node->getLocalSocket(), nodeAddress)) {
-            node->activateLocalSocket();
+        bool isPublicMatch = socketMatch(node->getPublicSocket(), nodeAddress);
+        if (isPublicMatch || socketMatch(node->getLocalSocket(), nodeAddress)) {
+            // the node's active socket is changing, so move it in the index
+            pthread_rwlock_wrlock(&_nodeIndexLock);
+            if (node->getActiveSocket()) {
+                _nodesByActiveSocket.remove(socketKey(node->getActiveSocket()), &*node);
+            }
+            if (isPublicMatch) {
+                node->activatePublicSocket();
+            } else {
+                node->activateLocalSocket();
+            }
+            _nodesByActiveSocket.insert(socketKey(node->getActiveSocket()), &*node);
+            pthread_rwlock_unlock(&_nodeIndexLock);
             break;
         }
     }
@@ -504,31 +701,46 @@ Node* NodeList::soloNodeOfType(char nodeType) {
     return NULL;
 }
 
+void NodeList::checkSilentNodes() {
+    uint64_t now = usecTimestampNow();
+    
+    pthread_mutex_lock(&_silentNodeWheelMutex);
+    
+    _silentNodeWheel.advance(now, _dueSilentNodeTimers);
+    
+    for (int i = 0; i < _dueSilentNodeTimers.size(); i++) {
+        Node* node = _dueSilentNodeTimers[i].node;
+        
+        if (node->isAlive() && node->getLastHeardMicrostamp() + NODE_SILENCE_THRESHOLD_USECS >= now) {
+            // we've heard from it since it was scheduled, look again when it could next have gone silent
+            _silentNodeWheel.schedule(node, node->getLastHeardMicrostamp() + NODE_SILENCE_THRESHOLD_USECS);
+        } else {
+            // it's gone silent, or was killed somewhere else since it was scheduled, either way it drops off the wheel
+            killNode(node);
+        }
+    }
+    
+    _dueSilentNodeTimers.clear();
+    
+    pthread_rwlock_wrlock(&_nodeIndexLock);
+    if (_hasDeadNodes) {
+        compactDeadNodes();
+    }
+    pthread_rwlock_unlock(&_nodeIndexLock);
+    
+    pthread_mutex_unlock(&_silentNodeWheelMutex);
+}
+
 void* removeSilentNodes(void *args) {
     NodeList* nodeList = (NodeList*) args;
-    uint64_t checkTimeUSecs;
-    int sleepTime;
     
     while (!silentNodeThreadStopFlag) {
-        checkTimeUSecs = usecTimestampNow();
-        
-        for(NodeList::iterator node = nodeList->begin(); node != nodeList->end(); ++node) {
-            
-            if ((checkTimeUSecs - node->getLastHeardMicrostamp()) > NODE_SILENCE_THRESHOLD_USECS) {
-            
-                qDebug() << "Killed " << *node << "\n";
-                
-                nodeList->notifyHooksOfKilledNode(&*node);
-                
-                node->setAlive(false);
-            }
-        }
+        nodeList->checkSilentNodes();
         
-        sleepTime = NODE_SILENCE_THRESHOLD_USECS - (usecTimestampNow() - checkTimeUSecs);
         #ifdef _WIN32
-        Sleep( static_cast<int>(1000.0f*sleepTime) );
+        Sleep(NODE_SILENCE_CHECK_INTERVAL_USECS / 1000);
         #else
-        usleep(sleepTime);
+        usleep(NODE_SILENCE_CHECK_INTERVAL_USECS);
         #endif
     }
     
@@ -577,39 +789,58 @@ void NodeList::saveData(QSettings* settings) {
 }
 
 NodeList::iterator NodeList::begin() const {
-    Node** nodeBucket = NULL;
+    NodeListIterator node(acquireNodeSlots(), 0);
     
-    for (int i = 0; i < _numNodes; i++) {
-        if (i % NODES_PER_BUCKET == 0) {
-            nodeBucket =  _nodeBuckets[i / NODES_PER_BUCKET];
-        }
-        
-        if (nodeBucket[i % NODES_PER_BUCKET]->isAlive()) {
-            return NodeListIterator(this, i);
-        }
+    if (!node.isAtEnd() && !node->isAlive()) {
+        // skip to the first alive node, or the end if there isn't one
+        ++node;
     }
     
-    // there's no alive node to start from - return the end
-    return end();
+    return node;
 }
 
 NodeList::iterator NodeList::end() const {
-    return NodeListIterator(this, _numNodes);
+    return NodeListIterator(NULL, 0);
 }
 
-NodeListIterator::NodeListIterator(const NodeList* nodeList, int nodeIndex) :
+NodeListIterator::NodeListIterator(NodeSlots* nodeSlots, int nodeIndex) :
+    _nodeSlots(nodeSlots),
     _nodeIndex(nodeIndex) {
-    _nodeList = nodeList;
+}
+
+NodeListIterator::NodeListIterator(const NodeListIterator& otherValue) :
+    _nodeSlots(otherValue._nodeSlots),
+    _nodeIndex(otherValue._nodeIndex) {
+    if (_nodeSlots) {
+        _nodeSlots->refCount.ref();
+    }
+}
+
+NodeListIterator::~NodeListIterator() {
+    if (_nodeSlots) {
+        NodeList::releaseNodeSlots(_nodeSlots);
+    }
 }
 
 NodeListIterator& NodeListIterator::operator=(const NodeListIterator& otherValue) {
-    _nodeList = otherValue._nodeList;
+    if (otherValue._nodeSlots) {
+        otherValue._nodeSlots->refCount.ref();
+    }
+    if (_nodeSlots) {
+        NodeList::releaseNodeSlots(_nodeSlots);
+    }
+    
+    _nodeSlots = otherValue._nodeSlots;
     _nodeIndex = otherValue._nodeIndex;
     return *this;
 }
 
 bool NodeListIterator::operator==(const NodeListIterator &otherValue) {
-    return _nodeIndex == otherValue._nodeIndex;
+    // every iterator past the end of its slots is the end, whichever slots it was walking
+    if (isAtEnd() || otherValue.isAtEnd()) {
+        return isAtEnd() && otherValue.isAtEnd();
+    }
+    return _nodeSlots == otherValue._nodeSlots && _nodeIndex == otherValue._nodeIndex;
 }
 
 bool NodeListIterator::operator!=(const NodeListIterator &otherValue) {
@@ -617,12 +848,12 @@ bool NodeListIterator::operator!=(const NodeListIterator &otherValue) {
 }
 
 Node& NodeListIterator::operator*() {
-    Node** nodeBucket = _nodeList->_nodeBuckets[_nodeIndex / NODES_PER_BUCKET];
+    Node** nodeBucket = _nodeSlots->buckets[_nodeIndex / NODES_PER_BUCKET];
     return *nodeBucket[_nodeIndex % NODES_PER_BUCKET];
 }
 
 Node* NodeListIterator::operator->() {
-    Node** nodeBucket = _nodeList->_nodeBuckets[_nodeIndex / NODES_PER_BUCKET];
+    Node** nodeBucket = _nodeSlots->buckets[_nodeIndex / NODES_PER_BUCKET];
     return nodeBucket[_nodeIndex % NODES_PER_BUCKET];
 }
 
@@ -638,10 +869,10 @@ NodeList::iterator NodeListIterator::operator++(int) {
 }
 
 void NodeListIterator::skipDeadAndStopIncrement() {
-    while (_nodeIndex != _nodeList->_numNodes) {
+    while (!isAtEnd()) {
         ++_nodeIndex;
         
-        if (_nodeIndex == _nodeList->_numNodes) {
+        if (isAtEnd()) {
             break;
         } else if ((*(*this)).isAlive()) {
             // skip over the dead nodes
@@ -14,9 +14,12 @@
 #include <iterator>
 #include <unistd.h>
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMultiHash>
 #include <QtCore/QSettings>
 
 #include "Node.h"
+#include "NodeTimerWheel.h"
 #include "NodeTypes.h"
 #include "UDPSocket.h"
 
@@ -30,6 +33,7 @@ const int NODES_PER_BUCKET = 100;
 const int MAX_PACKET_SIZE = 1500;
 
 const int NODE_SILENCE_THRESHOLD_USECS = 2 * 1000000;
+const int NODE_SILENCE_CHECK_INTERVAL_USECS = 100 * 1000;
 const int DOMAIN_SERVER_CHECK_IN_USECS = 1 * 1000000;
 
 extern const char SOLO_NODE_TYPES[2];
@@ -47,6 +51,24 @@ const int MAX_SILENT_DOMAIN_SERVER_CHECK_INS = 5;
 class Assignment;
 class NodeListIterator;
 
+/// The slots the list's nodes sit in, in the order they were added. Killed nodes keep their slot, so iterators walking
+/// the slots never miss a node. Compacting the list copies the alive nodes into a new set of slots and swaps it in,
+/// the old set is freed when the last iterator walking it lets go, and the dead nodes compacted out go with it.
+struct NodeSlots {
+    NodeSlots();
+    ~NodeSlots();
+    
+    Node** buckets[MAX_NUM_NODES / NODES_PER_BUCKET];
+    int numNodes;
+    QAtomicInt refCount; // one for the list while the slots are current, one for each iterator on them, and one for
+                         // the slots they replaced
+    
+    // Nodes compacted out of the list when these slots were swapped out. Iterators on these slots or any older ones
+    // can still reach them, so each set of slots holds onto the set that replaced it, and they're freed oldest first.
+    std::vector<Node*> retiredNodes;
+    NodeSlots* newerSlots;
+};
+
 // Callers who want to hook add/kill callbacks should implement this class
 class NodeListHook {
 public:
@@ -87,7 +109,7 @@ public:
     
     void(*linkedDataCreateCallback)(Node *);
     
-    int size() { return _numNodes; }
+    int size() { return _nodeSlots->numNodes; }
     int getNumAliveNodes() const;
     
     int getNumNoReplyDomainCheckIns() const { return _numNoReplyDomainCheckIns; }
@@ -107,6 +129,14 @@ public:
     
     Node* addOrUpdateNode(sockaddr* publicSocket, sockaddr* localSocket, char nodeType, uint16_t nodeId);
     
+    /// Marks the node dead, letting the hooks know, and drops it from the lookup indexes. It stays in its slot in the
+    /// list, skipped by iterators, until the list is next compacted. The node itself isn't deleted until clear().
+    void killNode(Node* node);
+    
+    /// Kills the nodes that have gone silent, only looking at the nodes that have come due on the silent node wheel
+    /// since the last call, not the whole list. Then compacts the dead nodes out of the list, if no iterator is using it.
+    void checkSilentNodes();
+    
     void processNodeData(sockaddr *senderAddress, unsigned char *packetData, size_t dataBytes);
     void processBulkNodeData(sockaddr *senderAddress, unsigned char *packetData, int numTotalBytes);
    
@@ -140,10 +170,20 @@ private:
     
     void addNodeToList(Node* newNode);
     
+    /// Swaps in a new set of slots holding just the alive nodes, retiring the dead ones to the old slots and taking them
+    /// off the silent node wheel. Only called with the list locked for writing and the wheel locked.
+    void compactDeadNodes();
+    
+    /// Takes a reference to the current slots, for an iterator to walk
+    NodeSlots* acquireNodeSlots() const;
+    static void releaseNodeSlots(NodeSlots* nodeSlots);
+    
+    void indexNode(Node* node);
+    void unindexNode(Node* node);
+    
     char _domainHostname[MAX_HOSTNAME_BYTES];
     char _domainIP[INET_ADDRSTRLEN];
-    Node** _nodeBuckets[MAX_NUM_NODES / NODES_PER_BUCKET];
-    int _numNodes;
+    NodeSlots* _nodeSlots;
     UDPSocket _nodeSocket;
     char _ownerType;
     char* _nodeTypesOfInterest;
@@ -154,6 +194,21 @@ private:
     int _numNoReplyDomainCheckIns;
     sockaddr* _assignmentServerSocket;
     
+    // Indexes of the alive nodes, so finding the node a packet came from doesn't mean searching the whole list. Sockets
+    // are keyed by address and port, and lookups check for a real match since more than one node can share a key.
+    QMultiHash<quint64, Node*> _nodesByActiveSocket;
+    QMultiHash<quint64, Node*> _nodesByPublicSocket;
+    QMultiHash<uint16_t, Node*> _nodesByID;
+    mutable pthread_rwlock_t _nodeIndexLock; // also held for writing while the list itself changes
+    
+    bool _hasDeadNodes; // since the last compaction
+    
+    // Every alive node is on the wheel once, due at the time it could next have gone silent. Killed nodes drop off it
+    // when they come due, or when they're compacted out of the list.
+    NodeTimerWheel _silentNodeWheel;
+    std::vector<NodeTimerWheel::Timer> _dueSilentNodeTimers;
+    pthread_mutex_t _silentNodeWheelMutex;
+    
     void handlePingReply(sockaddr *nodeAddress);
     void timePingReply(sockaddr *nodeAddress, unsigned char *packetData);
     
@@ -162,7 +217,10 @@ private:
 
 class NodeListIterator : public std::iterator<std::input_iterator_tag, Node> {
 public:
-    NodeListIterator(const NodeList* nodeList, int nodeIndex);
+    /// Takes over the caller's reference to the slots. The end iterator has no slots.
+    NodeListIterator(NodeSlots* nodeSlots, int nodeIndex);
+    NodeListIterator(const NodeListIterator& otherValue);
+    ~NodeListIterator();
     
     int getNodeIndex() { return _nodeIndex; }
     
@@ -177,9 +235,12 @@ public:
 	NodeListIterator& operator++();
     NodeListIterator operator++(int);
 private:
+    friend class NodeList;
+    
     void skipDeadAndStopIncrement();
+    bool isAtEnd() const { return !_nodeSlots || _nodeIndex >= _nodeSlots->numNodes; }
     
-    const NodeList* _nodeList;
+    NodeSlots* _nodeSlots;
     int _nodeIndex;
 };
 
@@ -0,0 +1,99 @@
+//
+//  NodeTimerWheel.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Hierarchical timer wheel of nodes, for finding the ones that have gone silent
+//
+
+#include <algorithm>
+
+#include "NodeTimerWheel.h"
+
+NodeTimerWheel::NodeTimerWheel(uint64_t tickUsecs, uint64_t now) :
+    _tickUsecs(tickUsecs),
+    _currentTick(now / tickUsecs)
+{
+}
+
+void NodeTimerWheel::schedule(Node* node, uint64_t dueTime) {
+    Timer timer = { node, dueTime };
+    schedule(timer);
+}
+
+void NodeTimerWheel::schedule(const Timer& timer) {
+    // anything already due goes out on the next advance()
+    uint64_t dueTick = std::max(timer.dueTime / _tickUsecs, _currentTick);
+
+    if (dueTick - _currentTick < NODE_TIMER_WHEEL_INNER_SLOTS) {
+        _innerSlots[dueTick % NODE_TIMER_WHEEL_INNER_SLOTS].push_back(timer);
+    } else {
+        // Timers further out than the outer wheel reaches go in its furthest slot, and are placed again when they're
+        // moved down from there.
+        uint64_t turn = std::min(dueTick / NODE_TIMER_WHEEL_INNER_SLOTS,
+                                 _currentTick / NODE_TIMER_WHEEL_INNER_SLOTS + NODE_TIMER_WHEEL_OUTER_SLOTS - 1);
+        _outerSlots[turn % NODE_TIMER_WHEEL_OUTER_SLOTS].push_back(timer);
+    }
+}
+
+void NodeTimerWheel::advance(uint64_t now, std::vector<Timer>& dueTimers) {
+    uint64_t nowTick = now / _tickUsecs;
+
+    while (_currentTick <= nowTick) {
+        if (_currentTick % NODE_TIMER_WHEEL_INNER_SLOTS == 0) {
+            // the inner wheel is starting a new turn, so the timers for this turn move down into it
+            std::vector<Timer>& outerSlot = _outerSlots[(_currentTick / NODE_TIMER_WHEEL_INNER_SLOTS)
+                                                        % NODE_TIMER_WHEEL_OUTER_SLOTS];
+            _cascadingTimers.swap(outerSlot);
+            for (int i = 0; i < _cascadingTimers.size(); i++) {
+                schedule(_cascadingTimers[i]);
+            }
+            _cascadingTimers.clear();
+        }
+
+        std::vector<Timer>& innerSlot = _innerSlots[_currentTick % NODE_TIMER_WHEEL_INNER_SLOTS];
+        dueTimers.insert(dueTimers.end(), innerSlot.begin(), innerSlot.end());
+        innerSlot.clear();
+
+        _currentTick++;
+    }
+}
+
+// whether a timer belongs to one of a sorted list of nodes
+class IsTimerForNode {
+public:
+    IsTimerForNode(const std::vector<Node*>& sortedNodes) : _sortedNodes(sortedNodes) {}
+
+    bool operator()(const NodeTimerWheel::Timer& timer) const {
+        return std::binary_search(_sortedNodes.begin(), _sortedNodes.end(), timer.node);
+    }
+
+private:
+    const std::vector<Node*>& _sortedNodes;
+};
+
+void NodeTimerWheel::cancel(const std::vector<Node*>& sortedNodes) {
+    IsTimerForNode isTimerForNode(sortedNodes);
+
+    for (int i = 0; i < NODE_TIMER_WHEEL_INNER_SLOTS; i++) {
+        _innerSlots[i].erase(std::remove_if(_innerSlots[i].begin(), _innerSlots[i].end(), isTimerForNode),
+                             _innerSlots[i].end());
+    }
+    for (int i = 0; i < NODE_TIMER_WHEEL_OUTER_SLOTS; i++) {
+        _outerSlots[i].erase(std::remove_if(_outerSlots[i].begin(), _outerSlots[i].end(), isTimerForNode),
+                             _outerSlots[i].end());
+    }
+}
+
+void NodeTimerWheel::takeAll(std::vector<Timer>& timers) {
+    for (int i = 0; i < NODE_TIMER_WHEEL_INNER_SLOTS; i++) {
+        timers.insert(timers.end(), _innerSlots[i].begin(), _innerSlots[i].end());
+        _innerSlots[i].clear();
+    }
+    for (int i = 0; i < NODE_TIMER_WHEEL_OUTER_SLOTS; i++) {
+        timers.insert(timers.end(), _outerSlots[i].begin(), _outerSlots[i].end());
+        _outerSlots[i].clear();
+    }
+}
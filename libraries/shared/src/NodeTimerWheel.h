@@ -0,0 +1,57 @@
+//
+//  NodeTimerWheel.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Hierarchical timer wheel of nodes, for finding the ones that have gone silent
+//
+
+#ifndef __shared__NodeTimerWheel__
+#define __shared__NodeTimerWheel__
+
+#include <stdint.h>
+#include <vector>
+
+class Node;
+
+/// The inner wheel has a slot per tick, the outer wheel has a slot per turn of the inner wheel
+const int NODE_TIMER_WHEEL_INNER_SLOTS = 32;
+const int NODE_TIMER_WHEEL_OUTER_SLOTS = 32;
+
+/// Two level timer wheel of nodes, keyed on the time each node is next due to be looked at. Scheduling and handing out
+/// due timers only touch the slots involved, so the cost is in the number of timers coming due, not the number of nodes.
+/// Timers due further out than the inner wheel reaches wait in the outer wheel, and drop down into the inner wheel as
+/// their turn comes up. Not thread safe.
+class NodeTimerWheel {
+public:
+    struct Timer {
+        Node* node;
+        uint64_t dueTime;
+    };
+
+    NodeTimerWheel(uint64_t tickUsecs, uint64_t now);
+
+    void schedule(Node* node, uint64_t dueTime);
+
+    /// Turns the wheel up to now, appending all the timers that have come due to dueTimers
+    void advance(uint64_t now, std::vector<Timer>& dueTimers);
+
+    /// Empties the wheel, appending all of its timers to timers
+    void takeAll(std::vector<Timer>& timers);
+
+    /// Drops the timers of the nodes in sortedNodes, which has to be sorted. Looks at every timer on the wheel.
+    void cancel(const std::vector<Node*>& sortedNodes);
+
+private:
+    void schedule(const Timer& timer);
+
+    uint64_t _tickUsecs;
+    uint64_t _currentTick; // every timer due before this tick has been handed out
+    std::vector<Timer> _innerSlots[NODE_TIMER_WHEEL_INNER_SLOTS];
+    std::vector<Timer> _outerSlots[NODE_TIMER_WHEEL_OUTER_SLOTS];
+    std::vector<Timer> _cascadingTimers;
+};
+
+#endif // __shared__NodeTimerWheel__
@@ -320,6 +320,66 @@ bool isAncestorOf(unsigned char* possibleAncestor, unsigned char* possibleDescen
     return true;
 }
 
+bool octalCodeToMortonKey(unsigned char* octalCode, MortonKey& key) {
+    int codeLength = numberOfThreeBitSectionsInCode(octalCode);
+    int keyDepth = std::min(codeLength, MAX_MORTON_KEY_DEPTH);
+
+    // the sections are packed most significant bit first right after the length byte, so load the bytes big endian
+    // and shift the unused low bits away
+    uint64_t packed = 0;
+    int pathBytes = (keyDepth * BITS_IN_OCTAL + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    unsigned char* pathAt = octalCode + ((codeLength < 255) ? 1 : 2); // codes of 255+ sections use two length bytes
+    for (int i = 0; i < pathBytes; i++) {
+        packed |= (uint64_t)pathAt[i] << (BITS_IN_BYTE * (sizeof(packed) - 1 - i));
+    }
+    key.depth = keyDepth;
+    key.path = (keyDepth > 0) ? (packed >> (BITS_IN_BYTE * sizeof(packed) - (keyDepth * BITS_IN_OCTAL))) : 0;
+    return codeLength <= MAX_MORTON_KEY_DEPTH;
+}
+
+int mortonKeyToOctalCode(const MortonKey& key, unsigned char* octalCodeBuffer) {
+    int codeBytes = bytesRequiredForCodeLength(key.depth);
+    *octalCodeBuffer = key.depth;
+    if (key.depth > 0) {
+        uint64_t packed = key.path << (BITS_IN_BYTE * sizeof(packed) - (key.depth * BITS_IN_OCTAL));
+        for (int i = 1; i < codeBytes; i++) {
+            octalCodeBuffer[i] = (unsigned char)(packed >> (BITS_IN_BYTE * (sizeof(packed) - i)));
+        }
+    }
+    return codeBytes;
+}
+
+bool isAncestorOf(const MortonKey& possibleAncestor, const MortonKey& possibleDescendent, int descendentsChild) {
+    if (possibleAncestor.depth > possibleDescendent.depth) {
+        // if the caller included a child, then the child itself is the one deeper ancestor it can have
+        return descendentsChild != CHECK_NODE_ONLY && possibleAncestor == possibleDescendent.childKey(descendentsChild);
+    }
+    return possibleDescendent.ancestorAtDepth(possibleAncestor.depth).path == possibleAncestor.path;
+}
+
+OctalCodeComparison compareMortonKeys(const MortonKey& keyA, const MortonKey& keyB) {
+    if (keyA == keyB) {
+        return EXACT_MATCH;
+    }
+    return (keyA < keyB) ? LESS_THAN : GREATER_THAN;
+}
+
+void copyFirstVertexForKey(const MortonKey& key, float* output) {
+    memset(output, 0, 3 * sizeof(float));
+    
+    float currentScale = 0.5;
+    
+    for (int i = 0; i < key.depth; i++) {
+        int sectionIndex = key.sectionValue(i);
+        
+        for (int j = 0; j < 3; j++) {
+            output[j] += currentScale * (int)oneAtBit(sectionIndex, 5 + j);
+        }
+        
+        currentScale *= 0.5;
+    }
+}
+
 unsigned char* hexStringToOctalCode(const QString& input) {
     const int HEX_NUMBER_BASE = 16;
     const int HEX_BYTE_SIZE = 2;
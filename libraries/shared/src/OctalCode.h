@@ -9,6 +9,7 @@
 #ifndef __hifi__OctalCode__
 #define __hifi__OctalCode__
 
+#include <stdint.h>
 #include <string.h>
 #include <QString>
 
@@ -51,6 +52,57 @@ typedef enum {
 
 OctalCodeComparison compareOctalCodes(unsigned char* code1, unsigned char* code2);
 
+// MortonKey is a fixed width alternative to the variable length octal code byte strings. The three bit sections of the
+// code are packed into a single 64 bit path, with the root most section in the highest used bits, and the number of
+// sections kept in a separate depth field. Keys live by value, so they need no allocation, and ancestor checks and
+// comparisons are a shift and an integer compare. The byte string octal codes remain the wire and file format, use
+// octalCodeToMortonKey() and mortonKeyToOctalCode() to convert at packet boundaries.
+const int MAX_MORTON_KEY_DEPTH = 21; // 63 bits of path
+const int MAX_MORTON_KEY_OCTAL_CODE_BYTES = 9; // bytesRequiredForCodeLength(MAX_MORTON_KEY_DEPTH)
+
+struct MortonKey {
+    uint64_t        path;
+    unsigned char   depth;
+
+    MortonKey() : path(0), depth(0) { }
+    MortonKey(uint64_t path, unsigned char depth) : path(path), depth(depth) { }
+
+    MortonKey childKey(int childIndex) const { return MortonKey((path << BITS_IN_OCTAL) | childIndex, depth + 1); }
+    MortonKey ancestorAtDepth(int ancestorDepth) const {
+        return MortonKey(path >> (BITS_IN_OCTAL * (depth - ancestorDepth)), ancestorDepth);
+    }
+
+    // drops the root most chopLevels sections, like chopOctalCode(), chopping everything leaves the root key
+    MortonKey chop(int chopLevels) const {
+        int choppedDepth = (depth > chopLevels) ? depth - chopLevels : 0;
+        return MortonKey(path & (((uint64_t)1 << (BITS_IN_OCTAL * choppedDepth)) - 1), choppedDepth);
+    }
+
+    // section 0 is the root most section, same as getOctalCodeSectionValue()
+    int sectionValue(int section) const { return (int)(path >> (BITS_IN_OCTAL * (depth - 1 - section))) & 7; }
+
+    bool operator==(const MortonKey& other) const { return path == other.path && depth == other.depth; }
+    bool operator!=(const MortonKey& other) const { return !(*this == other); }
+
+    // same order as compareOctalCodes(), shallower keys sort first
+    bool operator<(const MortonKey& other) const {
+        return depth < other.depth || (depth == other.depth && path < other.path);
+    }
+};
+
+// returns false if the code is deeper than MAX_MORTON_KEY_DEPTH, in which case the key holds the code's ancestor at
+// MAX_MORTON_KEY_DEPTH
+bool octalCodeToMortonKey(unsigned char* octalCode, MortonKey& key);
+
+// writes the octal code for the key into octalCodeBuffer, which must hold at least
+// bytesRequiredForCodeLength(key.depth) bytes, returns the number of bytes written
+int mortonKeyToOctalCode(const MortonKey& key, unsigned char* octalCodeBuffer);
+
+bool isAncestorOf(const MortonKey& possibleAncestor, const MortonKey& possibleDescendent,
+                  int descendentsChild = CHECK_NODE_ONLY);
+OctalCodeComparison compareMortonKeys(const MortonKey& keyA, const MortonKey& keyB);
+void copyFirstVertexForKey(const MortonKey& key, float* output);
+
 QString octalCodeToHexString(unsigned char* octalCode);
 unsigned char* hexStringToOctalCode(const QString& input);
 
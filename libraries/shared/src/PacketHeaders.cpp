@@ -20,13 +20,21 @@ PACKET_VERSION versionForPacketType(PACKET_TYPE type) {
             return 1;
 
         case PACKET_TYPE_HEAD_DATA:
-            return 5;
+            return 7;
+        
+        case PACKET_TYPE_BULK_AVATAR_DATA:
+            return 1;
         
         case PACKET_TYPE_AVATAR_FACE_VIDEO:
             return 1;
 
         case PACKET_TYPE_VOXEL_STATS:
-            return 2;            
+            return 3;
+
+        case PACKET_TYPE_VOXEL_DATA:
+        case PACKET_TYPE_VOXEL_DATA_MONOCHROME:
+            return 2;
+
         default:
             return 0;
     }
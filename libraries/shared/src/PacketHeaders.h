@@ -41,6 +41,7 @@ const PACKET_TYPE PACKET_TYPE_DEPLOY_ASSIGNMENT = 'd';
 const PACKET_TYPE PACKET_TYPE_VOXEL_STATS = '#';
 const PACKET_TYPE PACKET_TYPE_VOXEL_JURISDICTION = 'J';
 const PACKET_TYPE PACKET_TYPE_VOXEL_JURISDICTION_REQUEST = 'j';
+const PACKET_TYPE PACKET_TYPE_VOXEL_DATA_ACK = 'a';
 
 typedef char PACKET_VERSION;
 
@@ -53,6 +54,9 @@ int numBytesForPacketHeader(const unsigned char* packetHeader);
 
 const int MAX_PACKET_HEADER_BYTES = sizeof(PACKET_TYPE) + sizeof(PACKET_VERSION);
 
+// bulk avatar data packets have the origin their avatar positions can be relative to between the header and the records
+const int BULK_AVATAR_DATA_ORIGIN_BYTES = sizeof(float) * 3;
+
 // These are supported Z-Command
 #define ERASE_ALL_COMMAND "erase all"
 #define ADD_SCENE_COMMAND "add scene"
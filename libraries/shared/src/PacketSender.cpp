@@ -20,6 +20,10 @@ const int PacketSender::MINIMUM_PACKETS_PER_SECOND = 1;
 
 PacketSender::PacketSender(PacketSenderNotify* notify, int packetsPerSecond) : 
     _packetsPerSecond(packetsPerSecond),
+    _packets(PACKET_SENDER_QUEUE_SIZE),
+    _overflowPacketsWaiting(0),
+    _overflowPacketCount(0),
+    _nextOverflowPacket(0),
     _lastSendTime(usecTimestampNow()),
     _notify(notify)
 {
@@ -27,44 +31,73 @@ PacketSender::PacketSender(PacketSenderNotify* notify, int packetsPerSecond) :
 
 
 void PacketSender::queuePacketForSending(sockaddr& address, unsigned char* packetData, ssize_t packetLength) {
-    NetworkPacket packet(address, packetData, packetLength);
-    lock();
-    _packets.push_back(packet);
-    unlock();
+    if (_overflowPacketsWaiting.loadAcquire() != 0 || !_packets.push(address, packetData, packetLength)) {
+        // the queue is full, or earlier packets are already waiting in the overflow list
+        lock();
+        _overflowPackets.push_back(NetworkPacket(address, packetData, packetLength));
+        _overflowPacketsWaiting.storeRelease(_overflowPackets.size());
+        unlock();
+        _overflowPacketCount.fetchAndAddRelaxed(1);
+    }
+    wakeUp();
+}
+
+NetworkPacket* PacketSender::nextPacketToSend() {
+    // overflowed packets we've taken are older than anything in the queue
+    if (_nextOverflowPacket < _sendingOverflowPackets.size()) {
+        return &_sendingOverflowPackets[_nextOverflowPacket];
+    }
+    NetworkPacket* packet = _packets.front();
+    if (!packet && _overflowPacketsWaiting.loadAcquire() > 0) {
+        // the queue's caught up, so everything in the overflow list is next
+        _sendingOverflowPackets.clear();
+        _nextOverflowPacket = 0;
+        lock();
+        _sendingOverflowPackets.swap(_overflowPackets);
+        _overflowPacketsWaiting.storeRelease(0);
+        unlock();
+        packet = &_sendingOverflowPackets[0];
+    }
+    return packet;
+}
+
+void PacketSender::packetToSendSent() {
+    if (_nextOverflowPacket < _sendingOverflowPackets.size()) {
+        _nextOverflowPacket++;
+    } else {
+        _packets.pop();
+    }
 }
 
 bool PacketSender::process() {
     uint64_t USECS_PER_SECOND = 1000 * 1000;
     uint64_t SEND_INTERVAL_USECS = (_packetsPerSecond == 0) ? USECS_PER_SECOND : (USECS_PER_SECOND / _packetsPerSecond);
     
-    if (_packets.size() == 0) {
-        usleep(SEND_INTERVAL_USECS);
+    NetworkPacket* packet = nextPacketToSend();
+    if (!packet) {
+        // nothing to do until someone queues a packet
+        waitForWork();
     }
-    while (_packets.size() > 0) {
-        NetworkPacket& packet = _packets.front();
+    while (isStillRunning() && (packet = nextPacketToSend())) {
+        // if we're not due to send yet, wait till we are. Packets being queued wake us early, so just check again.
+        uint64_t now = usecTimestampNow();
+        uint64_t nextSendTime = _lastSendTime + SEND_INTERVAL_USECS;
+        if (now < nextSendTime) {
+            waitForWork(nextSendTime - now);
+            continue;
+        }
         
         // send the packet through the NodeList...
         UDPSocket* nodeSocket = NodeList::getInstance()->getNodeSocket();
 
-        nodeSocket->send(&packet.getAddress(), packet.getData(), packet.getLength());
+        nodeSocket->send(&packet->getAddress(), packet->getData(), packet->getLength());
         
         if (_notify) {
-            _notify->packetSentNotification(packet.getLength());
+            _notify->packetSentNotification(packet->getLength());
         }
 
-        lock();
-        _packets.erase(_packets.begin());
-        unlock();
-
-        uint64_t now = usecTimestampNow();
-        // dynamically sleep until we need to fire off the next set of voxels
-        uint64_t elapsed = now - _lastSendTime;
-        int usecToSleep =  SEND_INTERVAL_USECS - elapsed;
+        packetToSendSent();
         _lastSendTime = now;
-        if (usecToSleep > 0) {
-            usleep(usecToSleep);
-        }
-
     }
     return isStillRunning();  // keep running till they terminate us
 }
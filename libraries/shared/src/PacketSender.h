@@ -11,8 +11,13 @@
 #ifndef __shared__PacketSender__
 #define __shared__PacketSender__
 
+#include <vector>
+
 #include "GenericThread.h"
-#include "NetworkPacket.h"
+#include "NetworkPacketQueue.h"
+
+/// How many outbound packets can wait in a PacketSender's queue before it starts holding them in its overflow list
+const int PACKET_SENDER_QUEUE_SIZE = 256;
 
 /// Notification Hook for packets being sent by a PacketSender
 class PacketSenderNotify {
@@ -29,12 +34,15 @@ public:
 
     PacketSender(PacketSenderNotify* notify = NULL, int packetsPerSecond = DEFAULT_PACKETS_PER_SECOND);
 
-    /// Add packet to outbound queue.
+    /// Add packet to outbound queue. Packets that don't fit in the queue wait in an overflow list, so none are lost.
     /// \param sockaddr& address the destination address
     /// \param packetData pointer to data
     /// \param ssize_t packetLength size of data
-    /// \thread any thread, typically the application thread
+    /// \thread a single thread, typically the application thread
     void queuePacketForSending(sockaddr& address, unsigned char*  packetData, ssize_t packetLength);
+
+    /// How many packets have had to wait in the overflow list because the queue was full
+    int getOverflowPacketCount() const { return _overflowPacketCount.load(); }
     
     void setPacketsPerSecond(int packetsPerSecond) { _packetsPerSecond = std::min(MINIMUM_PACKETS_PER_SECOND, packetsPerSecond); }
     int getPacketsPerSecond() const { return _packetsPerSecond; }
@@ -47,11 +55,25 @@ public:
 protected:
     int _packetsPerSecond;
     
-    bool hasPacketsToSend() const { return _packets.size() > 0; }
-    int packetsToSendCount() const { return _packets.size(); }
+    bool hasPacketsToSend() const { return packetsToSendCount() > 0; }
+    int packetsToSendCount() const {
+        return _packets.size() + _overflowPacketsWaiting.load() + (_sendingOverflowPackets.size() - _nextOverflowPacket);
+    }
 
 private:
-    std::vector<NetworkPacket> _packets;
+    NetworkPacket* nextPacketToSend();
+    void packetToSendSent();
+
+    NetworkPacketQueue _packets;
+
+    // Packets that didn't fit in _packets, which the consumer takes all at once into _sendingOverflowPackets. Once a
+    // packet has overflowed, the ones after it overflow too until the list is taken, so they all go out in order.
+    std::vector<NetworkPacket> _overflowPackets; // locked
+    QAtomicInt _overflowPacketsWaiting;
+    QAtomicInt _overflowPacketCount;
+    std::vector<NetworkPacket> _sendingOverflowPackets;
+    int _nextOverflowPacket;
+
     uint64_t _lastSendTime;
     PacketSenderNotify* _notify;
 };
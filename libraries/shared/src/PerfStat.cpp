@@ -16,10 +16,12 @@
 
 #include <QtCore/QDebug>
 
+#include "Metrics.h"
 #include "PerfStat.h"
 
 // Static class members initialization here!
 std::map<std::string,PerfStatHistory,std::less<std::string> > PerfStat::groupHistoryMap;
+pthread_mutex_t PerfStat::groupHistoryMapMutex = PTHREAD_MUTEX_INITIALIZER;
 bool PerfStat::wantDebugOut = false;
 timeval PerfStat::firstDumpTime;
 bool PerfStat::firstDumpTimeSet = false;
@@ -30,10 +32,12 @@ PerfStat::PerfStat(std::string groupName) {
 	gettimeofday(&this->start,NULL);
 
 	// If this is our first ever PerfStat object, we'll also initialize this
+	pthread_mutex_lock(&groupHistoryMapMutex);
 	if (!firstDumpTimeSet) {
 		gettimeofday(&firstDumpTime,NULL);
 		firstDumpTimeSet=true;
 	}
+	pthread_mutex_unlock(&groupHistoryMapMutex);
 }
 
 // Destructor handles recording all of our stats
@@ -45,10 +49,15 @@ PerfStat::~PerfStat() {
 	double average = elapsed;
 	double totalTime = elapsed;
 	long int count = 1;
+	MetricHistogram* histogram;
 	
 	// check to see if this group exists in the history...
+	pthread_mutex_lock(&groupHistoryMapMutex);
 	if (groupHistoryMap.find(group) == groupHistoryMap.end()) {
-		groupHistoryMap[group]=PerfStatHistory(group,elapsed,1);
+		// the group's timings also go to the metrics registry, for scraping
+		std::string metricName = "perfstat_" + group + "_usecs";
+		histogram = MetricsRegistry::getInstance()->getHistogram(metricName.c_str(), group.c_str());
+		groupHistoryMap[group]=PerfStatHistory(group,elapsed,1,histogram);
 	} else {
 		PerfStatHistory history = groupHistoryMap[group];
 		history.recordTime(elapsed);
@@ -56,7 +65,11 @@ PerfStat::~PerfStat() {
 		average = history.getAverage();
 		count = history.getCount();
 		totalTime = history.getTotalTime();
+		histogram = history.histogram;
 	}
+	pthread_mutex_unlock(&groupHistoryMapMutex);
+	
+	histogram->record(elapsed * 1000000.0);
 
 	if (wantDebugOut) {	
 		qDebug("PerfStats: %s elapsed:%f average:%lf count:%ld total:%lf ut:%ld us:%ld ue:%ld t:%ld s:%ld e:%ld\n",
@@ -69,7 +82,10 @@ PerfStat::~PerfStat() {
 
 // How many groups have we added?
 int PerfStat::getGroupCount() { 
-	return groupHistoryMap.size(); 
+	pthread_mutex_lock(&groupHistoryMapMutex);
+	int groupCount = groupHistoryMap.size();
+	pthread_mutex_unlock(&groupHistoryMapMutex);
+	return groupCount;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -78,6 +94,8 @@ int PerfStat::getGroupCount() {
 // Note: 		Caller is responsible for allocating an array of char*'s that is large enough to hold 
 //				groupCount + 1. Caller is also responsible for deleting all this memory.
 int PerfStat::DumpStats(char** array) {
+	pthread_mutex_lock(&groupHistoryMapMutex);
+
 	// If we haven't yet set a dump time, we'll also initialize this now, but this is unlikely
 	if (!firstDumpTimeSet) {
 		gettimeofday(&firstDumpTime,NULL);
@@ -100,6 +118,7 @@ int PerfStat::DumpStats(char** array) {
 			i->second.group.c_str(),i->second.getAverage(),i->second.getCount(),i->second.getTotalTime(),percent);
 		lineCount++;
 	}
+	pthread_mutex_unlock(&groupHistoryMapMutex);
 	return lineCount;
 }
 
@@ -24,9 +24,12 @@
 #endif
 
 #include <cstring>
+#include <pthread.h>
 #include <string>
 #include <map>
 
+class MetricHistogram;
+
 class PerfStatHistory {
 
 private:
@@ -34,10 +37,11 @@ private:
 	double totalTime;
 public:
 	std::string group;
+	MetricHistogram* histogram; // where the group's timings go in the metrics registry, looked up once per group
 	
-    PerfStatHistory(): count(0), totalTime(0.0) {}
-	PerfStatHistory(std::string myGroup, double initialTime, long int initialCount) :
-        count(initialCount), totalTime(initialTime), group(myGroup) {}
+    PerfStatHistory(): count(0), totalTime(0.0), histogram(NULL) {}
+	PerfStatHistory(std::string myGroup, double initialTime, long int initialCount, MetricHistogram* myHistogram) :
+        count(initialCount), totalTime(initialTime), group(myGroup), histogram(myHistogram) {}
     
 	void recordTime(double thisTime) { 
 		totalTime+=thisTime; 
@@ -64,6 +68,7 @@ public:
 class PerfStat {
 private:
 	static std::map<std::string,PerfStatHistory,std::less<std::string> > groupHistoryMap;
+	static pthread_mutex_t groupHistoryMapMutex; // PerfStats can be timing things on any thread
 	
 	static timeval firstDumpTime;
 	static bool firstDumpTimeSet;
@@ -12,6 +12,13 @@
 #include "ReceivedPacketProcessor.h"
 #include "SharedUtil.h"
 
+ReceivedPacketProcessor::ReceivedPacketProcessor(uint64_t idleWakeUsecs) :
+    _packets(RECEIVED_PACKET_QUEUE_SIZE),
+    _droppedPacketCount(0),
+    _idleWakeUsecs(idleWakeUsecs)
+{
+}
+
 void ReceivedPacketProcessor::queueReceivedPacket(sockaddr& address, unsigned char* packetData, ssize_t packetLength) {
     // Make sure our Node and NodeList knows we've heard from this node.
     Node* node = NodeList::getInstance()->nodeWithAddress(&address);
@@ -19,24 +26,21 @@ void ReceivedPacketProcessor::queueReceivedPacket(sockaddr& address, unsigned ch
         node->setLastHeardMicrostamp(usecTimestampNow());
     }
 
-    NetworkPacket packet(address, packetData, packetLength);
-    lock();
-    _packets.push_back(packet);
-    unlock();
+    // if we're that far behind, dropping the packet is better than holding up the network receive thread
+    if (!_packets.push(address, packetData, packetLength)) {
+        _droppedPacketCount.fetchAndAddRelaxed(1);
+    }
+    wakeUp();
 }
 
 bool ReceivedPacketProcessor::process() {
-    if (_packets.size() == 0) {
-        const uint64_t RECEIVED_THREAD_SLEEP_INTERVAL = (1000 * 1000)/60; // check at 60fps
-        usleep(RECEIVED_THREAD_SLEEP_INTERVAL);
+    if (_packets.isEmpty()) {
+        waitForWork(_idleWakeUsecs);
     }
-    while (_packets.size() > 0) {
-        NetworkPacket& packet = _packets.front();
-        processPacket(packet.getAddress(), packet.getData(), packet.getLength());
-
-        lock();
-        _packets.erase(_packets.begin());
-        unlock();
+    NetworkPacket* packet;
+    while ((packet = _packets.front())) {
+        processPacket(packet->getAddress(), packet->getData(), packet->getLength());
+        _packets.pop();
     }
     return isStillRunning();  // keep running till they terminate us
 }
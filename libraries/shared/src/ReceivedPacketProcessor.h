@@ -12,18 +12,28 @@
 #define __shared__ReceivedPacketProcessor__
 
 #include "GenericThread.h"
-#include "NetworkPacket.h"
+#include "NetworkPacketQueue.h"
+
+/// How many received packets can be waiting to be processed before we start dropping them
+const int RECEIVED_PACKET_QUEUE_SIZE = 1024;
 
 /// Generalized threaded processor for handling received inbound packets. 
 class ReceivedPacketProcessor : public virtual GenericThread {
 public:
+    /// \param uint64_t idleWakeUsecs how often to run process() when there are no packets, for subclasses that have other
+    /// work to do as well. By default an idle processor waits until a packet is queued.
+    ReceivedPacketProcessor(uint64_t idleWakeUsecs = WAIT_UNTIL_WOKEN);
 
-    /// Add packet from network receive thread to the processing queue.
+    /// Add packet from network receive thread to the processing queue, and wake up the processing thread. If the queue
+    /// is full the packet is dropped.
     /// \param sockaddr& senderAddress the address of the sender
     /// \param packetData pointer to received data
     /// \param ssize_t packetLength size of received data
     /// \thread network receive thread
     void queueReceivedPacket(sockaddr& senderAddress, unsigned char*  packetData, ssize_t packetLength);
+
+    /// How many received packets were dropped because the processing queue was full
+    int getDroppedPacketCount() const { return _droppedPacketCount.load(); }
     
 protected:
     /// Callback for processing of recieved packets. Implement this to process the incoming packets.
@@ -37,14 +47,16 @@ protected:
     virtual bool process();
 
     /// Are there received packets waiting to be processed
-    bool hasPacketsToProcess() const { return _packets.size() > 0; }
+    bool hasPacketsToProcess() const { return !_packets.isEmpty(); }
 
     /// How many received packets waiting are to be processed
     int packetsToProcessCount() const { return _packets.size(); }
 
 private:
 
-    std::vector<NetworkPacket> _packets;
+    NetworkPacketQueue _packets;
+    QAtomicInt _droppedPacketCount;
+    uint64_t _idleWakeUsecs;
 };
 
 #endif // __shared__PacketReceiver__
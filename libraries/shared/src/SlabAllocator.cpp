@@ -0,0 +1,57 @@
+//
+//  SlabAllocator.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Fixed size element allocator that carves elements out of large contiguous slabs.
+//
+
+#include "SlabAllocator.h"
+
+SlabAllocator::SlabAllocator(size_t elementSize, int elementsPerSlab) :
+    _elementsPerSlab(elementsPerSlab),
+    _freeList(NULL),
+    _elementsInUse(0)
+{
+    // free elements store the free list link in their first bytes, so they must be able to hold (and be aligned for) a
+    // pointer. Round up to the largest of pointer and double alignment so that any element type is suitably aligned.
+    const size_t ALIGNMENT = sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double);
+    _elementSize = ((elementSize + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    pthread_mutex_init(&_mutex, 0);
+}
+
+void SlabAllocator::addSlab() {
+    char* slab = new char[_elementSize * _elementsPerSlab];
+    _slabs.push_back(slab);
+
+    // thread the new elements onto the free list in address order, so that consecutive allocations are adjacent
+    for (int i = _elementsPerSlab - 1; i >= 0; i--) {
+        void* element = slab + (i * _elementSize);
+        *(void**)element = _freeList;
+        _freeList = element;
+    }
+}
+
+void* SlabAllocator::allocate() {
+    pthread_mutex_lock(&_mutex);
+    if (!_freeList) {
+        addSlab();
+    }
+    void* element = _freeList;
+    _freeList = *(void**)element;
+    _elementsInUse++;
+    pthread_mutex_unlock(&_mutex);
+    return element;
+}
+
+void SlabAllocator::free(void* element) {
+    if (element) {
+        pthread_mutex_lock(&_mutex);
+        *(void**)element = _freeList;
+        _freeList = element;
+        _elementsInUse--;
+        pthread_mutex_unlock(&_mutex);
+    }
+}
@@ -0,0 +1,54 @@
+//
+//  SlabAllocator.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Fixed size element allocator that carves elements out of large contiguous slabs.
+//
+
+#ifndef __shared__SlabAllocator__
+#define __shared__SlabAllocator__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <vector>
+
+/// Hands out fixed size elements from large contiguous slabs, and recycles freed elements through a free list. Elements
+/// allocated back to back end up next to each other in memory, which keeps tree traversals from chasing pointers all over
+/// the heap. Slabs are never returned to the system, so an allocator is expected to live for the life of the process.
+/// All methods are thread safe.
+class SlabAllocator {
+public:
+    /// \param size_t elementSize the size in bytes of each element, rounded up to pointer alignment.
+    /// \param int elementsPerSlab the number of elements to allocate each time the allocator runs out of free elements.
+    SlabAllocator(size_t elementSize, int elementsPerSlab);
+
+    /// Returns storage for a single element.
+    void* allocate();
+
+    /// Returns an element previously handed out by allocate() to the free list.
+    void free(void* element);
+
+    size_t getElementSize() const { return _elementSize; }
+    unsigned long getElementsInUse() const { return _elementsInUse; }
+    unsigned long getBytesAllocated() const { return _slabs.size() * _elementsPerSlab * _elementSize; }
+
+private:
+    // intentionally not implemented, allocators are never copied or destroyed
+    SlabAllocator(const SlabAllocator&);
+    SlabAllocator& operator= (const SlabAllocator&);
+    ~SlabAllocator();
+
+    void addSlab();
+
+    size_t              _elementSize;
+    int                 _elementsPerSlab;
+    void*               _freeList;
+    unsigned long       _elementsInUse;
+    std::vector<char*>  _slabs;
+    pthread_mutex_t     _mutex;
+};
+
+#endif // __shared__SlabAllocator__
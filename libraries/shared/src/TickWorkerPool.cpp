@@ -0,0 +1,107 @@
+//
+//  TickWorkerPool.cpp
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  A fixed pool of threads that work through each tick's items together.
+//
+
+#include <algorithm>
+
+#include "TickWorkerPool.h"
+
+TickWorkerPool::TickWorkerPool(int numThreads) :
+    _nextThreadIndex(1),
+    _tickNumber(0),
+    _numThreadsWorking(0),
+    _isStopping(false),
+    _numItems(0),
+    _nextItem(0)
+{
+    pthread_mutex_init(&_tickMutex, NULL);
+    pthread_cond_init(&_tickStartedCondition, NULL);
+    pthread_cond_init(&_tickFinishedCondition, NULL);
+
+    _threads.resize(std::max(numThreads, 1) - 1);
+    for (int i = 0; i < _threads.size(); i++) {
+        pthread_create(&_threads[i], NULL, workerThreadEntry, (void*) this);
+    }
+}
+
+TickWorkerPool::~TickWorkerPool() {
+    pthread_mutex_lock(&_tickMutex);
+    _isStopping = true;
+    pthread_cond_broadcast(&_tickStartedCondition);
+    pthread_mutex_unlock(&_tickMutex);
+
+    for (int i = 0; i < _threads.size(); i++) {
+        pthread_join(_threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&_tickFinishedCondition);
+    pthread_cond_destroy(&_tickStartedCondition);
+    pthread_mutex_destroy(&_tickMutex);
+}
+
+void TickWorkerPool::runTick(int numItems) {
+    pthread_mutex_lock(&_tickMutex);
+    _numItems = numItems;
+    _nextItem.store(0);
+    _numThreadsWorking = _threads.size();
+    _tickNumber++;
+    pthread_cond_broadcast(&_tickStartedCondition);
+    pthread_mutex_unlock(&_tickMutex);
+
+    workItems(0);
+
+    pthread_mutex_lock(&_tickMutex);
+    while (_numThreadsWorking > 0) {
+        pthread_cond_wait(&_tickFinishedCondition, &_tickMutex);
+    }
+    pthread_mutex_unlock(&_tickMutex);
+}
+
+void* TickWorkerPool::workerThreadEntry(void* pool) {
+    TickWorkerPool* workerPool = (TickWorkerPool*) pool;
+    workerPool->workerThreadLoop(workerPool->_nextThreadIndex.fetchAndAddOrdered(1));
+    return NULL;
+}
+
+void TickWorkerPool::workerThreadLoop(int threadIndex) {
+    int lastTickNumber = 0;
+
+    pthread_mutex_lock(&_tickMutex);
+
+    while (true) {
+        while (_tickNumber == lastTickNumber && !_isStopping) {
+            pthread_cond_wait(&_tickStartedCondition, &_tickMutex);
+        }
+
+        if (_isStopping) {
+            break;
+        }
+
+        lastTickNumber = _tickNumber;
+        pthread_mutex_unlock(&_tickMutex);
+
+        workItems(threadIndex);
+
+        pthread_mutex_lock(&_tickMutex);
+        if (--_numThreadsWorking == 0) {
+            pthread_cond_signal(&_tickFinishedCondition);
+        }
+    }
+
+    pthread_mutex_unlock(&_tickMutex);
+}
+
+void TickWorkerPool::workItems(int threadIndex) {
+    int itemIndex;
+    while ((itemIndex = _nextItem.fetchAndAddRelaxed(1)) < _numItems) {
+        workItem(threadIndex, itemIndex);
+    }
+
+    finishTick(threadIndex);
+}
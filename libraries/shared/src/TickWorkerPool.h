@@ -0,0 +1,67 @@
+//
+//  TickWorkerPool.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  A fixed pool of threads that work through each tick's items together.
+//
+
+#ifndef __shared__TickWorkerPool__
+#define __shared__TickWorkerPool__
+
+#include <pthread.h>
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+
+/// Works through each tick's items across numThreads threads. The thread calling runTick() works too, so the pool starts
+/// numThreads - 1 threads of its own. Items are handed out one at a time, so a thread with expensive items doesn't hold
+/// the others up. Subclasses say what working an item means, usually with some state of their own for each thread.
+class TickWorkerPool {
+public:
+    TickWorkerPool(int numThreads);
+    virtual ~TickWorkerPool();
+
+    /// The number of threads working each tick, counting the one calling runTick()
+    int getNumThreads() const { return _threads.size() + 1; }
+
+protected:
+    /// Works through items 0 to numItems - 1 for this tick, returning once every thread is done with them
+    void runTick(int numItems);
+
+    /// Override this to work one of the tick's items. threadIndex is the calling thread's, from 0 to getNumThreads() - 1,
+    /// 0 being the thread calling runTick(), so it can be used to pick out the thread's own state.
+    /// \thread any of the pool's threads, no two with the same threadIndex at once
+    virtual void workItem(int threadIndex, int itemIndex) = 0;
+
+    /// Override this to do anything a thread needs to once it's run out of items for the tick
+    /// \thread any of the pool's threads, no two with the same threadIndex at once
+    virtual void finishTick(int threadIndex) { }
+
+private:
+    // intentionally not implemented
+    TickWorkerPool(const TickWorkerPool&);
+    TickWorkerPool& operator= (const TickWorkerPool&);
+
+    static void* workerThreadEntry(void* pool);
+    void workerThreadLoop(int threadIndex);
+    void workItems(int threadIndex);
+
+    std::vector<pthread_t> _threads;
+    QAtomicInt _nextThreadIndex;
+
+    pthread_mutex_t _tickMutex;
+    pthread_cond_t _tickStartedCondition;
+    pthread_cond_t _tickFinishedCondition;
+    int _tickNumber;
+    int _numThreadsWorking;
+    bool _isStopping;
+
+    // this tick's items, handed out to the threads through _nextItem
+    int _numItems;
+    QAtomicInt _nextItem;
+};
+
+#endif /* defined(__shared__TickWorkerPool__) */
@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cstdio>
 #include <errno.h>
@@ -275,6 +276,85 @@ int UDPSocket::send(sockaddr* destAddress, const void* data, size_t byteLength)
     return sent_bytes;
 }
 
+int UDPSocket::sendBatch(const UDPBatchPacket* packets, int packetCount) const {
+    int packetsSent = 0;
+    
+#ifdef __linux__
+    mmsghdr messages[MAX_BATCH_PACKETS];
+    iovec buffers[MAX_BATCH_PACKETS];
+    
+    int nextPacket = 0;
+    while (nextPacket < packetCount) {
+        int batchCount = std::min(packetCount - nextPacket, MAX_BATCH_PACKETS);
+        memset(messages, 0, batchCount * sizeof(mmsghdr));
+        
+        for (int i = 0; i < batchCount; i++) {
+            const UDPBatchPacket& packet = packets[nextPacket + i];
+            buffers[i].iov_base = packet.data;
+            buffers[i].iov_len = packet.byteLength;
+            messages[i].msg_hdr.msg_name = packet.address;
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &buffers[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        
+        int batchSent = sendmmsg(handle, messages, batchCount, 0);
+        if (batchSent > 0) {
+            packetsSent += batchSent;
+            nextPacket += batchSent;
+        } else {
+            // sendmmsg stops at the first packet that fails, drop it like send() would and carry on with the rest
+            qDebug("Failed to send packet: %s\n", strerror(errno));
+            nextPacket++;
+        }
+    }
+#else
+    for (int i = 0; i < packetCount; i++) {
+        if (send(packets[i].address, packets[i].data, packets[i].byteLength) == packets[i].byteLength) {
+            packetsSent++;
+        }
+    }
+#endif
+    
+    return packetsSent;
+}
+
+int UDPSocket::receiveBatch(UDPBatchPacket* packets, int maxPackets) const {
+#ifdef __linux__
+    mmsghdr messages[MAX_BATCH_PACKETS];
+    iovec buffers[MAX_BATCH_PACKETS];
+    
+    int batchCount = std::min(maxPackets, MAX_BATCH_PACKETS);
+    memset(messages, 0, batchCount * sizeof(mmsghdr));
+    
+    for (int i = 0; i < batchCount; i++) {
+        buffers[i].iov_base = packets[i].data;
+        buffers[i].iov_len = MAX_BUFFER_LENGTH_BYTES;
+        messages[i].msg_hdr.msg_name = packets[i].address;
+        messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        messages[i].msg_hdr.msg_iov = &buffers[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    // wait for the first packet if we're blocking, but only take the ones after it that are already here
+    int packetsReceived = recvmmsg(handle, messages, batchCount, MSG_WAITFORONE, NULL);
+    if (packetsReceived < 0) {
+        return 0;
+    }
+    
+    for (int i = 0; i < packetsReceived; i++) {
+        packets[i].byteLength = messages[i].msg_len;
+    }
+    return packetsReceived;
+#else
+    // without recvmmsg we can't take more than one packet without possibly blocking on the next
+    if (maxPackets > 0 && receive(packets[0].address, packets[0].data, &packets[0].byteLength)) {
+        return 1;
+    }
+    return 0;
+#endif
+}
+
 int UDPSocket::send(char* destAddress, int destPort, const void* data, size_t byteLength) const {
     
     // change address and port on reusable global to passed variables
@@ -18,6 +18,18 @@
 
 #define MAX_BUFFER_LENGTH_BYTES 1500
 
+/// The most datagrams UDPSocket::sendBatch() and UDPSocket::receiveBatch() hand to or take from the kernel in one call
+const int MAX_BATCH_PACKETS = 64;
+
+/// One datagram of a batch. When sending, address and data are the destination and contents of the packet. When
+/// receiving, they're where to put the sender's address and the packet, which has room for MAX_BUFFER_LENGTH_BYTES, and
+/// byteLength is filled in with the size of the packet.
+struct UDPBatchPacket {
+    sockaddr* address;
+    void* data;
+    ssize_t byteLength;
+};
+
 class UDPSocket {    
 public:
     UDPSocket(unsigned short int listeningPort);
@@ -35,6 +47,13 @@ public:
     
     bool receive(void* receivedData, ssize_t* receivedBytes) const;
     bool receive(sockaddr* recvAddress, void* receivedData, ssize_t* receivedBytes) const;
+
+    /// Sends all the packets with as few system calls as we can, returns how many of them were sent.
+    int sendBatch(const UDPBatchPacket* packets, int packetCount) const;
+
+    /// Receives up to maxPackets packets that are waiting on the socket. Only waits (if the socket is blocking) for the
+    /// first one. Returns how many were received.
+    int receiveBatch(UDPBatchPacket* packets, int maxPackets) const;
 private:
     int handle;
     unsigned short int _listeningPort;
@@ -0,0 +1,82 @@
+//
+//  UniformGrid.h
+//  shared
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Values bucketed into cubic cells by position.
+//
+
+#ifndef __shared__UniformGrid__
+#define __shared__UniformGrid__
+
+#include <math.h>
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QMultiHash>
+
+/// Buckets values into cubic cells by position, so a lookup only has to look at the values near a point. With cells as big
+/// as the furthest a lookup reaches, everything it can reach is in the point's own cell or the 26 around it.
+template<class T> class UniformGrid {
+public:
+    UniformGrid() : _cellSize(1.0f) { }
+
+    /// Empties the grid, making its cells cellSize on a side from now on
+    void clear(float cellSize);
+
+    /// Adds value to the cell holding position
+    void insert(const glm::vec3& position, const T& value);
+
+    /// Calls visitor(value) for each value in the cell holding position and the 26 cells around it
+    template<class Visitor> void visitNearby(const glm::vec3& position, Visitor& visitor) const;
+
+private:
+    quint64 cellKey(int x, int y, int z) const;
+
+    float _cellSize;
+    QMultiHash<quint64, T> _cells;
+};
+
+// each cell coordinate gets 21 bits of the key, cells further out than that wrap around, which only costs a lookup a few
+// extra values to look at
+const int UNIFORM_GRID_CELL_KEY_BITS = 21;
+const int UNIFORM_GRID_CELL_KEY_MASK = (1 << UNIFORM_GRID_CELL_KEY_BITS) - 1;
+
+template<class T> void UniformGrid<T>::clear(float cellSize) {
+    _cellSize = cellSize;
+    _cells.clear();
+}
+
+template<class T> void UniformGrid<T>::insert(const glm::vec3& position, const T& value) {
+    _cells.insert(cellKey(floorf(position.x / _cellSize), floorf(position.y / _cellSize), floorf(position.z / _cellSize)),
+                  value);
+}
+
+template<class T> template<class Visitor> void UniformGrid<T>::visitNearby(const glm::vec3& position,
+                                                                            Visitor& visitor) const {
+    int cellX = floorf(position.x / _cellSize);
+    int cellY = floorf(position.y / _cellSize);
+    int cellZ = floorf(position.z / _cellSize);
+
+    for (int x = cellX - 1; x <= cellX + 1; x++) {
+        for (int y = cellY - 1; y <= cellY + 1; y++) {
+            for (int z = cellZ - 1; z <= cellZ + 1; z++) {
+                quint64 key = cellKey(x, y, z);
+                for (typename QMultiHash<quint64, T>::const_iterator value = _cells.constFind(key);
+                     value != _cells.constEnd() && value.key() == key; value++) {
+                    visitor(*value);
+                }
+            }
+        }
+    }
+}
+
+template<class T> quint64 UniformGrid<T>::cellKey(int x, int y, int z) const {
+    return ((quint64) (x & UNIFORM_GRID_CELL_KEY_MASK) << (2 * UNIFORM_GRID_CELL_KEY_BITS))
+        | ((quint64) (y & UNIFORM_GRID_CELL_KEY_MASK) << UNIFORM_GRID_CELL_KEY_BITS)
+        | (quint64) (z & UNIFORM_GRID_CELL_KEY_MASK);
+}
+
+#endif /* defined(__shared__UniformGrid__) */
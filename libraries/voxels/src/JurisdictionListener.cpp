@@ -17,7 +17,8 @@
 
 
 JurisdictionListener::JurisdictionListener(PacketSenderNotify* notify) : 
-    PacketSender(notify, JurisdictionListener::DEFAULT_PACKETS_PER_SECOND)
+    PacketSender(notify, JurisdictionListener::DEFAULT_PACKETS_PER_SECOND),
+    ReceivedPacketProcessor(JURISDICTION_REQUEST_INTERVAL_USECS) // wake up to send our requests even if no one answers
 {
     NodeList* nodeList = NodeList::getInstance();
     nodeList->addHook(this);
@@ -80,10 +81,14 @@ bool JurisdictionListener::process() {
     // If we're still running, and we don't have any requests waiting to be sent, then queue our jurisdiction requests
     if (continueProcessing && !hasPacketsToSend()) {
         queueJurisdictionRequest();
-        continueProcessing = PacketSender::process();
+
+        // if there are no voxel servers to ask, there's nothing to send, and the PacketSender would wait for a packet
+        if (hasPacketsToSend()) {
+            continueProcessing = PacketSender::process();
+        }
     }
     if (continueProcessing) {
-        // NOTE: This will sleep if there are no pending packets to process
+        // NOTE: This will wait for up to JURISDICTION_REQUEST_INTERVAL_USECS if there are no pending packets to process
         continueProcessing = ReceivedPacketProcessor::process();
     }
     return continueProcessing;
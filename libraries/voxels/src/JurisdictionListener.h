@@ -17,6 +17,9 @@
 
 #include "JurisdictionMap.h"
 
+/// How often we ask the voxel servers for their jurisdictions when we haven't heard from any of them
+const uint64_t JURISDICTION_REQUEST_INTERVAL_USECS = 1000 * 1000;
+
 /// Sends out PACKET_TYPE_VOXEL_JURISDICTION_REQUEST packets to all voxel servers and then listens for and processes
 /// the PACKET_TYPE_VOXEL_JURISDICTION packets it receives in order to maintain an accurate state of all jurisidictions
 /// within the domain. As with other ReceivedPacketProcessor classes the user is responsible for reading inbound packets
@@ -26,7 +26,7 @@ JurisdictionMap& JurisdictionMap::operator=(const JurisdictionMap& other) {
 
 #ifdef HAS_MOVE_SEMANTICS
 // Move constructor
-JurisdictionMap::JurisdictionMap(JurisdictionMap&& other) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(JurisdictionMap&& other) : _rootOctalCode(NULL), _keysAreValid(false) {
     init(other._rootOctalCode, other._endNodes);
     other._rootOctalCode = NULL;
     other._endNodes.clear();
@@ -42,7 +42,7 @@ JurisdictionMap& JurisdictionMap::operator=(JurisdictionMap&& other) {
 #endif
 
 // Copy constructor
-JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL), _keysAreValid(false) {
     copyContents(other);
 }
 
@@ -89,9 +89,11 @@ void JurisdictionMap::clear() {
         }
     }
     _endNodes.clear();
+    _endNodeKeys.clear();
+    _keysAreValid = false;
 }
 
-JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL), _keysAreValid(false) {
     unsigned char* rootCode = new unsigned char[1];
     *rootCode = 0;
     
@@ -99,17 +101,17 @@ JurisdictionMap::JurisdictionMap() : _rootOctalCode(NULL) {
     init(rootCode, emptyEndNodes);
 }
 
-JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL), _keysAreValid(false) {
     clear(); // clean up our own memory
     readFromFile(filename);
 }
 
 JurisdictionMap::JurisdictionMap(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes)  
-    : _rootOctalCode(NULL) {
+    : _rootOctalCode(NULL), _keysAreValid(false) {
     init(rootOctalCode, endNodes);
 }
 
-JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) {
+JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) : _keysAreValid(false) {
     _rootOctalCode = hexStringToOctalCode(QString(rootHexCode));
     
     QString endNodesHexStrings(endNodesHexCodes);
@@ -123,6 +125,7 @@ JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHe
         //printOctalCode(endNodeOctcode);
         _endNodes.push_back(endNodeOctcode);
     }    
+    updateKeys();
 }
 
 
@@ -130,6 +133,43 @@ void JurisdictionMap::init(unsigned char* rootOctalCode, const std::vector<unsig
     clear(); // clean up our own memory
     _rootOctalCode = rootOctalCode;
     _endNodes = endNodes;
+    updateKeys();
+}
+
+void JurisdictionMap::updateKeys() {
+    _endNodeKeys.clear();
+    _keysAreValid = _rootOctalCode && octalCodeToMortonKey(_rootOctalCode, _rootKey);
+    for (int i = 0; _keysAreValid && i < _endNodes.size(); i++) {
+        MortonKey endNodeKey;
+        _keysAreValid = _endNodes[i] && octalCodeToMortonKey(_endNodes[i], endNodeKey);
+        _endNodeKeys.push_back(endNodeKey);
+    }
+}
+
+JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const MortonKey& nodeKey, int childIndex) const {
+    if (!_keysAreValid) {
+        // some of our codes are too deep for keys, so fall back to comparing octal codes
+        unsigned char nodeOctalCode[MAX_MORTON_KEY_OCTAL_CODE_BYTES];
+        mortonKeyToOctalCode(nodeKey, nodeOctalCode);
+        return isMyJurisdiction(nodeOctalCode, childIndex);
+    }
+
+    // if the node is an ancestor of my root, then we return ABOVE
+    if (isAncestorOf(nodeKey, _rootKey)) {
+        return ABOVE;
+    }
+    
+    // otherwise, we must be under the root, and not under any of the endpoints
+    bool isInJurisdiction = isAncestorOf(_rootKey, nodeKey, childIndex);
+    if (isInJurisdiction) {
+        for (int i = 0; i < _endNodeKeys.size(); i++) {
+            if (isAncestorOf(_endNodeKeys[i], nodeKey)) {
+                isInJurisdiction = false;
+                break;
+            }
+        }
+    }
+    return isInJurisdiction ? WITHIN : BELOW;
 }
 
 JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(unsigned char* nodeOctalCode, int childIndex) const {
@@ -179,6 +219,7 @@ bool JurisdictionMap::readFromFile(const char* filename) {
         _endNodes.push_back(octcode);
     }
     settings.endGroup();
+    updateKeys();
     return true;
 }
 
@@ -301,6 +342,7 @@ int JurisdictionMap::unpackFromMessage(unsigned char* sourceBuffer, int availabl
             }
         }
     }
+    updateKeys();
     
     return sourceBuffer - startPosition; // includes header!
 }
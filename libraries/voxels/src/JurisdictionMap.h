@@ -14,6 +14,8 @@
 #include <vector>
 #include <QtCore/QString>
 
+#include <OctalCode.h>
+
 class JurisdictionMap {
 public:
     enum Area {
@@ -42,6 +44,7 @@ public:
     ~JurisdictionMap();
 
     Area isMyJurisdiction(unsigned char* nodeOctalCode, int childIndex) const;
+    Area isMyJurisdiction(const MortonKey& nodeKey, int childIndex) const;
 
     bool writeToFile(const char* filename);
     bool readFromFile(const char* filename);
@@ -64,9 +67,16 @@ private:
     void copyContents(const JurisdictionMap& other); // use assignment instead
     void clear();
     void init(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes);
+    void updateKeys();
 
     unsigned char* _rootOctalCode;
     std::vector<unsigned char*> _endNodes;
+
+    // MortonKey versions of the root and end node codes, so that the encoder can check jurisdiction without going
+    // through the byte codes. Only valid if all of the codes fit in a key.
+    MortonKey _rootKey;
+    std::vector<MortonKey> _endNodeKeys;
+    bool _keysAreValid;
 };
 
 /// Map between node IDs and their reported JurisdictionMap. Typically used by classes that need to know which nodes are 
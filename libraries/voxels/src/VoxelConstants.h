@@ -14,6 +14,7 @@
 
 #include <limits.h>
 #include <OctalCode.h>
+#include <PacketHeaders.h>
 #include <glm/glm.hpp>
 
 // this is where the coordinate system is represented
@@ -44,4 +45,16 @@ const float VIEW_CULLING_RATE_IN_MILLISECONDS = 1000.0f; // once a second is fin
 
 const uint64_t CLIENT_TO_SERVER_VOXEL_SEND_INTERVAL_USECS = 1000 * 5; // 1 packet every 50 milliseconds
 
+// voxel data packets carry a sequence number right after their header, which clients echo back in their acks
+typedef uint16_t VOXEL_PACKET_SEQUENCE;
+const uint64_t VOXEL_PACKET_ACK_INTERVAL_USECS = 1000 * 50; // clients ack voxel packets every 50 milliseconds
+
+// followed by a byte of flags about how the voxel data in the rest of the packet is packed
+typedef unsigned char VOXEL_PACKET_FLAGS;
+const int VOXEL_PACKET_COMPRESSED_BIT = 0; // voxel data is zlib compressed
+
+const int MAX_VOXEL_PACKET_DATA_SIZE = MAX_VOXEL_PACKET_SIZE
+    - (MAX_PACKET_HEADER_BYTES + sizeof(VOXEL_PACKET_SEQUENCE) + sizeof(VOXEL_PACKET_FLAGS));
+const int MAX_UNCOMPRESSED_VOXEL_PACKET_DATA_SIZE = MAX_VOXEL_PACKET_DATA_SIZE * 4; // what a compressed packet can unpack to
+
 #endif
\ No newline at end of file
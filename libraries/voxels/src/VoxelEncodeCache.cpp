@@ -0,0 +1,126 @@
+//
+//  VoxelEncodeCache.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Cache of encoded subtree bitstreams that can be shared between all the clients of a voxel server.
+//
+
+#include <cstring>
+
+#include <QDebug>
+
+#include "VoxelEncodeCache.h"
+#include "VoxelNode.h"
+#include "VoxelTree.h" // for boundaryDistanceForRenderLevel()
+
+bool VoxelEncodeCache::Key::operator<(const Key& other) const {
+    if (nodeKey != other.nodeKey) {
+        return nodeKey < other.nodeKey;
+    }
+    if (includeColor != other.includeColor) {
+        return includeColor < other.includeColor;
+    }
+    return includeExistsBits < other.includeExistsBits;
+}
+
+VoxelEncodeCache::VoxelEncodeCache(unsigned long maxBytes) :
+    _maxBytes(maxBytes),
+    _bytesUsed(0),
+    _hits(0),
+    _misses(0),
+    _evictions(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+VoxelEncodeCache::~VoxelEncodeCache() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+int VoxelEncodeCache::lookup(const VoxelNode* node, bool includeColor, bool includeExistsBits, float furthestDistance,
+                             int boundaryLevelAdjust, unsigned char* outputBuffer, int availableBytes,
+                             int& deepestChildLevel) {
+    Key key = { node->getKey(), includeColor, includeExistsBits };
+    int bytesCopied = -1;
+
+    pthread_mutex_lock(&_mutex);
+    EntryMap::iterator entry = _entries.find(key);
+    if (entry != _entries.end()) {
+        if (entry->second.lastChanged != node->getSubtreeLastChanged()) {
+            // the subtree has changed since we encoded it, so this one is no good to anyone anymore
+            removeEntry(entry);
+        } else if (furthestDistance < boundaryDistanceForRenderLevel(entry->second.deepestChildLevel + 1 + boundaryLevelAdjust)
+                   && (int)entry->second.encoded.size() <= availableBytes) {
+            bytesCopied = entry->second.encoded.size();
+            memcpy(outputBuffer, &entry->second.encoded[0], bytesCopied);
+            deepestChildLevel = entry->second.deepestChildLevel;
+
+            // move it to the front of the recently used list
+            _recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, entry->second.recentlyUsed);
+        }
+    }
+    if (bytesCopied >= 0) {
+        _hits++;
+    } else {
+        _misses++;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return bytesCopied;
+}
+
+void VoxelEncodeCache::store(const VoxelNode* node, bool includeColor, bool includeExistsBits,
+                             const unsigned char* encoded, int encodedBytes, int deepestChildLevel) {
+    Key key = { node->getKey(), includeColor, includeExistsBits };
+
+    pthread_mutex_lock(&_mutex);
+    EntryMap::iterator entry = _entries.find(key);
+    if (entry != _entries.end()) {
+        removeEntry(entry);
+    }
+
+    Entry newEntry;
+    newEntry.lastChanged = node->getSubtreeLastChanged();
+    newEntry.deepestChildLevel = deepestChildLevel;
+    newEntry.encoded.assign(encoded, encoded + encodedBytes);
+
+    // don't bother with anything that would take up more than a small part of the cache
+    const unsigned long MAX_ENTRY_PORTION = 16;
+    if (bytesForEntry(newEntry) <= _maxBytes / MAX_ENTRY_PORTION) {
+        _recentlyUsed.push_front(key);
+        newEntry.recentlyUsed = _recentlyUsed.begin();
+        _bytesUsed += bytesForEntry(newEntry);
+        _entries.insert(std::make_pair(key, newEntry));
+
+        // evict the least recently used entries till we're back under our cap
+        while (_bytesUsed > _maxBytes && !_recentlyUsed.empty()) {
+            removeEntry(_entries.find(_recentlyUsed.back()));
+            _evictions++;
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void VoxelEncodeCache::removeEntry(EntryMap::iterator entry) {
+    _bytesUsed -= bytesForEntry(entry->second);
+    _recentlyUsed.erase(entry->second.recentlyUsed);
+    _entries.erase(entry);
+}
+
+unsigned long VoxelEncodeCache::bytesForEntry(const Entry& entry) {
+    // roughly account for the map and list bookkeeping too, so lots of tiny entries still count against the cap
+    const unsigned long ENTRY_OVERHEAD_BYTES = sizeof(Key) * 2 + sizeof(Entry) + 8 * sizeof(void*);
+    return entry.encoded.size() + ENTRY_OVERHEAD_BYTES;
+}
+
+void VoxelEncodeCache::printDebugDetails() {
+    pthread_mutex_lock(&_mutex);
+    unsigned long lookups = _hits + _misses;
+    qDebug("VoxelEncodeCache: %lu entries, %lu of %lu bytes, %lu hits, %lu misses (%.1f%% hit rate), %lu evictions\n",
+           (unsigned long)_entries.size(), _bytesUsed, _maxBytes, _hits, _misses,
+           lookups == 0 ? 0.0f : (100.0f * _hits / lookups), _evictions);
+    pthread_mutex_unlock(&_mutex);
+}
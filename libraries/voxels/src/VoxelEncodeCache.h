@@ -0,0 +1,96 @@
+//
+//  VoxelEncodeCache.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Cache of encoded subtree bitstreams that can be shared between all the clients of a voxel server.
+//
+
+#ifndef __hifi__VoxelEncodeCache__
+#define __hifi__VoxelEncodeCache__
+
+#include <list>
+#include <map>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include <OctalCode.h>
+
+class VoxelNode;
+
+/// Subtrees smaller than this aren't worth the cache lookup
+const unsigned long MIN_ENCODE_CACHE_SUBTREE_NODES = 32;
+const unsigned long DEFAULT_ENCODE_CACHE_BYTES = 64 * 1024 * 1024;
+
+/// Caches the bitstreams that VoxelTree::encodeTreeBitstream() writes for subtrees whose encoding doesn't depend on the
+/// viewer, so clients near each other don't each have to re-encode the same subtrees. Entries are keyed by the subtree's
+/// node and the encode parameters that change its bitstream, and are only used while the subtree's last changed time still
+/// matches. When the cache grows past its memory cap, the least recently used entries are evicted. All methods are
+/// thread safe.
+class VoxelEncodeCache {
+public:
+    VoxelEncodeCache(unsigned long maxBytes = DEFAULT_ENCODE_CACHE_BYTES);
+    ~VoxelEncodeCache();
+
+    /// Looks for a cached encoding of the subtree below node.
+    /// \param float furthestDistance the distance from the viewer to the furthest corner of node, since the cached
+    ///        encoding is only the same as what the viewer would encode if every node in the subtree is within its LOD
+    /// \param int& deepestChildLevel returns the level of the deepest node in the cached subtree
+    /// \return the number of bytes copied to outputBuffer, or -1 if there was nothing usable that fit in availableBytes
+    int lookup(const VoxelNode* node, bool includeColor, bool includeExistsBits, float furthestDistance,
+               int boundaryLevelAdjust, unsigned char* outputBuffer, int availableBytes, int& deepestChildLevel);
+
+    /// Stores the complete encoding of the subtree below node, the caller is responsible for only storing encodings
+    /// that don't depend on the viewer.
+    void store(const VoxelNode* node, bool includeColor, bool includeExistsBits,
+               const unsigned char* encoded, int encodedBytes, int deepestChildLevel);
+
+    unsigned long getMaxBytes() const { return _maxBytes; }
+    unsigned long getBytesUsed() const { return _bytesUsed; }
+    unsigned long getEntryCount() const { return _entries.size(); }
+    unsigned long getHits() const { return _hits; }
+    unsigned long getMisses() const { return _misses; }
+    unsigned long getEvictions() const { return _evictions; }
+
+    void printDebugDetails();
+
+private:
+    // intentionally not implemented
+    VoxelEncodeCache(const VoxelEncodeCache&);
+    VoxelEncodeCache& operator= (const VoxelEncodeCache&);
+
+    struct Key {
+        MortonKey   nodeKey;
+        bool        includeColor;
+        bool        includeExistsBits;
+
+        bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+        uint64_t                    lastChanged;
+        int                         deepestChildLevel;
+        std::vector<unsigned char>  encoded;
+        std::list<Key>::iterator    recentlyUsed;
+    };
+
+    typedef std::map<Key, Entry> EntryMap;
+
+    void removeEntry(EntryMap::iterator entry);
+    static unsigned long bytesForEntry(const Entry& entry);
+
+    unsigned long   _maxBytes;
+    unsigned long   _bytesUsed;
+    EntryMap        _entries;
+    std::list<Key>  _recentlyUsed; // most recently used at the front
+    pthread_mutex_t _mutex;
+
+    unsigned long   _hits;
+    unsigned long   _misses;
+    unsigned long   _evictions;
+};
+
+#endif /* defined(__hifi__VoxelEncodeCache__) */
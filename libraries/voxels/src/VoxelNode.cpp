@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <stdio.h>
@@ -17,22 +18,72 @@
 #include "AABox.h"
 #include "OctalCode.h"
 #include "SharedUtil.h"
+#include "SlabAllocator.h"
 #include "VoxelConstants.h"
 #include "VoxelNode.h"
 #include "VoxelTree.h"
 
+// Nodes and their child blocks are carved out of large slabs. Children created together (which is how the tree is
+// usually built, by readBitstreamToTree() or readCodeColorBufferToTree()) land next to each other in memory, and the per
+// allocation overhead of the general heap goes away. The allocators are created on first use and never destroyed, since
+// there are global trees that are constructed and torn down during static initialization and exit.
+const int VOXEL_NODES_PER_SLAB = 4096;
+const int CHILD_BLOCKS_PER_SLAB = 1024;
+
+static SlabAllocator& nodeAllocator() {
+    static SlabAllocator* allocator = new SlabAllocator(sizeof(VoxelNode), VOXEL_NODES_PER_SLAB);
+    return *allocator;
+}
+
+// one allocator per child block size, index 0 holds blocks of one child pointer
+static SlabAllocator& childBlockAllocator(int childCount) {
+    static SlabAllocator* allocators[NUMBER_OF_CHILDREN] = { NULL };
+    if (!allocators[childCount - 1]) {
+        allocators[childCount - 1] = new SlabAllocator(childCount * sizeof(VoxelNode*), CHILD_BLOCKS_PER_SLAB);
+    }
+    return *allocators[childCount - 1];
+}
+
+void* VoxelNode::operator new(size_t size) {
+    return nodeAllocator().allocate();
+}
+
+void VoxelNode::operator delete(void* pointer) {
+    nodeAllocator().free(pointer);
+}
+
+VoxelNode** VoxelNode::allocateChildBlock(int childCount) {
+    return childCount ? (VoxelNode**)childBlockAllocator(childCount).allocate() : NULL;
+}
+
+void VoxelNode::freeChildBlock(VoxelNode** childBlock, int childCount) {
+    if (childBlock) {
+        childBlockAllocator(childCount).free(childBlock);
+    }
+}
+
+unsigned long VoxelNode::getNodeCount() {
+    return nodeAllocator().getElementsInUse();
+}
+
+unsigned long VoxelNode::getNodeMemoryUsage() {
+    unsigned long bytes = nodeAllocator().getBytesAllocated();
+    for (int i = 1; i <= NUMBER_OF_CHILDREN; i++) {
+        bytes += childBlockAllocator(i).getBytesAllocated();
+    }
+    return bytes;
+}
+
 VoxelNode::VoxelNode() {
-    unsigned char* rootCode = new unsigned char[1];
-    *rootCode = 0;
-    init(rootCode);
+    init(MortonKey()); // the root has an empty key
 }
 
-VoxelNode::VoxelNode(unsigned char * octalCode) {
-    init(octalCode);
+VoxelNode::VoxelNode(const MortonKey& key) {
+    init(key);
 }
 
-void VoxelNode::init(unsigned char * octalCode) {
-    _octalCode = octalCode;
+void VoxelNode::init(const MortonKey& key) {
+    _key = key;
     
 #ifndef NO_FALSE_COLOR // !NO_FALSE_COLOR means, does have false color
     _falseColored = false; // assume true color
@@ -41,10 +92,9 @@ void VoxelNode::init(unsigned char * octalCode) {
     _trueColor[0] = _trueColor[1] = _trueColor[2] = _trueColor[3] = 0;
     _density = 0.0f;
     
-    // default pointers to child nodes to NULL
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        _children[i] = NULL;
-    }
+    // no children, and so no child block
+    _children = NULL;
+    _childBitmask = 0;
     _childCount = 0;
     _subtreeNodeCount = 1; // that's me
     _subtreeLeafNodeCount = 0; // that's me
@@ -53,21 +103,63 @@ void VoxelNode::init(unsigned char * octalCode) {
     _voxelSystem = NULL;
     _isDirty = true;
     _shouldRender = false;
+    _deleteHooksNotified = false;
     _sourceID = UNKNOWN_NODE_ID;
     markWithChangedTime();
     calculateAABox();
 }
 
 VoxelNode::~VoxelNode() {
-    notifyDeleteHooks();
+    // if we're being deleted as part of an ancestor's subtree, the hooks have already heard about us
+    if (!_deleteHooksNotified) {
+        notifyDeleteHooks();
+    }
 
-    delete[] _octalCode;
-    
     // delete all of this node's children
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        if (_children[i]) {
-            delete _children[i];
+    deleteAllChildren();
+}
+
+void VoxelNode::deleteAllChildren() {
+    for (int i = 0; i < _childCount; i++) {
+        delete _children[i];
+    }
+    freeChildBlock(_children, _childCount);
+    _children = NULL;
+    _childBitmask = 0;
+    _childCount = 0;
+}
+
+// Inserts, replaces or (with a NULL child) removes the child at childIndex. The child block is reallocated to fit the new
+// child count, and the remaining children are kept in bit order.
+void VoxelNode::setChildAtIndex(int childIndex, VoxelNode* child) {
+    unsigned char mask = childIndexMask(childIndex);
+    int offset = childOffset(childIndex);
+    
+    if (_childBitmask & mask) {
+        if (child) {
+            _children[offset] = child;
+        } else {
+            VoxelNode** newChildren = allocateChildBlock(_childCount - 1);
+            if (newChildren) {
+                memcpy(newChildren, _children, offset * sizeof(VoxelNode*));
+                memcpy(newChildren + offset, _children + offset + 1, (_childCount - offset - 1) * sizeof(VoxelNode*));
+            }
+            freeChildBlock(_children, _childCount);
+            _children = newChildren;
+            _childBitmask &= ~mask;
+            _childCount--;
         }
+    } else if (child) {
+        VoxelNode** newChildren = allocateChildBlock(_childCount + 1);
+        if (_children) {
+            memcpy(newChildren, _children, offset * sizeof(VoxelNode*));
+            memcpy(newChildren + offset + 1, _children + offset, (_childCount - offset) * sizeof(VoxelNode*));
+        }
+        newChildren[offset] = child;
+        freeChildBlock(_children, _childCount);
+        _children = newChildren;
+        _childBitmask |= mask;
+        _childCount++;
     }
 }
 
@@ -78,14 +170,20 @@ VoxelNode::~VoxelNode() {
 // localized, because this method will get called for every node in an
 // recursive unwinding case like delete or add voxel
 void VoxelNode::handleSubtreeChanged(VoxelTree* myTree) {
-    markWithChangedTime();
-    
-    // here's a good place to do color re-averaging...
+    // here's a good place to do color re-averaging... this marks us as changed if our own color changes
     if (myTree->getShouldReaverage()) {
         setColorFromAverageOfChildren();
     }
     
     recalculateSubTreeNodeCount();
+    recalculateSubtreeLastChanged();
+}
+
+void VoxelNode::recalculateSubtreeLastChanged() {
+    _subtreeLastChanged = _lastChanged;
+    for (int i = 0; i < _childCount; i++) {
+        _subtreeLastChanged = std::max(_children[i]->_subtreeLastChanged, _subtreeLastChanged);
+    }
 }
 
 void VoxelNode::recalculateSubTreeNodeCount() {
@@ -95,11 +193,9 @@ void VoxelNode::recalculateSubTreeNodeCount() {
         _subtreeLeafNodeCount = 1;
     } else {
         _subtreeLeafNodeCount = 0;
-        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-            if (_children[i]) {
-                _subtreeNodeCount += _children[i]->_subtreeNodeCount;
-                _subtreeLeafNodeCount += _children[i]->_subtreeLeafNodeCount;
-            }
+        for (int i = 0; i < _childCount; i++) {
+            _subtreeNodeCount += _children[i]->_subtreeNodeCount;
+            _subtreeLeafNodeCount += _children[i]->_subtreeLeafNodeCount;
         }
     }
 }
@@ -120,58 +216,53 @@ void VoxelNode::calculateAABox() {
     glm::vec3 size;
     
     // copy corner into box
-    copyFirstVertexForCode(_octalCode,(float*)&corner);
+    copyFirstVertexForKey(_key, (float*)&corner);
     
     // this tells you the "size" of the voxel
-    float voxelScale = 1 / powf(2, *_octalCode);
+    float voxelScale = 1 / powf(2, _key.depth);
     size = glm::vec3(voxelScale,voxelScale,voxelScale);
     
     _box.setBox(corner,size);
 }
 
 void VoxelNode::deleteChildAtIndex(int childIndex) {
-    if (_children[childIndex]) {
-        delete _children[childIndex];
-        _children[childIndex] = NULL;
+    VoxelNode* childAt = getChildAtIndex(childIndex);
+    if (childAt) {
+        setChildAtIndex(childIndex, NULL);
+        delete childAt;
         _isDirty = true;
         markWithChangedTime();
-        _childCount--;
     }
 }
 
 // does not delete the node!
 VoxelNode* VoxelNode::removeChildAtIndex(int childIndex) {
-    VoxelNode* returnedChild = _children[childIndex];
-    if (_children[childIndex]) {
-        _children[childIndex] = NULL;
+    VoxelNode* returnedChild = getChildAtIndex(childIndex);
+    if (returnedChild) {
+        setChildAtIndex(childIndex, NULL);
         _isDirty = true;
         markWithChangedTime();
-        _childCount--;
     }
     return returnedChild;
 }
 
+// Note: nodes at MAX_MORTON_KEY_DEPTH can't have children, in which case this returns NULL
 VoxelNode* VoxelNode::addChildAtIndex(int childIndex) {
-    if (!_children[childIndex]) {
-        _children[childIndex] = new VoxelNode(childOctalCode(_octalCode, childIndex));
+    VoxelNode* childAt = getChildAtIndex(childIndex);
+    if (!childAt && _key.depth < MAX_MORTON_KEY_DEPTH) {
+        childAt = new VoxelNode(_key.childKey(childIndex));
+        setChildAtIndex(childIndex, childAt);
         _isDirty = true;
         markWithChangedTime();
-        _childCount++;
     }
-    return _children[childIndex];
+    return childAt;
 }
 
 // handles staging or deletion of all deep children
 void VoxelNode::safeDeepDeleteChildAtIndex(int childIndex) {
     VoxelNode* childToDelete = getChildAtIndex(childIndex);
     if (childToDelete) {
-        // If the child is not a leaf, then call ourselves recursively on all the children
-        if (!childToDelete->isLeaf()) {
-            // delete all it's children
-            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-                childToDelete->safeDeepDeleteChildAtIndex(i);
-            }
-        }
+        // deleting the child deletes all of its descendants too, and notifies the delete hooks about them in one batch
         deleteChildAtIndex(childIndex);
         _isDirty = true;
         markWithChangedTime();
@@ -182,16 +273,14 @@ void VoxelNode::safeDeepDeleteChildAtIndex(int childIndex) {
 void VoxelNode::setColorFromAverageOfChildren() {
     int colorArray[4] = {0,0,0,0};
     float density = 0.0f;
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        if (_children[i] && _children[i]->isColored()) {
+    for (int i = 0; i < _childCount; i++) {
+        if (_children[i]->isColored()) {
             for (int j = 0; j < 3; j++) {
                 colorArray[j] += _children[i]->getTrueColor()[j]; // color averaging should always be based on true colors
             }
             colorArray[3]++;
         }
-        if (_children[i]) {
-            density += _children[i]->getDensity();
-        }
+        density += _children[i]->getDensity();
     }
     density /= (float) NUMBER_OF_CHILDREN;    
     //
@@ -270,9 +359,13 @@ bool VoxelNode::collapseIdenticalLeaves() {
     // scan children, verify that they are ALL present and accounted for
     bool allChildrenMatch = true; // assume the best (ottimista)
     int red,green,blue;
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+    if (_childCount < NUMBER_OF_CHILDREN) {
+        allChildrenMatch = false;
+    }
+    for (int i = 0; allChildrenMatch && i < NUMBER_OF_CHILDREN; i++) {
         // if no child, child isn't a leaf, or child doesn't have a color
-        if (!_children[i] || !_children[i]->isLeaf() || !_children[i]->isColored()) {
+        // all children are present, so the child block is in index order
+        if (!_children[i]->isLeaf() || !_children[i]->isColored()) {
             allChildrenMatch=false;
             //qDebug("SADNESS child missing or not colored! i=%d\n",i);
             break;
@@ -292,11 +385,7 @@ bool VoxelNode::collapseIdenticalLeaves() {
     
     if (allChildrenMatch) {
         //qDebug("allChildrenMatch: pruning tree\n");
-        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-            delete _children[i]; // delete all the child nodes
-            _children[i]=NULL; // set it to NULL
-        }
-        _childCount = 0;
+        deleteAllChildren();
         nodeColor collapsedColor;
         collapsedColor[0]=red;        
         collapsedColor[1]=green;        
@@ -318,12 +407,7 @@ void VoxelNode::setRandomColor(int minimumBrightness) {
 }
 
 void VoxelNode::printDebugDetails(const char* label) const {
-    unsigned char childBits = 0;
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        if (_children[i]) {
-            setAtBit(childBits,i);            
-        }
-    }
+    unsigned char childBits = _childBitmask;
 
     qDebug("%s - Voxel at corner=(%f,%f,%f) size=%f\n isLeaf=%s isColored=%s (%d,%d,%d,%d) isDirty=%s shouldRender=%s\n children=", label,
         _box.getCorner().x, _box.getCorner().y, _box.getCorner().z, _box.getSize().x,
@@ -332,7 +416,9 @@ void VoxelNode::printDebugDetails(const char* label) const {
         
     outputBits(childBits, false);
     qDebug("\n octalCode=");
-    printOctalCode(_octalCode);
+    unsigned char octalCode[MAX_MORTON_KEY_OCTAL_CODE_BYTES];
+    copyOctalCode(octalCode);
+    printOctalCode(octalCode);
 }
 
 float VoxelNode::getEnclosingRadius() const {
@@ -419,7 +505,37 @@ void VoxelNode::removeDeleteHook(VoxelNodeDeleteHook* hook) {
 }
 
 void VoxelNode::notifyDeleteHooks() {
+    if (_hooks.empty()) {
+        return;
+    }
+    if (isLeaf()) {
+        for (int i = 0; i < _hooks.size(); i++) {
+            _hooks[i]->nodeDeleted(this);
+        }
+        return;
+    }
+
+    // Deleting a subtree would otherwise notify every hook about every node in it, so instead we gather up the whole
+    // subtree and hand it to each hook once. The descendants are marked, so they don't notify again as they're deleted.
+    std::vector<VoxelNode*> deletedNodes;
+    deletedNodes.reserve(_subtreeNodeCount);
+    deletedNodes.push_back(this);
+    for (size_t next = 0; next < deletedNodes.size(); next++) {
+        VoxelNode* node = deletedNodes[next];
+        node->_deleteHooksNotified = true;
+        for (int i = 0; i < node->_childCount; i++) {
+            deletedNodes.push_back(node->_children[i]);
+        }
+    }
+    std::sort(deletedNodes.begin(), deletedNodes.end());
+
     for (int i = 0; i < _hooks.size(); i++) {
-        _hooks[i]->nodeDeleted(this);
+        _hooks[i]->nodesDeleted(deletedNodes);
+    }
+}
+
+void VoxelNodeDeleteHook::nodesDeleted(const std::vector<VoxelNode*>& deletedNodes) {
+    for (size_t i = 0; i < deletedNodes.size(); i++) {
+        nodeDeleted(deletedNodes[i]);
     }
 }
\ No newline at end of file
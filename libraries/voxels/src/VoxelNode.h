@@ -9,6 +9,8 @@
 #ifndef __hifi__VoxelNode__
 #define __hifi__VoxelNode__
 
+#include <vector>
+
 #include <SharedUtil.h>
 #include "AABox.h"
 #include "ViewFrustum.h"
@@ -26,16 +28,31 @@ typedef unsigned char rgbColor[3];
 class VoxelNodeDeleteHook {
 public:
     virtual void nodeDeleted(VoxelNode* node) = 0;
+
+    /// Called once when a node with descendants is deleted, instead of nodeDeleted() for each node in its subtree.
+    /// deletedNodes is sorted by address, so hooks that only track a few nodes can check those against it rather than
+    /// visiting every deleted node. The default implementation calls nodeDeleted() for each node.
+    virtual void nodesDeleted(const std::vector<VoxelNode*>& deletedNodes);
 };
 
 class VoxelNode {
 public:
     VoxelNode(); // root node constructor
-    VoxelNode(unsigned char * octalCode); // regular constructor
+    VoxelNode(const MortonKey& key); // regular constructor
     ~VoxelNode();
+
+    // VoxelNodes are allocated from a slab pool rather than the general heap, see VoxelNode.cpp
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer);
     
-    unsigned char* getOctalCode() const { return _octalCode; }
-    VoxelNode* getChildAtIndex(int childIndex) const { return _children[childIndex]; }
+    const MortonKey& getKey() const { return _key; }
+    // writes this node's octal code into octalCodeBuffer, which should hold MAX_MORTON_KEY_OCTAL_CODE_BYTES, and returns
+    // the number of bytes written. Only needed when the code is going into a packet or file.
+    int copyOctalCode(unsigned char* octalCodeBuffer) const { return mortonKeyToOctalCode(_key, octalCodeBuffer); }
+    VoxelNode* getChildAtIndex(int childIndex) const {
+        return (_childBitmask & childIndexMask(childIndex)) ? _children[childOffset(childIndex)] : NULL;
+    }
+    unsigned char getChildBitmask() const { return _childBitmask; } // same bit order as setAtBit()/oneAtBit()
     void deleteChildAtIndex(int childIndex);
     VoxelNode* removeChildAtIndex(int childIndex);
     VoxelNode* addChildAtIndex(int childIndex);
@@ -48,8 +65,8 @@ public:
     const AABox& getAABox() const { return _box; }
     const glm::vec3& getCenter() const { return _box.getCenter(); }
     const glm::vec3& getCorner() const { return _box.getCorner(); }
-    float getScale() const { return _box.getSize().x; } // voxelScale = (1 / powf(2, *node->getOctalCode())); }
-    int getLevel() const { return *_octalCode + 1; } // one based or zero based? this doesn't correctly handle 2 byte case
+    float getScale() const { return _box.getSize().x; } // voxelScale = (1 / powf(2, node->getKey().depth)); }
+    int getLevel() const { return _key.depth + 1; } // one based
     
     float getEnclosingRadius() const;
     
@@ -71,8 +88,14 @@ public:
     bool isDirty() const { return _isDirty; }
     void clearDirtyBit() { _isDirty = false; }
     bool hasChangedSince(uint64_t time) const { return (_lastChanged > time); }
-    void markWithChangedTime() { _lastChanged = usecTimestampNow(); }
+    void markWithChangedTime() { _lastChanged = _subtreeLastChanged = usecTimestampNow(); }
     uint64_t getLastChanged() const { return _lastChanged; }
+
+    /// The subtree's changed time is the latest changed time of this node or any of its descendants, so the encoder can
+    /// skip an entire unchanged subtree without visiting it.
+    bool hasSubtreeChangedSince(uint64_t time) const { return (_subtreeLastChanged > time); }
+    uint64_t getSubtreeLastChanged() const { return _subtreeLastChanged; }
+    void recalculateSubtreeLastChanged();
     void handleSubtreeChanged(VoxelTree* myTree);
     
     glBufferIndex getBufferIndex() const { return _glBufferIndex; }
@@ -110,6 +133,9 @@ public:
 
     static void addDeleteHook(VoxelNodeDeleteHook* hook);
     static void removeDeleteHook(VoxelNodeDeleteHook* hook);
+
+    static unsigned long getNodeCount();
+    static unsigned long getNodeMemoryUsage(); // bytes reserved by the node and child block pools
     
     void recalculateSubTreeNodeCount();
     unsigned long getSubTreeNodeCount() const { return _subtreeNodeCount; }
@@ -118,9 +144,27 @@ public:
 
 private:
     void calculateAABox();
-    void init(unsigned char * octalCode);
+    void init(const MortonKey& key);
     void notifyDeleteHooks();
 
+    // children are stored in bit order, packed into a block of exactly _childCount pointers. The slot for a child is the
+    // number of children present with a lower index.
+    static unsigned char childIndexMask(int childIndex) { return (unsigned char)(0x80 >> childIndex); }
+    int childOffset(int childIndex) const { return numberOfOnes((unsigned char)(_childBitmask & ~(0xFF >> childIndex))); }
+    void setChildAtIndex(int childIndex, VoxelNode* child);
+    void deleteAllChildren();
+    static VoxelNode** allocateChildBlock(int childCount);
+    static void freeChildBlock(VoxelNode** childBlock, int childCount);
+
+    // hot traversal state first, so that it shares a cache line
+    VoxelNode**     _children;
+    unsigned char   _childBitmask;
+    unsigned char   _childCount;
+    AABox           _box;
+    MortonKey       _key;
+    uint64_t        _lastChanged;
+    uint64_t        _subtreeLastChanged;
+
     nodeColor _trueColor;
 #ifndef NO_FALSE_COLOR // !NO_FALSE_COLOR means, does have false color
     nodeColor _currentColor;
@@ -129,12 +173,8 @@ private:
     glBufferIndex   _glBufferIndex;
     VoxelSystem*    _voxelSystem;
     bool            _isDirty;
-    uint64_t        _lastChanged;
     bool            _shouldRender;
-    AABox           _box;
-    unsigned char*  _octalCode;
-    VoxelNode*      _children[8];
-    int             _childCount;
+    bool            _deleteHooksNotified; // set once the hooks have heard about our deletion as part of a subtree
     unsigned long   _subtreeNodeCount;
     unsigned long   _subtreeLeafNodeCount;
     float           _density;       // If leaf: density = 1, if internal node: 0-1 density of voxels inside
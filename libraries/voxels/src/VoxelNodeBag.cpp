@@ -6,13 +6,15 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
 #include "VoxelNodeBag.h"
+#include "ViewFrustum.h"
 #include <OctalCode.h>
 
-VoxelNodeBag::VoxelNodeBag() : 
-    _bagElements(NULL),
-    _elementsInUse(0),
-    _sizeOfElementsArray(0) {
+VoxelNodeBag::VoxelNodeBag() :
+    _priorityFunction(NULL),
+    _priorityExtraData(NULL) {
     VoxelNode::addDeleteHook(this);
 };
 
@@ -22,113 +24,142 @@ VoxelNodeBag::~VoxelNodeBag() {
 }
 
 void VoxelNodeBag::deleteAll() {
-    if (_bagElements) {
-        delete[] _bagElements;
+    _elements.clear();
+    _indexOfNode.clear();
+}
+
+// put a node into the bag
+void VoxelNodeBag::insert(VoxelNode* node) {
+    if (_indexOfNode.contains(node)) {
+        return; // already in the bag
+    }
+    Element element = { node, _priorityFunction ? _priorityFunction(node, _priorityExtraData) : 0.0f };
+    _elements.push_back(element);
+    _indexOfNode.insert(node, _elements.size() - 1);
+    if (_priorityFunction) {
+        siftUp(_elements.size() - 1);
     }
-    _bagElements = NULL;
-    _elementsInUse = 0;
-    _sizeOfElementsArray = 0;
 }
 
+// pull a node out of the bag (highest priority first, otherwise could come in any order)
+VoxelNode* VoxelNodeBag::extract() {
+    if (_elements.empty()) {
+        return NULL;
+    }
+    // with priorities the highest is at the top of the heap, otherwise the last node is the cheapest to pull out
+    int index = _priorityFunction ? 0 : _elements.size() - 1;
+    VoxelNode* node = _elements[index].node;
+    removeAt(index);
+    return node;
+}
 
-const int GROW_BAG_BY = 100;
+bool VoxelNodeBag::contains(VoxelNode* node) {
+    return _indexOfNode.contains(node);
+}
 
-// put a node into the bag
-void VoxelNodeBag::insert(VoxelNode* node) {
+void VoxelNodeBag::remove(VoxelNode* node) {
+    int index = _indexOfNode.value(node, -1);
+    if (index != -1) {
+        removeAt(index);
+    }
+}
 
-    // Search for where we should live in the bag (sorted)
-    // Note: change this to binary search... instead of linear!
-    int insertAt = _elementsInUse;
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            return; // exit early!!
+void VoxelNodeBag::setPriorityFunction(VoxelNodeBagPriority priorityFunction, void* extraData) {
+    _priorityFunction = priorityFunction;
+    _priorityExtraData = extraData;
+    if (_priorityFunction) {
+        // recalculate the priorities of everything already in the bag, and rebuild the heap from the bottom up
+        for (size_t i = 0; i < _elements.size(); i++) {
+            _elements[i].priority = _priorityFunction(_elements[i].node, _priorityExtraData);
         }
-        
-        if (_bagElements[i] > node) {
-            insertAt = i;
-            break;
+        for (int i = (int)_elements.size() / 2 - 1; i >= 0; i--) {
+            siftDown(i);
         }
     }
-    // at this point, inserAt will be the location we want to insert at.
-    
-    // If we don't have room in our bag, then grow the bag
-    if (_sizeOfElementsArray < _elementsInUse + 1) {
-        VoxelNode** oldBag = _bagElements;
-        _bagElements = new VoxelNode * [_sizeOfElementsArray + GROW_BAG_BY];
-        _sizeOfElementsArray += GROW_BAG_BY;
-        
-        // If we had an old bag...
-        if (oldBag) {
-            // copy old elements into the new bag, but leave a space where we need to
-            // insert the new node
-            memcpy(_bagElements, oldBag, insertAt * sizeof(VoxelNode*));
-            memcpy(&_bagElements[insertAt + 1], &oldBag[insertAt], (_elementsInUse - insertAt) * sizeof(VoxelNode*));
-            delete[] oldBag;
+}
+
+float VoxelNodeBag::coarsestLevelFirst(const VoxelNode* node, void* extraData) {
+    return -node->getLevel();
+}
+
+float VoxelNodeBag::nearestToCameraFirst(const VoxelNode* node, void* extraData) {
+    const ViewFrustum* viewFrustum = (const ViewFrustum*)extraData;
+    return -node->distanceToCamera(*viewFrustum);
+}
+
+void VoxelNodeBag::removeAt(int index) {
+    _indexOfNode.remove(_elements[index].node);
+
+    // fill the hole with the last element, so that the elements stay contiguous
+    Element last = _elements.back();
+    _elements.pop_back();
+    if (index < (int)_elements.size()) {
+        placeAt(index, last);
+        if (_priorityFunction) {
+            siftUp(index);
+            siftDown(_indexOfNode.value(last.node));
         }
-    } else {
-        // move existing elements further back in the bag array, leave a space where we need to
-        // insert the new node
-        memmove(&_bagElements[insertAt + 1], &_bagElements[insertAt], (_elementsInUse - insertAt) * sizeof(VoxelNode*));
     }
-    _bagElements[insertAt] = node;
-    _elementsInUse++;
 }
- 
-// pull a node out of the bag (could come in any order)
-VoxelNode* VoxelNodeBag::extract() {
-    // pull the last node out, and shrink our list...
-    if (_elementsInUse) {
-        
-        // get the last element
-        VoxelNode* node = _bagElements[_elementsInUse - 1];
-        
-        // reduce the count
-        _elementsInUse--;
-
-        return node;
-    }
-    return NULL;
+
+void VoxelNodeBag::placeAt(int index, const Element& element) {
+    _elements[index] = element;
+    _indexOfNode.insert(element.node, index);
 }
 
-bool VoxelNodeBag::contains(VoxelNode* node) {
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            return true; // exit early!!
-        }
-        // if we're past where it should be, then it's not here!
-        if (_bagElements[i] > node) {
-            return false;
+void VoxelNodeBag::siftUp(int index) {
+    Element element = _elements[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!(_elements[parent].priority < element.priority)) {
+            break;
         }
+        placeAt(index, _elements[parent]);
+        index = parent;
     }
-    // if we made it through the entire bag, it's not here!
-    return false;
+    placeAt(index, element);
 }
 
-void VoxelNodeBag::remove(VoxelNode* node) {
-    int foundAt = -1;
-    for (int i = 0; i < _elementsInUse; i++) {
-        // just compare the pointers... that's good enough
-        if (_bagElements[i] == node) {
-            foundAt = i;
+void VoxelNodeBag::siftDown(int index) {
+    int size = _elements.size();
+    Element element = _elements[index];
+    while (true) {
+        int child = index * 2 + 1;
+        if (child >= size) {
             break;
         }
-        // if we're past where it should be, then it's not here!
-        if (_bagElements[i] > node) {
+        if (child + 1 < size && _elements[child].priority < _elements[child + 1].priority) {
+            child++;
+        }
+        if (!(element.priority < _elements[child].priority)) {
             break;
         }
+        placeAt(index, _elements[child]);
+        index = child;
     }
-    // if we found it, then we need to remove it....
-    if (foundAt != -1) {
-        memmove(&_bagElements[foundAt], &_bagElements[foundAt + 1], (_elementsInUse - foundAt) * sizeof(VoxelNode*));
-        _elementsInUse--;
-    }
+    placeAt(index, element);
 }
 
-
 void VoxelNodeBag::nodeDeleted(VoxelNode* node) {
     remove(node); // note: remove can safely handle nodes that aren't in it, so we don't need to check contains()
 }
 
+void VoxelNodeBag::nodesDeleted(const std::vector<VoxelNode*>& deletedNodes) {
+    if (_elements.size() < deletedNodes.size()) {
+        // we're usually much smaller than a deleted subtree, so check our own nodes against it instead
+        std::vector<VoxelNode*> nodesToRemove;
+        for (size_t i = 0; i < _elements.size(); i++) {
+            if (std::binary_search(deletedNodes.begin(), deletedNodes.end(), _elements[i].node)) {
+                nodesToRemove.push_back(_elements[i].node);
+            }
+        }
+        for (size_t i = 0; i < nodesToRemove.size(); i++) {
+            remove(nodesToRemove[i]);
+        }
+    } else {
+        for (size_t i = 0; i < deletedNodes.size(); i++) {
+            remove(deletedNodes[i]);
+        }
+    }
+}
 
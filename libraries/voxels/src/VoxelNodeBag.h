@@ -7,15 +7,24 @@
 //
 //  This class is used by the VoxelTree:encodeTreeBitstream() functions to store extra nodes that need to be sent
 //  it's a generic bag style storage mechanism. But It has the property that you can't put the same node into the bag
-//  more than once (in other words, it de-dupes automatically), also, it supports collapsing it's several peer nodes
-//  into a parent node in cases where you add enough peers that it makes more sense to just add the parent.
+//  more than once (in other words, it de-dupes automatically). Inserting, removing and checking for nodes are constant
+//  time, and nodes can optionally be extracted in priority order.
 //
 
 #ifndef __hifi__VoxelNodeBag__
 #define __hifi__VoxelNodeBag__
 
+#include <vector>
+
+#include <QtCore/QHash>
+
 #include "VoxelNode.h"
 
+class ViewFrustum;
+
+/// Callback used to order the nodes extracted from a VoxelNodeBag, nodes with higher priority are extracted first.
+typedef float (*VoxelNodeBagPriority)(const VoxelNode* node, void* extraData);
+
 class VoxelNodeBag : public VoxelNodeDeleteHook {
 
 public:
@@ -23,25 +32,45 @@ public:
     ~VoxelNodeBag();
     
     void insert(VoxelNode* node); // put a node into the bag
-    VoxelNode* extract(); // pull a node out of the bag (could come in any order)
+    VoxelNode* extract(); // pull a node out of the bag (highest priority first, otherwise could come in any order)
     bool contains(VoxelNode* node); // is this node in the bag?
     void remove(VoxelNode* node); // remove a specific item from the bag
     
-    bool isEmpty() const { return (_elementsInUse == 0); }
-    int count() const { return _elementsInUse; }
+    bool isEmpty() const { return _elements.empty(); }
+    int count() const { return _elements.size(); }
 
     void deleteAll();
 
-    static void voxelNodeDeleteHook(VoxelNode* node, void* extraData);
+    /// Sets the order that nodes are extracted from the bag in. A node's priority is calculated when it's inserted, so
+    /// any nodes already in the bag are re-prioritized. Pass NULL to go back to extracting nodes in any order, which is
+    /// the cheapest.
+    void setPriorityFunction(VoxelNodeBagPriority priorityFunction, void* extraData = NULL);
+
+    /// Priority function that extracts the lowest resolution (shallowest) nodes first.
+    static float coarsestLevelFirst(const VoxelNode* node, void* extraData);
+
+    /// Priority function that extracts the nodes nearest to the camera first, extraData must be the ViewFrustum*
+    static float nearestToCameraFirst(const VoxelNode* node, void* extraData);
 
     virtual void nodeDeleted(VoxelNode* node);
+    virtual void nodesDeleted(const std::vector<VoxelNode*>& deletedNodes);
 
 private:
-    
-    VoxelNode** _bagElements;
-    int         _elementsInUse;
-    int         _sizeOfElementsArray;
-    int         _hookID;
+    struct Element {
+        VoxelNode*  node;
+        float       priority;
+    };
+
+    void removeAt(int index);
+    void placeAt(int index, const Element& element);
+    void siftUp(int index);
+    void siftDown(int index);
+
+    // when there's a priority function, the elements are kept as a binary max heap on priority
+    std::vector<Element>    _elements;
+    QHash<VoxelNode*, int>  _indexOfNode;
+    VoxelNodeBagPriority    _priorityFunction;
+    void*                   _priorityExtraData;
 };
 
 #endif /* defined(__hifi__VoxelNodeBag__) */
@@ -0,0 +1,85 @@
+//
+//  VoxelPacketCompressor.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Compresses and uncompresses the voxel data of compressed voxel packets.
+//
+
+#include <cstring>
+
+#include <QDebug>
+
+#include "VoxelPacketCompressor.h"
+
+// raw deflate streams, packets are small enough that zlib's own header and checksum would be a noticeable cost. An 8K
+// window covers all the voxel data a packet can hold, so that's all the history we need, and keeping it and the hash
+// tables small keeps the server's per client memory down.
+const int VOXEL_PACKET_WINDOW_BITS = -13;
+const int VOXEL_PACKET_MEMORY_LEVEL = 6;
+
+VoxelPacketCompressor::VoxelPacketCompressor() :
+    _isDeflateReady(false),
+    _isInflateReady(false)
+{
+    memset(&_deflateStream, 0, sizeof(_deflateStream));
+    memset(&_inflateStream, 0, sizeof(_inflateStream));
+}
+
+VoxelPacketCompressor::~VoxelPacketCompressor() {
+    if (_isDeflateReady) {
+        deflateEnd(&_deflateStream);
+    }
+    if (_isInflateReady) {
+        inflateEnd(&_inflateStream);
+    }
+}
+
+int VoxelPacketCompressor::compress(const unsigned char* data, int bytes, unsigned char* destination, int availableBytes) {
+    if (!_isDeflateReady) {
+        // speed matters more than the last few percent here, we compress every packet we send
+        if (deflateInit2(&_deflateStream, Z_BEST_SPEED, Z_DEFLATED, VOXEL_PACKET_WINDOW_BITS, VOXEL_PACKET_MEMORY_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            qDebug("VoxelPacketCompressor::compress() couldn't set up zlib\n");
+            return 0;
+        }
+        _isDeflateReady = true;
+    } else {
+        deflateReset(&_deflateStream);
+    }
+
+    _deflateStream.next_in = (Bytef*)data;
+    _deflateStream.avail_in = bytes;
+    _deflateStream.next_out = destination;
+    _deflateStream.avail_out = availableBytes;
+
+    // if it all went in and the stream is finished, it fit
+    if (deflate(&_deflateStream, Z_FINISH) != Z_STREAM_END) {
+        return 0;
+    }
+    return availableBytes - _deflateStream.avail_out;
+}
+
+int VoxelPacketCompressor::uncompress(const unsigned char* data, int bytes, unsigned char* destination, int availableBytes) {
+    if (!_isInflateReady) {
+        if (inflateInit2(&_inflateStream, VOXEL_PACKET_WINDOW_BITS) != Z_OK) {
+            qDebug("VoxelPacketCompressor::uncompress() couldn't set up zlib\n");
+            return -1;
+        }
+        _isInflateReady = true;
+    } else {
+        inflateReset(&_inflateStream);
+    }
+
+    _inflateStream.next_in = (Bytef*)data;
+    _inflateStream.avail_in = bytes;
+    _inflateStream.next_out = destination;
+    _inflateStream.avail_out = availableBytes;
+
+    if (inflate(&_inflateStream, Z_FINISH) != Z_STREAM_END) {
+        return -1;
+    }
+    return availableBytes - _inflateStream.avail_out;
+}
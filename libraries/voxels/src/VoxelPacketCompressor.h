@@ -0,0 +1,43 @@
+//
+//  VoxelPacketCompressor.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Compresses and uncompresses the voxel data of compressed voxel packets.
+//
+
+#ifndef __hifi__VoxelPacketCompressor__
+#define __hifi__VoxelPacketCompressor__
+
+#include <zlib.h>
+
+/// Compresses or uncompresses the voxel data of voxel packets sent with the VOXEL_PACKET_COMPRESSED_BIT flag, as raw
+/// deflate streams. Neighboring voxels tend to share colors and child masks, so voxel data compresses well. Each
+/// compressor keeps its zlib state around and resets it between packets, rather than allocating it for every packet.
+/// Not thread safe, so each thread should use its own.
+class VoxelPacketCompressor {
+public:
+    VoxelPacketCompressor();
+    ~VoxelPacketCompressor();
+
+    /// Compresses voxel data, returns the compressed size, or 0 if it doesn't fit in availableBytes.
+    int compress(const unsigned char* data, int bytes, unsigned char* destination, int availableBytes);
+
+    /// Uncompresses voxel data, returns the uncompressed size, or -1 if the data is corrupt or doesn't fit in
+    /// availableBytes.
+    int uncompress(const unsigned char* data, int bytes, unsigned char* destination, int availableBytes);
+
+private:
+    // intentionally not implemented
+    VoxelPacketCompressor(const VoxelPacketCompressor&);
+    VoxelPacketCompressor& operator= (const VoxelPacketCompressor&);
+
+    z_stream _deflateStream;
+    z_stream _inflateStream;
+    bool _isDeflateReady;
+    bool _isInflateReady;
+};
+
+#endif /* defined(__hifi__VoxelPacketCompressor__) */
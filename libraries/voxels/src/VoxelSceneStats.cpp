@@ -133,6 +133,10 @@ void VoxelSceneStats::reset() {
     _existsInPacketBitsWritten = 0;
     _treesRemoved = 0;
 
+    _encodeCacheHits = 0;
+    _encodeCacheMisses = 0;
+    _encodeCacheBytes = 0;
+
     if (_jurisdictionRoot) {
         delete[] _jurisdictionRoot;
         _jurisdictionRoot = NULL;
@@ -245,6 +249,15 @@ void VoxelSceneStats::childBitsRemoved(bool includesExistsBits, bool includesCol
     _treesRemoved++;
 }
 
+void VoxelSceneStats::encodeCacheHit(int bytes) {
+    _encodeCacheHits++;
+    _encodeCacheBytes += bytes;
+}
+
+void VoxelSceneStats::encodeCacheMiss() {
+    _encodeCacheMisses++;
+}
+
 int VoxelSceneStats::packIntoMessage(unsigned char* destinationBuffer, int availableBytes) {
     unsigned char* bufferStart = destinationBuffer;
     
@@ -312,6 +325,12 @@ int VoxelSceneStats::packIntoMessage(unsigned char* destinationBuffer, int avail
     destinationBuffer += sizeof(_existsInPacketBitsWritten);
     memcpy(destinationBuffer, &_treesRemoved, sizeof(_treesRemoved));
     destinationBuffer += sizeof(_treesRemoved);
+    memcpy(destinationBuffer, &_encodeCacheHits, sizeof(_encodeCacheHits));
+    destinationBuffer += sizeof(_encodeCacheHits);
+    memcpy(destinationBuffer, &_encodeCacheMisses, sizeof(_encodeCacheMisses));
+    destinationBuffer += sizeof(_encodeCacheMisses);
+    memcpy(destinationBuffer, &_encodeCacheBytes, sizeof(_encodeCacheBytes));
+    destinationBuffer += sizeof(_encodeCacheBytes);
 
     // add the root jurisdiction
     if (_jurisdictionRoot) {
@@ -431,6 +450,12 @@ int VoxelSceneStats::unpackFromMessage(unsigned char* sourceBuffer, int availabl
     sourceBuffer += sizeof(_existsInPacketBitsWritten);
     memcpy(&_treesRemoved, sourceBuffer, sizeof(_treesRemoved));
     sourceBuffer += sizeof(_treesRemoved);
+    memcpy(&_encodeCacheHits, sourceBuffer, sizeof(_encodeCacheHits));
+    sourceBuffer += sizeof(_encodeCacheHits);
+    memcpy(&_encodeCacheMisses, sourceBuffer, sizeof(_encodeCacheMisses));
+    sourceBuffer += sizeof(_encodeCacheMisses);
+    memcpy(&_encodeCacheBytes, sourceBuffer, sizeof(_encodeCacheBytes));
+    sourceBuffer += sizeof(_encodeCacheBytes);
 
     // read the root jurisdiction
     int bytes = 0;
@@ -518,6 +543,9 @@ void VoxelSceneStats::printDebugDetails() {
     qDebug("    exists bits         : %lu\n", _existsBitsWritten        );
     qDebug("    in packet bit       : %lu\n", _existsInPacketBitsWritten);
     qDebug("    trees removed       : %lu\n", _treesRemoved             );
+    qDebug("    encode cache hits   : %lu\n", _encodeCacheHits          );
+    qDebug("        misses          : %lu\n", _encodeCacheMisses        );
+    qDebug("        bytes           : %lu\n", _encodeCacheBytes         );
 }
 
 const unsigned greenish  = 0x40ff40d0;
@@ -540,6 +568,7 @@ VoxelSceneStats::ItemInfo VoxelSceneStats::_ITEMS[] = {
     { "Skipped - No Change"  , greenish  },
     { "Skipped - Occluded"   , yellowish },
     { "Didn't fit in packet" , greyish   },
+    { "Encode Cache"         , yellowish },
     { "Mode"                 , greenish  },
 };
 
@@ -633,6 +662,13 @@ char* VoxelSceneStats::getItemValue(Item item) {
                     _didntFit, _internalDidntFit, _leavesDidntFit, _treesRemoved);
             break;
         }
+        case ITEM_ENCODE_CACHE: {
+            unsigned long lookups = _encodeCacheHits + _encodeCacheMisses;
+            int hitRate = lookups == 0 ? 0 : (100 * _encodeCacheHits) / lookups;
+            sprintf(_itemValueBuffer, "%lu hits %lu misses (%d%% hit rate) %lu bytes", 
+                    _encodeCacheHits, _encodeCacheMisses, hitRate, _encodeCacheBytes);
+            break;
+        }
         case ITEM_BITS: {
             sprintf(_itemValueBuffer, "colors: %lu, exists: %lu, in packets: %lu", 
                     _colorBitsWritten, _existsBitsWritten, _existsInPacketBitsWritten);
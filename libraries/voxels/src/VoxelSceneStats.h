@@ -76,6 +76,12 @@ public:
     /// Fix up tracking statistics in case where bitmasks were removed for some reason
     void childBitsRemoved(bool includesExistsBits, bool includesColors);
 
+    /// Track that a subtree was copied out of the shared encode cache instead of being encoded for this scene
+    void encodeCacheHit(int bytes);
+
+    /// Track that a subtree was eligible for the shared encode cache, but had to be encoded for this scene
+    void encodeCacheMiss();
+
     /// Pack the details of the statistics into a buffer for sending as a network packet
     int packIntoMessage(unsigned char* destinationBuffer, int availableBytes);
 
@@ -108,6 +114,7 @@ public:
         ITEM_SKIPPED_NO_CHANGE,
         ITEM_SKIPPED_OCCLUDED,
         ITEM_DIDNT_FIT,
+        ITEM_ENCODE_CACHE,
         ITEM_MODE,
         ITEM_COUNT
     };
@@ -191,6 +198,11 @@ private:
     unsigned long _existsInPacketBitsWritten;
     unsigned long _treesRemoved;
 
+    // subtrees copied from the shared encode cache are not traversed, so they aren't included in the node counts above
+    unsigned long _encodeCacheHits;
+    unsigned long _encodeCacheMisses;
+    unsigned long _encodeCacheBytes;
+
     // Accounting Notes:
     //
     // 1) number of voxels sent can be calculated as _colorSent + _colorBitsWritten. This works because each internal 
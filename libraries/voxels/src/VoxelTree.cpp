@@ -29,6 +29,7 @@
 #include "Tags.h"
 #include "ViewFrustum.h"
 #include "VoxelConstants.h"
+#include "VoxelEncodeCache.h"
 #include "VoxelNodeBag.h"
 #include "VoxelTree.h"
 #include <PacketHeaders.h>
@@ -54,9 +55,14 @@ VoxelTree::VoxelTree(bool shouldReaverage) :
     _stopImport(false) {
     rootNode = new VoxelNode();
     
-    pthread_mutex_init(&_encodeSetLock, NULL);
-    pthread_mutex_init(&_deleteSetLock, NULL);
-    pthread_mutex_init(&_deletePendingSetLock, NULL);
+    pthread_rwlockattr_t treeLockAttributes;
+    pthread_rwlockattr_init(&treeLockAttributes);
+#ifdef __linux__
+    // glibc prefers readers by default, which would let a steady stream of encoders starve out edits
+    pthread_rwlockattr_setkind_np(&treeLockAttributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&_treeLock, &treeLockAttributes);
+    pthread_rwlockattr_destroy(&treeLockAttributes);
 }
 
 VoxelTree::~VoxelTree() {
@@ -66,9 +72,7 @@ VoxelTree::~VoxelTree() {
         delete rootNode->getChildAtIndex(i);
     }
 
-    pthread_mutex_destroy(&_encodeSetLock);
-    pthread_mutex_destroy(&_deleteSetLock);
-    pthread_mutex_destroy(&_deletePendingSetLock);
+    pthread_rwlock_destroy(&_treeLock);
 }
 
 // Recurses voxel tree calling the RecurseVoxelTreeOperation function for each node.
@@ -134,27 +138,31 @@ void VoxelTree::recurseNodeWithOperationDistanceSorted(VoxelNode* node, RecurseV
 
 VoxelNode* VoxelTree::nodeForOctalCode(VoxelNode* ancestorNode,
                                        unsigned char* needleCode, VoxelNode** parentOfFoundNode) const {
+    MortonKey needleKey;
+    octalCodeToMortonKey(needleCode, needleKey);
+    return nodeForKey(ancestorNode, needleKey, parentOfFoundNode);
+}
+
+VoxelNode* VoxelTree::nodeForKey(VoxelNode* ancestorNode, const MortonKey& needleKey, VoxelNode** parentOfFoundNode) const {
     // find the appropriate branch index based on this ancestorNode
-    if (*needleCode > 0) {
-        int branchForNeedle = branchIndexWithDescendant(ancestorNode->getOctalCode(), needleCode);
+    while (ancestorNode->getKey().depth < needleKey.depth) {
+        int branchForNeedle = needleKey.sectionValue(ancestorNode->getKey().depth);
         VoxelNode* childNode = ancestorNode->getChildAtIndex(branchForNeedle);
 
-        if (childNode) {
-            if (*childNode->getOctalCode() == *needleCode) {
-
-                // If the caller asked for the parent, then give them that too...
-                if (parentOfFoundNode) {
-                    *parentOfFoundNode = ancestorNode;
-                }
-                // the fact that the number of sections is equivalent does not always guarantee
-                // that this is the same node, however due to the recursive traversal
-                // we know that this is our node
-                return childNode;
-            } else {
-                // we need to go deeper
-                return nodeForOctalCode(childNode, needleCode, parentOfFoundNode);
+        if (!childNode) {
+            break;
+        }
+        if (childNode->getKey().depth == needleKey.depth) {
+            // If the caller asked for the parent, then give them that too...
+            if (parentOfFoundNode) {
+                *parentOfFoundNode = ancestorNode;
             }
+            // the fact that the depth is equivalent does not always guarantee that this is the same
+            // node, however due to the traversal we know that this is our node
+            return childNode;
         }
+        // we need to go deeper
+        ancestorNode = childNode;
     }
 
     // we've been given a code we don't have a node for
@@ -164,7 +172,13 @@ VoxelNode* VoxelTree::nodeForOctalCode(VoxelNode* ancestorNode,
 
 // returns the node created!
 VoxelNode* VoxelTree::createMissingNode(VoxelNode* lastParentNode, unsigned char* codeToReach) {
-    int indexOfNewChild = branchIndexWithDescendant(lastParentNode->getOctalCode(), codeToReach);
+    MortonKey keyToReach;
+    octalCodeToMortonKey(codeToReach, keyToReach);
+    return createMissingNode(lastParentNode, keyToReach);
+}
+
+VoxelNode* VoxelTree::createMissingNode(VoxelNode* lastParentNode, const MortonKey& keyToReach) {
+    int indexOfNewChild = keyToReach.sectionValue(lastParentNode->getKey().depth);
     // If this parent node is a leaf, then you know the child path doesn't exist, so deal with
     // breaking up the leaf first, which will also create a child path
     if (lastParentNode->isLeaf() && lastParentNode->isColored()) {
@@ -179,15 +193,21 @@ VoxelNode* VoxelTree::createMissingNode(VoxelNode* lastParentNode, unsigned char
     }
 
     // This works because we know we traversed down the same tree so if the length is the same, then the whole code is the same
-    if (*lastParentNode->getChildAtIndex(indexOfNewChild)->getOctalCode() == *codeToReach) {
+    if (lastParentNode->getChildAtIndex(indexOfNewChild)->getKey().depth == keyToReach.depth) {
         return lastParentNode->getChildAtIndex(indexOfNewChild);
     } else {
-        return createMissingNode(lastParentNode->getChildAtIndex(indexOfNewChild), codeToReach);
+        return createMissingNode(lastParentNode->getChildAtIndex(indexOfNewChild), keyToReach);
     }
 }
 
 int VoxelTree::readNodeData(VoxelNode* destinationNode, unsigned char* nodeData, int bytesLeftToRead,
                             ReadBitstreamToTreeParams& args) {
+    // nodes at the deepest key depth can't have children, so there's nothing in the rest of this bitstream we can use
+    if (destinationNode->getKey().depth >= MAX_MORTON_KEY_DEPTH) {
+        qDebug("readNodeData() bitstream goes deeper than MAX_MORTON_KEY_DEPTH, ignoring the rest of it.\n");
+        return bytesLeftToRead;
+    }
+
     // give this destination node the child mask from the packet
     const unsigned char ALL_CHILDREN_ASSUMED_TO_EXIST = 0xFF;
     unsigned char colorInPacketMask = *nodeData;
@@ -272,6 +292,9 @@ int VoxelTree::readNodeData(VoxelNode* destinationNode, unsigned char* nodeData,
             }
         }
     }
+
+    // our children have read their subtrees by now, so pick up whatever changed below us
+    destinationNode->recalculateSubtreeLastChanged();
     return bytesRead;
 }
 
@@ -292,14 +315,16 @@ void VoxelTree::readBitstreamToTree(unsigned char * bitstream, unsigned long int
     // if there are more bytes after that, it's assumed to be another root relative tree
 
     while (bitstreamAt < bitstream + bufferSizeBytes) {
-        VoxelNode* bitstreamRootNode = nodeForOctalCode(args.destinationNode, (unsigned char *)bitstreamAt, NULL);
-        if (*bitstreamAt != *bitstreamRootNode->getOctalCode()) {
+        MortonKey bitstreamRootKey;
+        octalCodeToMortonKey(bitstreamAt, bitstreamRootKey);
+        VoxelNode* bitstreamRootNode = nodeForKey(args.destinationNode, bitstreamRootKey, NULL);
+        if (bitstreamRootKey.depth != bitstreamRootNode->getKey().depth) {
             // if the octal code returned is not on the same level as
             // the code being searched for, we have VoxelNodes to create
 
             // Note: we need to create this node relative to root, because we're assuming that the bitstream for the initial
             // octal code is always relative to root!
-            bitstreamRootNode = createMissingNode(args.destinationNode, (unsigned char*) bitstreamAt);
+            bitstreamRootNode = createMissingNode(args.destinationNode, bitstreamRootKey);
             if (bitstreamRootNode->isDirty()) {
                 _isDirty = true;
                 _nodesChangedFromBitstream++;
@@ -332,7 +357,7 @@ void VoxelTree::deleteVoxelAt(float x, float y, float z, float s) {
 class DeleteVoxelCodeFromTreeArgs {
 public:
     bool            collapseEmptyTrees;
-    unsigned char*  codeBuffer;
+    MortonKey       key;
     int             lengthOfCode;
     bool            deleteLastChild;
     bool            pathChanged;
@@ -345,28 +370,21 @@ void VoxelTree::deleteVoxelCodeFromTree(unsigned char* codeBuffer, bool collapse
     // back and implement color reaveraging, and marking of lastChanged
     DeleteVoxelCodeFromTreeArgs args;
     args.collapseEmptyTrees = collapseEmptyTrees;
-    args.codeBuffer         = codeBuffer;
-    args.lengthOfCode       = numberOfThreeBitSectionsInCode(codeBuffer);
+    if (!octalCodeToMortonKey(codeBuffer, args.key)) {
+        return; // nothing deeper than MAX_MORTON_KEY_DEPTH can be in the tree
+    }
+    args.lengthOfCode       = args.key.depth;
     args.deleteLastChild    = false;
     args.pathChanged        = false;
 
     VoxelNode* node = rootNode;
-    
-    // We can't encode and delete nodes at the same time, so we guard against deleting any node that is actively
-    // being encoded. And we stick that code on our pendingDelete list.
-    if (isEncoding(codeBuffer)) {
-        queueForLaterDelete(codeBuffer);
-    } else {
-        startDeleting(codeBuffer);
-        deleteVoxelCodeFromTreeRecursion(node, &args);
-        doneDeleting(codeBuffer);
-    }
+    deleteVoxelCodeFromTreeRecursion(node, &args);
 }
 
 void VoxelTree::deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraData) {
     DeleteVoxelCodeFromTreeArgs* args = (DeleteVoxelCodeFromTreeArgs*)extraData;
 
-    int lengthOfNodeCode = numberOfThreeBitSectionsInCode(node->getOctalCode());
+    int lengthOfNodeCode = node->getKey().depth;
 
     // Since we traverse the tree in code order, we know that if our code
     // matches, then we've reached  our target node.
@@ -379,7 +397,7 @@ void VoxelTree::deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraDat
     }
 
     // Ok, we know we haven't reached our target node yet, so keep looking
-    int childIndex = branchIndexWithDescendant(node->getOctalCode(), args->codeBuffer);
+    int childIndex = args->key.sectionValue(lengthOfNodeCode);
     VoxelNode* childNode = node->getChildAtIndex(childIndex);
 
     // If there is no child at the target location, and the current parent node is a colored leaf,
@@ -388,8 +406,11 @@ void VoxelTree::deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraDat
     if (!childNode && node->isLeaf() && node->isColored()) {
         // we need to break up ancestors until we get to the right level
         VoxelNode* ancestorNode = node;
+        VoxelNode* brokenUpNodes[MAX_MORTON_KEY_DEPTH];
+        int brokenUpCount = 0;
         while (true) {
-            int index = branchIndexWithDescendant(ancestorNode->getOctalCode(), args->codeBuffer);
+            brokenUpNodes[brokenUpCount++] = ancestorNode;
+            int index = args->key.sectionValue(ancestorNode->getKey().depth);
             for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
                 if (i != index) {
                     ancestorNode->addChildAtIndex(i);
@@ -398,7 +419,7 @@ void VoxelTree::deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraDat
                     }
                 }
             }
-            int lengthOfAncestorNode = numberOfThreeBitSectionsInCode(ancestorNode->getOctalCode());
+            int lengthOfAncestorNode = ancestorNode->getKey().depth;
 
             // If we've reached the parent of the target, then stop breaking up children
             if (lengthOfAncestorNode == (args->lengthOfCode - 1)) {
@@ -410,6 +431,11 @@ void VoxelTree::deleteVoxelCodeFromTreeRecursion(VoxelNode* node, void* extraDat
                 ancestorNode->setColor(node->getColor());
             }
         }
+
+        // the unwinding only covers the nodes above us, so let the nodes we broke up do their bookkeeping, deepest first
+        for (int i = brokenUpCount - 1; i >= 0; i--) {
+            brokenUpNodes[i]->handleSubtreeChanged(this);
+        }
         _isDirty = true;
         args->pathChanged = true;
 
@@ -468,6 +494,7 @@ void VoxelTree::eraseAllVoxels() {
 class ReadCodeColorBufferToTreeArgs {
 public:
     unsigned char*  codeColorBuffer;
+    MortonKey       key;
     int             lengthOfCode;
     bool            destructive;
     bool            pathChanged;
@@ -477,10 +504,12 @@ void VoxelTree::readCodeColorBufferToTree(unsigned char* codeColorBuffer, bool d
     ReadCodeColorBufferToTreeArgs args;
     args.codeColorBuffer = codeColorBuffer;
     args.lengthOfCode    = numberOfThreeBitSectionsInCode(codeColorBuffer);
+    if (!octalCodeToMortonKey(codeColorBuffer, args.key)) {
+        qDebug("readCodeColorBufferToTree() code is deeper than MAX_MORTON_KEY_DEPTH, coloring its ancestor instead.\n");
+    }
     args.destructive     = destructive;
     args.pathChanged     = false;
 
-
     VoxelNode* node = rootNode;
 
     readCodeColorBufferToTreeRecursion(node, &args);
@@ -490,11 +519,11 @@ void VoxelTree::readCodeColorBufferToTree(unsigned char* codeColorBuffer, bool d
 void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelNode* node, void* extraData) {
     ReadCodeColorBufferToTreeArgs* args = (ReadCodeColorBufferToTreeArgs*)extraData;
 
-    int lengthOfNodeCode = numberOfThreeBitSectionsInCode(node->getOctalCode());
+    int lengthOfNodeCode = node->getKey().depth;
 
     // Since we traverse the tree in code order, we know that if our code
     // matches, then we've reached  our target node.
-    if (lengthOfNodeCode == args->lengthOfCode) {
+    if (lengthOfNodeCode == args->key.depth) {
         // we've reached our target -- we might have found our node, but that node might have children.
         // in this case, we only allow you to set the color if you explicitly asked for a destructive
         // write.
@@ -533,7 +562,7 @@ void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelNode* node, void* extraD
     }
 
     // Ok, we know we haven't reached our target node yet, so keep looking
-    int childIndex = branchIndexWithDescendant(node->getOctalCode(), args->codeColorBuffer);
+    int childIndex = args->key.sectionValue(lengthOfNodeCode);
     VoxelNode* childNode = node->getChildAtIndex(childIndex);
 
     // If the branch we need to traverse does not exist, then create it on the way down...
@@ -693,8 +722,10 @@ void VoxelTree::loadVoxelsFile(const char* fileName, bool wantColorRandomizer) {
 
 VoxelNode* VoxelTree::getVoxelAt(float x, float y, float z, float s) const {
     unsigned char* octalCode = pointToVoxel(x,y,z,s,0,0,0);
-    VoxelNode* node = nodeForOctalCode(rootNode, octalCode, NULL);
-    if (*node->getOctalCode() != *octalCode) {
+    MortonKey key;
+    octalCodeToMortonKey(octalCode, key);
+    VoxelNode* node = nodeForKey(rootNode, key, NULL);
+    if (node->getKey().depth != key.depth) {
         node = NULL;
     }
     delete[] octalCode; // cleanup memory
@@ -968,31 +999,20 @@ bool VoxelTree::findCapsulePenetration(const glm::vec3& start, const glm::vec3&
 int VoxelTree::encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer, int availableBytes, VoxelNodeBag& bag,
                                    EncodeBitstreamParams& params) {
 
-    startEncoding(node);
     // How many bytes have we written so far at this level;
     int bytesWritten = 0;
     
     // If we're at a node that is out of view, then we can return, because no nodes below us will be in view!
     if (params.viewFrustum && !node->isInView(*params.viewFrustum)) {
-        doneEncoding(node);
         return bytesWritten;
     }
     
-    // write the octal code
+    // write the octal code, this is where the node's key goes out on the wire
     int codeLength;
     if (params.chopLevels) {
-        unsigned char* newCode = chopOctalCode(node->getOctalCode(), params.chopLevels);
-        if (newCode) {
-            codeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(newCode));
-            memcpy(outputBuffer, newCode, codeLength);
-            delete newCode;
-        } else {
-            codeLength = 1; // chopped to root!
-            *outputBuffer = 0; // root
-        }
+        codeLength = mortonKeyToOctalCode(node->getKey().chop(params.chopLevels), outputBuffer);
     } else {
-        codeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(node->getOctalCode()));
-        memcpy(outputBuffer, node->getOctalCode(), codeLength);
+        codeLength = node->copyOctalCode(outputBuffer);
     }
 
     outputBuffer += codeLength; // move the pointer
@@ -1007,7 +1027,8 @@ int VoxelTree::encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer,
         params.stats->traversed(node);
     }
     
-    int childBytesWritten = encodeTreeBitstreamRecursion(node, outputBuffer, availableBytes, bag, params, currentEncodeLevel);
+    int childBytesWritten = encodeTreeBitstreamRecursionWithCache(node, outputBuffer, availableBytes, bag, params,
+                                                                  currentEncodeLevel);
 
     // if childBytesWritten == 1 then something went wrong... that's not possible
     assert(childBytesWritten != 1);
@@ -1026,7 +1047,63 @@ int VoxelTree::encodeTreeBitstream(VoxelNode* node, unsigned char* outputBuffer,
         bytesWritten = 0;
     }
     
-    doneEncoding(node);
+    return bytesWritten;
+}
+
+int VoxelTree::encodeTreeBitstreamRecursionWithCache(VoxelNode* node, unsigned char* outputBuffer, int availableBytes,
+                                                     VoxelNodeBag& bag, EncodeBitstreamParams& params,
+                                                     int& currentEncodeLevel) const {
+
+    // We can only share the encoding of a subtree with other viewers if it doesn't depend on who's looking at it. That's
+    // the case when the whole subtree is inside the view frustum, we're sending everything rather than just what changed
+    // or isn't occluded, and every node in the subtree is close enough to be sent at full detail. Since that last part
+    // depends on how deep the subtree goes, the cache checks it against the distance to the furthest corner of the node.
+    VoxelEncodeCache* encodeCache = params.encodeCache;
+    if (!encodeCache || !params.viewFrustum || !params.forceSendScene || params.deltaViewFrustum ||
+        params.wantOcclusionCulling || params.maxEncodeLevel != INT_MAX ||
+        node->getSubTreeNodeCount() < MIN_ENCODE_CACHE_SUBTREE_NODES ||
+        node->inFrustum(*params.viewFrustum) != ViewFrustum::INSIDE) {
+        return encodeTreeBitstreamRecursion(node, outputBuffer, availableBytes, bag, params, currentEncodeLevel);
+    }
+
+    // every node with children goes at least one level deeper, so if even that isn't close enough, don't bother looking
+    float furthestDistance = node->furthestDistanceToCamera(*params.viewFrustum);
+    if (!(furthestDistance < boundaryDistanceForRenderLevel(node->getLevel() + 2 + params.boundaryLevelAdjust))) {
+        return encodeTreeBitstreamRecursion(node, outputBuffer, availableBytes, bag, params, currentEncodeLevel);
+    }
+
+    int cachedDeepestChildLevel = 0;
+    int cachedBytes = encodeCache->lookup(node, params.includeColor, params.includeExistsBits, furthestDistance,
+                                          params.boundaryLevelAdjust, outputBuffer, availableBytes,
+                                          cachedDeepestChildLevel);
+    if (cachedBytes >= 0) {
+        params.deepestChildLevel = std::max(cachedDeepestChildLevel, params.deepestChildLevel);
+        params.maxLevelReached = std::max(currentEncodeLevel + cachedDeepestChildLevel - node->getLevel(),
+                                          params.maxLevelReached);
+        if (params.stats) {
+            params.stats->encodeCacheHit(cachedBytes);
+        }
+        return cachedBytes;
+    }
+    if (params.stats) {
+        params.stats->encodeCacheMiss();
+    }
+
+    // track how deep this subtree goes on its own, and whether any of it got pushed to the next packet
+    int outerDeepestChildLevel = params.deepestChildLevel;
+    int outerNodesDidntFit = params.nodesDidntFit;
+    params.deepestChildLevel = 0;
+
+    int bytesWritten = encodeTreeBitstreamRecursion(node, outputBuffer, availableBytes, bag, params, currentEncodeLevel);
+
+    // only a complete encoding, where nothing was skipped for being too far away, is the same for everyone
+    if (bytesWritten > 0 && params.nodesDidntFit == outerNodesDidntFit &&
+        furthestDistance < boundaryDistanceForRenderLevel(params.deepestChildLevel + 1 + params.boundaryLevelAdjust)) {
+        encodeCache->store(node, params.includeColor, params.includeExistsBits, outputBuffer, bytesWritten,
+                           params.deepestChildLevel);
+    }
+    params.deepestChildLevel = std::max(outerDeepestChildLevel, params.deepestChildLevel);
+
     return bytesWritten;
 }
 
@@ -1053,7 +1130,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
     if (params.jurisdictionMap) {
         // here's how it works... if we're currently above our root jurisdiction, then we proceed normally.
         // but once we're in our own jurisdiction, then we need to make sure we're not below it.
-        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node->getOctalCode(), CHECK_NODE_ONLY)) {
+        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node->getKey(), CHECK_NODE_ONLY)) {
             return bytesAtThisLevel;
         }
     }
@@ -1099,7 +1176,8 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         // If we were previously in the view, then we normally will return out of here and stop recursing. But
         // if we're in deltaViewFrustum mode, and this node has changed since it was last sent, then we do
         // need to send it.
-        if (wasInView && !(params.deltaViewFrustum && node->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))) {
+        if (wasInView &&
+            !(params.deltaViewFrustum && node->hasSubtreeChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))) {
             if (params.stats) {
                 params.stats->skippedWasInView(node);
             }
@@ -1109,7 +1187,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         // If we're not in delta sending mode, and we weren't asked to do a force send, and the voxel hasn't changed, 
         // then we can also bail early and save bits
         if (!params.forceSendScene && !params.deltaViewFrustum && 
-            !node->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE)) {
+            !node->hasSubtreeChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE)) {
             if (params.stats) {
                 params.stats->skippedNoChange(node);
             }
@@ -1145,6 +1223,9 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         }
     }
 
+    // we're going to examine our children, which are one level deeper than us, keep track of that for the encode cache
+    params.deepestChildLevel = std::max(node->getLevel() + 1, params.deepestChildLevel);
+
     bool keepDiggingDeeper = true; // Assuming we're in view we have a great work ethic, we're always ready for more!
 
     // At any given point in writing the bitstream, the largest minimum we might need to flesh out the current level
@@ -1181,7 +1262,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         // even if they don't in our local tree
         bool notMyJurisdiction = false;
         if (params.jurisdictionMap) {
-            notMyJurisdiction = (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node->getOctalCode(), i));
+            notMyJurisdiction = (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(node->getKey(), i));
         }
         if (params.includeExistsBits) {
             // If the child is known to exist, OR, it's not my jurisdiction, then we mark the bit as existing
@@ -1396,6 +1477,7 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
         availableBytes -= bytesAtThisLevel;
     } else {
         bag.insert(node);
+        params.nodesDidntFit++;
 
         // don't need to check node here, because we can't get here with no node
         if (params.stats) {
@@ -1439,8 +1521,8 @@ int VoxelTree::encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outp
                 // remember this for reshuffling
                 recursiveSliceStarts[originalIndex] = outputBuffer;
 
-                int childTreeBytesOut = encodeTreeBitstreamRecursion(childNode, outputBuffer, availableBytes, bag,
-                                                                     params, thisLevel);
+                int childTreeBytesOut = encodeTreeBitstreamRecursionWithCache(childNode, outputBuffer, availableBytes,
+                                                                              bag, params, thisLevel);
 
                 // remember this for reshuffling
                 recursiveSliceSizes[originalIndex] = childTreeBytesOut;
@@ -1755,7 +1837,7 @@ void VoxelTree::copySubTreeIntoNewTree(VoxelNode* startNode, VoxelTree* destinat
     nodeBag.insert(startNode);
     int chopLevels = 0;
     if (rebaseToRoot) {
-        chopLevels = numberOfThreeBitSectionsInCode(startNode->getOctalCode());
+        chopLevels = startNode->getKey().depth;
     }
 
     static unsigned char outputBuffer[MAX_VOXEL_PACKET_SIZE - 1]; // save on allocs by making this static
@@ -1777,7 +1859,7 @@ void VoxelTree::copySubTreeIntoNewTree(VoxelNode* startNode, VoxelTree* destinat
     if (rebaseToRoot) {
         destinationStartNode = destinationTree->rootNode;
     } else {
-        destinationStartNode = nodeForOctalCode(destinationTree->rootNode, startNode->getOctalCode(), NULL);
+        destinationStartNode = nodeForKey(destinationTree->rootNode, startNode->getKey(), NULL);
     }
     destinationStartNode->setColor(startNode->getColor());
 }
@@ -1803,65 +1885,6 @@ void VoxelTree::copyFromTreeIntoSubTree(VoxelTree* sourceTree, VoxelNode* destin
     }
 }
 
-void dumpSetContents(const char* name, std::set<unsigned char*> set) {
-    printf("set %s has %ld elements\n", name, set.size());
-    /*
-    for (std::set<unsigned char*>::iterator i = set.begin(); i != set.end(); ++i) {
-        printOctalCode(*i);
-    }
-    */
-}
-
-void VoxelTree::startEncoding(VoxelNode* node) {
-    pthread_mutex_lock(&_encodeSetLock);
-    _codesBeingEncoded.insert(node->getOctalCode());
-    pthread_mutex_unlock(&_encodeSetLock);
-}
-
-void VoxelTree::doneEncoding(VoxelNode* node) {
-    pthread_mutex_lock(&_encodeSetLock);
-    _codesBeingEncoded.erase(node->getOctalCode());
-    pthread_mutex_unlock(&_encodeSetLock);
-    
-    // if we have any pending delete codes, then delete them now.
-    emptyDeleteQueue();
-}
-
-void VoxelTree::startDeleting(unsigned char* code) {
-    pthread_mutex_lock(&_deleteSetLock);
-    _codesBeingDeleted.insert(code);
-    pthread_mutex_unlock(&_deleteSetLock);
-}
-
-void VoxelTree::doneDeleting(unsigned char* code) {
-    pthread_mutex_lock(&_deleteSetLock);
-    _codesBeingDeleted.erase(code);
-    pthread_mutex_unlock(&_deleteSetLock);
-}
-
-bool VoxelTree::isEncoding(unsigned char* codeBuffer) {
-    pthread_mutex_lock(&_encodeSetLock);
-    bool isEncoding = (_codesBeingEncoded.find(codeBuffer) != _codesBeingEncoded.end());
-    pthread_mutex_unlock(&_encodeSetLock);
-    return isEncoding;
-}
-
-void VoxelTree::queueForLaterDelete(unsigned char* codeBuffer) {
-    pthread_mutex_lock(&_deletePendingSetLock);
-    _codesPendingDelete.insert(codeBuffer);
-    pthread_mutex_unlock(&_deletePendingSetLock);
-}
-
-void VoxelTree::emptyDeleteQueue() {
-    pthread_mutex_lock(&_deletePendingSetLock);
-    for (std::set<unsigned char*>::iterator i = _codesPendingDelete.begin(); i != _codesPendingDelete.end(); ++i) {
-        unsigned char* codeToDelete = *i;
-        _codesBeingDeleted.erase(codeToDelete);
-        deleteVoxelCodeFromTree(codeToDelete, COLLAPSE_EMPTY_TREE);
-    }
-    pthread_mutex_unlock(&_deletePendingSetLock);
-}
-
 void VoxelTree::cancelImport() {
     _stopImport = true;
 }
@@ -1963,12 +1986,12 @@ bool VoxelTree::nudgeCheck(VoxelNode* node, void* extraData) {
 
         NodeChunkArgs* args = (NodeChunkArgs*)extraData;
 
-        // get octal code of this node
-        unsigned char* octalCode = node->getOctalCode();
-
         // get voxel position/size
         VoxelPositionSize unNudgedDetails;
-        voxelDetailsForCode(octalCode, unNudgedDetails);
+        unNudgedDetails.x = node->getCorner().x;
+        unNudgedDetails.y = node->getCorner().y;
+        unNudgedDetails.z = node->getCorner().z;
+        unNudgedDetails.s = node->getScale();
 
         // find necessary leaf size
         float newLeafSize = findNewLeafSize(args->nudgeVec, unNudgedDetails.s);
@@ -1992,8 +2015,10 @@ void VoxelTree::chunkifyLeaf(VoxelNode* node) {
         return;
     }
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        node->addChildAtIndex(i);
-        node->getChildAtIndex(i)->setColor(node->getColor());
+        VoxelNode* childNode = node->addChildAtIndex(i);
+        if (childNode) {
+            childNode->setColor(node->getColor());
+        }
     }
 }
 
@@ -2002,12 +2027,12 @@ void VoxelTree::chunkifyLeaf(VoxelNode* node) {
 void VoxelTree::nudgeLeaf(VoxelNode* node, void* extraData) {
     NodeChunkArgs* args = (NodeChunkArgs*)extraData;
 
-    // get octal code of this node
-    unsigned char* octalCode = node->getOctalCode();
-
     // get voxel position/size
     VoxelPositionSize unNudgedDetails;
-    voxelDetailsForCode(octalCode, unNudgedDetails);
+    unNudgedDetails.x = node->getCorner().x;
+    unNudgedDetails.y = node->getCorner().y;
+    unNudgedDetails.z = node->getCorner().z;
+    unNudgedDetails.s = node->getScale();
     
     VoxelDetail voxelDetails;
     voxelDetails.x = unNudgedDetails.x;
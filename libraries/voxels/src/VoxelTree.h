@@ -9,7 +9,7 @@
 #ifndef __hifi__VoxelTree__
 #define __hifi__VoxelTree__
 
-#include <set>
+#include <pthread.h>
 #include <SimpleMovingAverage.h>
 
 #include "CoverageMap.h"
@@ -22,6 +22,8 @@
 
 #include <QObject>
 
+class VoxelEncodeCache;
+
 // Callback function, for recuseTreeWithOperation
 typedef bool (*RecurseVoxelTreeOperation)(VoxelNode* node, void* extraData);
 typedef enum {GRADIENT, RANDOM, NATURAL} creationMode;
@@ -44,6 +46,7 @@ const uint64_t IGNORE_LAST_SENT  = 0;
 #define IGNORE_VIEW_FRUSTUM      NULL
 #define IGNORE_COVERAGE_MAP      NULL
 #define IGNORE_JURISDICTION_MAP  NULL
+#define IGNORE_ENCODE_CACHE      NULL
 
 class EncodeBitstreamParams {
 public:
@@ -62,6 +65,9 @@ public:
     VoxelSceneStats*    stats;
     CoverageMap*        map;
     JurisdictionMap*    jurisdictionMap;
+    VoxelEncodeCache*   encodeCache;
+    int                 deepestChildLevel;
+    int                 nodesDidntFit;
     
     EncodeBitstreamParams(
         int                 maxEncodeLevel      = INT_MAX, 
@@ -77,7 +83,8 @@ public:
         uint64_t            lastViewFrustumSent = IGNORE_LAST_SENT,
         bool                forceSendScene      = true,
         VoxelSceneStats*    stats               = IGNORE_SCENE_STATS,
-        JurisdictionMap*    jurisdictionMap     = IGNORE_JURISDICTION_MAP) :
+        JurisdictionMap*    jurisdictionMap     = IGNORE_JURISDICTION_MAP,
+        VoxelEncodeCache*   encodeCache         = IGNORE_ENCODE_CACHE) :
             maxEncodeLevel          (maxEncodeLevel),
             maxLevelReached         (0),
             viewFrustum             (viewFrustum),
@@ -92,7 +99,10 @@ public:
             forceSendScene          (forceSendScene),
             stats                   (stats),
             map                     (map),
-            jurisdictionMap         (jurisdictionMap)
+            jurisdictionMap         (jurisdictionMap),
+            encodeCache             (encodeCache),
+            deepestChildLevel       (0),
+            nodesDidntFit           (0)
     {}
 };
 
@@ -186,6 +196,14 @@ public:
     
     bool getShouldReaverage() const { return _shouldReaverage; }
 
+    /// Locking for trees that are shared between threads. Encoding only reads the tree, so any number of threads can
+    /// encode at once while holding the read lock. Anything that changes the tree must hold the write lock, which also
+    /// covers the VoxelNodeBags of the readers since deleting nodes removes them from any bags they're in. The tree
+    /// doesn't take these locks itself, it's up to the owner of a shared tree to use them.
+    void lockForRead() { pthread_rwlock_rdlock(&_treeLock); }
+    void lockForWrite() { pthread_rwlock_wrlock(&_treeLock); }
+    void unlock() { pthread_rwlock_unlock(&_treeLock); }
+
     void recurseNodeWithOperation(VoxelNode* node, RecurseVoxelTreeOperation operation, void* extraData);
     void recurseNodeWithOperationDistanceSorted(VoxelNode* node, RecurseVoxelTreeOperation operation, 
                 const glm::vec3& point, void* extraData);
@@ -206,11 +224,16 @@ private:
 
     int encodeTreeBitstreamRecursion(VoxelNode* node, unsigned char* outputBuffer, int availableBytes, VoxelNodeBag& bag, 
                                      EncodeBitstreamParams& params, int& currentEncodeLevel) const;
+    int encodeTreeBitstreamRecursionWithCache(VoxelNode* node, unsigned char* outputBuffer, int availableBytes,
+                                              VoxelNodeBag& bag, EncodeBitstreamParams& params,
+                                              int& currentEncodeLevel) const;
 
     static bool countVoxelsOperation(VoxelNode* node, void* extraData);
 
     VoxelNode* nodeForOctalCode(VoxelNode* ancestorNode, unsigned char* needleCode, VoxelNode** parentOfFoundNode) const;
+    VoxelNode* nodeForKey(VoxelNode* ancestorNode, const MortonKey& needleKey, VoxelNode** parentOfFoundNode) const;
     VoxelNode* createMissingNode(VoxelNode* lastParentNode, unsigned char* deepestCodeToCreate);
+    VoxelNode* createMissingNode(VoxelNode* lastParentNode, const MortonKey& deepestKeyToCreate);
     int readNodeData(VoxelNode *destinationNode, unsigned char* nodeData, int bufferSizeBytes, ReadBitstreamToTreeParams& args);
     
     bool _isDirty;
@@ -218,39 +241,8 @@ private:
     bool _shouldReaverage;
     bool _stopImport;
 
-    /// Octal Codes of any subtrees currently being encoded. While any of these codes is being encoded, ancestors and 
-    /// descendants of them can not be deleted.
-    std::set<unsigned char*>  _codesBeingEncoded;
-    /// mutex lock to protect the encoding set
-    pthread_mutex_t _encodeSetLock;
-
-    /// Called to indicate that a VoxelNode is in the process of being encoded.
-    void startEncoding(VoxelNode* node);
-    /// Called to indicate that a VoxelNode is done being encoded.
-    void doneEncoding(VoxelNode* node);
-    /// Is the Octal Code currently being deleted?
-    bool isEncoding(unsigned char* codeBuffer);
-
-    /// Octal Codes of any subtrees currently being deleted. While any of these codes is being deleted, ancestors and 
-    /// descendants of them can not be encoded.
-    std::set<unsigned char*>  _codesBeingDeleted;
-    /// mutex lock to protect the deleting set
-    pthread_mutex_t _deleteSetLock;
-
-    /// Called to indicate that an octal code is in the process of being deleted.
-    void startDeleting(unsigned char* code);
-    /// Called to indicate that an octal code is done being deleted.
-    void doneDeleting(unsigned char* code);
-    /// Octal Codes that were attempted to be deleted but couldn't be because they were actively being encoded, and were
-    /// instead queued for later delete
-    std::set<unsigned char*>  _codesPendingDelete;
-    /// mutex lock to protect the deleting set
-    pthread_mutex_t _deletePendingSetLock;
-
-    /// Adds an Octal Code to the set of codes that needs to be deleted
-    void queueForLaterDelete(unsigned char* codeBuffer);
-    /// flushes out any Octal Codes that had to be queued
-    void emptyDeleteQueue();
+    /// reader/writer lock for trees that are shared between threads, see lockForRead()
+    pthread_rwlock_t _treeLock;
 
     // helper functions for nudgeSubTree
     void recurseNodeForNudge(VoxelNode* node, RecurseVoxelTreeOperation operation, void* extraData);
@@ -0,0 +1,149 @@
+//
+//  audiomixbench.cpp
+//  tools
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Times the audio mixer's inner loop, per listener and source pair, for the loop the mixer used to have and for each
+//  version of the AudioMixKernel loops the processor supports, and checks the kernels all mix the same.
+//
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "AudioMixKernel.h"
+
+const int SAMPLES_PER_CHANNEL = 256;
+const int NUM_SAMPLES_DELAY = 10;
+const int NUM_SOURCES = 32;
+const float ATTENUATION = 0.7f;
+const float WEAK_CHANNEL_RATIO = 0.6f;
+
+const int MAX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
+const int MIN_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
+
+static uint64_t usecsNow() {
+    timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static int clampSample(int sample) {
+    return std::min(std::max(sample, MIN_SAMPLE_VALUE), MAX_SAMPLE_VALUE);
+}
+
+// the mixer's loop from before AudioMixKernel, minus the TwoPole, clamping the 16 bit mix after every add
+static void mixWithOldLoop(int16_t sources[][SAMPLES_PER_CHANNEL * 2], int16_t* clientSamples) {
+    memset(clientSamples, 0, SAMPLES_PER_CHANNEL * 2 * sizeof(int16_t));
+
+    for (int source = 0; source < NUM_SOURCES; source++) {
+        int16_t* sourceBuffer = sources[source] + SAMPLES_PER_CHANNEL;
+        int16_t* delaySamplePointer = sourceBuffer - NUM_SAMPLES_DELAY;
+        int16_t* goodChannel = (source % 2) ? clientSamples : clientSamples + SAMPLES_PER_CHANNEL;
+        int16_t* delayedChannel = (source % 2) ? clientSamples + SAMPLES_PER_CHANNEL : clientSamples;
+
+        for (int s = 0; s < SAMPLES_PER_CHANNEL; s++) {
+            if (s < NUM_SAMPLES_DELAY) {
+                int earlierSample = delaySamplePointer[s] * ATTENUATION * WEAK_CHANNEL_RATIO;
+                delayedChannel[s] = clampSample(delayedChannel[s] + earlierSample);
+            }
+
+            int16_t currentSample = sourceBuffer[s] * ATTENUATION;
+            goodChannel[s] = clampSample(goodChannel[s] + currentSample);
+
+            if (s + NUM_SAMPLES_DELAY < SAMPLES_PER_CHANNEL) {
+                int sumSample = delayedChannel[s + NUM_SAMPLES_DELAY] + (currentSample * WEAK_CHANNEL_RATIO);
+                delayedChannel[s + NUM_SAMPLES_DELAY] = clampSample(sumSample);
+            }
+        }
+    }
+}
+
+// the mixer's loop now, as ListenerMixer runs it
+static void mixWithKernel(int16_t sources[][SAMPLES_PER_CHANNEL * 2], int16_t* clientSamples) {
+    static int32_t clientMix[SAMPLES_PER_CHANNEL * 2];
+    memset(clientMix, 0, sizeof(clientMix));
+
+    for (int source = 0; source < NUM_SOURCES; source++) {
+        int16_t* sourceBuffer = sources[source] + SAMPLES_PER_CHANNEL;
+        int16_t* delaySamplePointer = sourceBuffer - NUM_SAMPLES_DELAY;
+        int32_t* goodChannel = (source % 2) ? clientMix : clientMix + SAMPLES_PER_CHANNEL;
+        int32_t* delayedChannel = (source % 2) ? clientMix + SAMPLES_PER_CHANNEL : clientMix;
+        float weakChannelAttenuation = ATTENUATION * WEAK_CHANNEL_RATIO;
+
+        addSamplesToMix(goodChannel, sourceBuffer, SAMPLES_PER_CHANNEL, ATTENUATION);
+        addSamplesToMix(delayedChannel, delaySamplePointer, NUM_SAMPLES_DELAY, weakChannelAttenuation);
+        addSamplesToMix(delayedChannel + NUM_SAMPLES_DELAY, sourceBuffer, SAMPLES_PER_CHANNEL - NUM_SAMPLES_DELAY,
+                        weakChannelAttenuation);
+    }
+
+    clampMixToSamples(clientMix, clientSamples, SAMPLES_PER_CHANNEL * 2);
+}
+
+typedef void (*MixFunction)(int16_t sources[][SAMPLES_PER_CHANNEL * 2], int16_t* clientSamples);
+
+static float pairsPerMsec(MixFunction mix, int16_t sources[][SAMPLES_PER_CHANNEL * 2], int16_t* clientSamples,
+                          int numFrames) {
+    // warm up the caches and the branch predictors first
+    for (int frame = 0; frame < numFrames / 10 + 1; frame++) {
+        mix(sources, clientSamples);
+    }
+
+    uint64_t start = usecsNow();
+    for (int frame = 0; frame < numFrames; frame++) {
+        mix(sources, clientSamples);
+    }
+    uint64_t elapsed = std::max(usecsNow() - start, (uint64_t) 1);
+    return (float) numFrames * NUM_SOURCES / (elapsed / 1000.0f);
+}
+
+int main(int argc, const char* argv[]) {
+    int numFrames = (argc > 1) ? atoi(argv[1]) : 20000;
+
+    // each source has the end of last frame, for the delayed channel, followed by this frame
+    static int16_t sources[NUM_SOURCES][SAMPLES_PER_CHANNEL * 2];
+    srand(1);
+    for (int source = 0; source < NUM_SOURCES; source++) {
+        for (int s = 0; s < SAMPLES_PER_CHANNEL * 2; s++) {
+            sources[source][s] = (rand() % 65536) - 32768;
+        }
+    }
+
+    int16_t clientSamples[SAMPLES_PER_CHANNEL * 2];
+    int16_t scalarSamples[SAMPLES_PER_CHANNEL * 2];
+
+    printf("%d sources of %d samples, %d samples of delay, %d frames\n", NUM_SOURCES, SAMPLES_PER_CHANNEL,
+           NUM_SAMPLES_DELAY, numFrames);
+    printf("%-8s %10.0f pairs/msec\n", "old", pairsPerMsec(mixWithOldLoop, sources, clientSamples, numFrames));
+
+    setAudioMixInstructionSet(AUDIO_MIX_SCALAR);
+    mixWithKernel(sources, scalarSamples);
+
+    const AudioMixInstructionSet INSTRUCTION_SETS[] = { AUDIO_MIX_SCALAR, AUDIO_MIX_SSE2, AUDIO_MIX_AVX2 };
+    const int NUM_INSTRUCTION_SETS = sizeof(INSTRUCTION_SETS) / sizeof(INSTRUCTION_SETS[0]);
+    bool allMatched = true;
+
+    for (int i = 0; i < NUM_INSTRUCTION_SETS; i++) {
+        const char* name = getAudioMixInstructionSetName(INSTRUCTION_SETS[i]);
+        if (!setAudioMixInstructionSet(INSTRUCTION_SETS[i])) {
+            printf("%-8s not supported by this processor\n", name);
+            continue;
+        }
+
+        mixWithKernel(sources, clientSamples);
+        bool matched = memcmp(clientSamples, scalarSamples, sizeof(clientSamples)) == 0;
+        allMatched = allMatched && matched;
+
+        printf("%-8s %10.0f pairs/msec%s\n", name, pairsPerMsec(mixWithKernel, sources, clientSamples, numFrames),
+               matched ? "" : " MISMATCHED the scalar mix");
+    }
+
+    printf("picked at startup: %s\n", getAudioMixInstructionSetName(setBestAudioMixInstructionSet()));
+    return allMatched ? 0 : 1;
+}
@@ -6,6 +6,9 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+#include <vector>
+
 #include <VoxelTree.h>
 #include <SharedUtil.h>
 #include <SceneUtils.h>
@@ -55,6 +58,62 @@ void voxelTutorial(VoxelTree * tree) {
     }
 }
 
+const float BENCHMARK_VOXEL_SIZE = 1.0f / 4096.0f;
+const int DEFAULT_NUM_BENCHMARK_EDITS = 100000;
+
+void printEditsPerSecond(const char* editName, int numEdits, uint64_t startTime) {
+    uint64_t elapsedUsecs = std::max(usecTimestampNow() - startTime, (uint64_t) 1);
+    printf("%-28s %10.0f edits/sec\n", editName, numEdits / (elapsedUsecs / 1000000.0f));
+}
+
+// Times the edits the voxel server applies as they come in from an animation server or an importer, each one a walk
+// from the root to a voxel BENCHMARK_VOXEL_SIZE across
+void benchmarkEdits(int numEdits) {
+    std::vector<unsigned char*> newColorVoxels;
+    std::vector<unsigned char*> changedColorVoxels;
+    srand(1);
+    for (int i = 0; i < numEdits; i++) {
+        float x = randFloat() * (1.0f - BENCHMARK_VOXEL_SIZE);
+        float y = randFloat() * (1.0f - BENCHMARK_VOXEL_SIZE);
+        float z = randFloat() * (1.0f - BENCHMARK_VOXEL_SIZE);
+        newColorVoxels.push_back(pointToVoxel(x, y, z, BENCHMARK_VOXEL_SIZE, 255, 0, 0));
+        changedColorVoxels.push_back(pointToVoxel(x, y, z, BENCHMARK_VOXEL_SIZE, 0, 0, 255));
+    }
+
+    VoxelTree tree;
+    printf("Benchmarking %d edits of voxels %g across...\n", numEdits, BENCHMARK_VOXEL_SIZE);
+
+    uint64_t startTime = usecTimestampNow();
+    for (int i = 0; i < numEdits; i++) {
+        tree.readCodeColorBufferToTree(newColorVoxels[i]);
+    }
+    printEditsPerSecond("new voxels", numEdits, startTime);
+
+    startTime = usecTimestampNow();
+    for (int i = 0; i < numEdits; i++) {
+        tree.readCodeColorBufferToTree(changedColorVoxels[i]);
+    }
+    printEditsPerSecond("recolored voxels", numEdits, startTime);
+
+    // setting a voxel to the color it already has doesn't change the tree, so nothing above it is reaveraged
+    startTime = usecTimestampNow();
+    for (int i = 0; i < numEdits; i++) {
+        tree.readCodeColorBufferToTree(changedColorVoxels[i]);
+    }
+    printEditsPerSecond("unchanged voxels", numEdits, startTime);
+
+    startTime = usecTimestampNow();
+    for (int i = 0; i < numEdits; i++) {
+        tree.deleteVoxelCodeFromTree(changedColorVoxels[i], COLLAPSE_EMPTY_TREE);
+    }
+    printEditsPerSecond("deleted voxels", numEdits, startTime);
+
+    for (int i = 0; i < numEdits; i++) {
+        delete[] newColorVoxels[i];
+        delete[] changedColorVoxels[i];
+    }
+}
+
 int main(int argc, const char * argv[])
 {
     qInstallMessageHandler(sharedMessageHandler);
@@ -150,6 +209,13 @@ int main(int argc, const char * argv[])
         return 0;
     }
 
+    const char* BENCHMARK_EDITS = "--benchmarkEdits";
+    if (cmdOptionExists(argc, argv, BENCHMARK_EDITS)) {
+        const char* numEditsString = getCmdOption(argc, argv, BENCHMARK_EDITS);
+        benchmarkEdits(numEditsString && atoi(numEditsString) > 0 ? atoi(numEditsString) : DEFAULT_NUM_BENCHMARK_EDITS);
+        return 0;
+    }
+
     const char* DONT_CREATE_FILE = "--dontCreateSceneFile";
     bool dontCreateFile = cmdOptionExists(argc, argv, DONT_CREATE_FILE);
 
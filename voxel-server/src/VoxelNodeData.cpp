@@ -9,14 +9,22 @@
 #include "PacketHeaders.h"
 #include "SharedUtil.h"
 #include "VoxelNodeData.h"
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
+#include "VoxelSendScheduler.h"
 #include "VoxelSendThread.h"
+#include "VoxelServer.h"
 
 VoxelNodeData::VoxelNodeData(Node* owningNode) :
     AvatarData(owningNode),
+    rateController(::PACKETS_PER_CLIENT_PER_INTERVAL * MAX_VOXEL_PACKET_SIZE,
+                   ::MAX_PACKETS_PER_CLIENT_PER_INTERVAL * MAX_VOXEL_PACKET_SIZE),
     _viewSent(false),
-    _voxelPacketAvailableBytes(MAX_VOXEL_PACKET_SIZE),
+    _voxelPacketAvailableBytes(MAX_VOXEL_PACKET_DATA_SIZE),
+    _packetToSendLength(0),
+    _currentPacketIsCompressed(false),
+    _compressionRatio(1.0f),
     _maxSearchLevel(1),
     _maxLevelReachedInLastSearch(1),
     _lastTimeBagEmpty(0),
@@ -25,14 +33,23 @@ VoxelNodeData::VoxelNodeData(Node* owningNode) :
     _currentPacketIsColor(true),
     _voxelSendThread(NULL)
 {
-    _voxelPacket = new unsigned char[MAX_VOXEL_PACKET_SIZE];
+    _voxelPacket = new unsigned char[MAX_UNCOMPRESSED_VOXEL_PACKET_DATA_SIZE];
     _voxelPacketAt = _voxelPacket;
+    _packetToSend = new unsigned char[MAX_VOXEL_PACKET_SIZE];
     resetVoxelPacket();
+
+    // send the parts of the scene nearest to the viewer first
+    nodeBag.setPriorityFunction(VoxelNodeBag::nearestToCameraFirst, &_currentViewFrustum);
     
     // Create voxel sending thread...
     uint16_t nodeID = getOwningNode()->getNodeID();
     _voxelSendThread = new VoxelSendThread(nodeID);
-    _voxelSendThread->initialize(true);
+    if (::voxelSendScheduler) {
+        _voxelSendThread->initialize(false);
+        ::voxelSendScheduler->addSender(_voxelSendThread);
+    } else {
+        _voxelSendThread->initialize(true);
+    }
 }
 
 
@@ -40,11 +57,20 @@ void VoxelNodeData::resetVoxelPacket() {
     // If we're moving, and the client asked for low res, then we force monochrome, otherwise, use 
     // the clients requested color state.    
     _currentPacketIsColor = (LOW_RES_MONO && getWantLowResMoving() && _viewFrustumChanging) ? false : getWantColor();
-    PACKET_TYPE voxelPacketType = _currentPacketIsColor ? PACKET_TYPE_VOXEL_DATA : PACKET_TYPE_VOXEL_DATA_MONOCHROME;
-    int numBytesPacketHeader = populateTypeAndVersion(_voxelPacket, voxelPacketType);
-    _voxelPacketAt = _voxelPacket + numBytesPacketHeader;
-    _voxelPacketAvailableBytes = MAX_VOXEL_PACKET_SIZE - numBytesPacketHeader;
+    _currentPacketIsCompressed = getWantCompression();
+
+    // when compressing, fill the packet with as much voxel data as we expect to compress down to one packet's worth,
+    // going by how well this client's voxels have compressed so far. If we guess wrong, it gets split up when it's sent.
+    int packetDataBytes = MAX_VOXEL_PACKET_DATA_SIZE;
+    if (_currentPacketIsCompressed) {
+        const float COMPRESSION_RATIO_MARGIN = 0.85f;
+        int expectedDataBytes = MAX_VOXEL_PACKET_DATA_SIZE * _compressionRatio * COMPRESSION_RATIO_MARGIN;
+        packetDataBytes = std::max(packetDataBytes, std::min(expectedDataBytes, MAX_UNCOMPRESSED_VOXEL_PACKET_DATA_SIZE));
+    }
+    _voxelPacketAt = _voxelPacket;
+    _voxelPacketAvailableBytes = packetDataBytes;
     _voxelPacketWaiting = false;
+    _packetWriteEnds.clear();
 }
 
 void VoxelNodeData::writeToPacket(unsigned char* buffer, int bytes) {
@@ -52,13 +78,57 @@ void VoxelNodeData::writeToPacket(unsigned char* buffer, int bytes) {
     _voxelPacketAvailableBytes -= bytes;
     _voxelPacketAt += bytes;
     _voxelPacketWaiting = true;
+    _packetWriteEnds.push_back(_voxelPacketAt - _voxelPacket);
 }
 
-VoxelNodeData::~VoxelNodeData() {
-    delete[] _voxelPacket;
+bool VoxelNodeData::packPacketToSend(int firstWrite, int lastWrite) {
+    // each write is a whole encoded subtree, so any run of them can go in a packet of its own
+    const unsigned char* data = _voxelPacket + (firstWrite == 0 ? 0 : _packetWriteEnds[firstWrite - 1]);
+    int dataBytes = (_voxelPacket + _packetWriteEnds[lastWrite - 1]) - data;
+
+    PACKET_TYPE voxelPacketType = _currentPacketIsColor ? PACKET_TYPE_VOXEL_DATA : PACKET_TYPE_VOXEL_DATA_MONOCHROME;
+    unsigned char* packetAt = _packetToSend + populateTypeAndVersion(_packetToSend, voxelPacketType);
+    packetAt += sizeof(VOXEL_PACKET_SEQUENCE); // filled in by setPacketToSendSequence()
+    VOXEL_PACKET_FLAGS* flags = packetAt;
+    packetAt += sizeof(VOXEL_PACKET_FLAGS);
+    *flags = 0;
+    int availableBytes = (_packetToSend + MAX_VOXEL_PACKET_SIZE) - packetAt;
 
+    int compressedBytes = _currentPacketIsCompressed ? _compressor.compress(data, dataBytes, packetAt, availableBytes) : 0;
+    if (compressedBytes > 0 && compressedBytes < dataBytes) {
+        setAtBit(*flags, VOXEL_PACKET_COMPRESSED_BIT);
+        _packetToSendLength = (packetAt + compressedBytes) - _packetToSend;
+
+        const float COMPRESSION_RATIO_SMOOTHING = 0.25f;
+        _compressionRatio += COMPRESSION_RATIO_SMOOTHING * ((float)dataBytes / compressedBytes - _compressionRatio);
+    } else if (dataBytes <= availableBytes) {
+        // not compressing, or it didn't help
+        memcpy(packetAt, data, dataBytes);
+        _packetToSendLength = (packetAt + dataBytes) - _packetToSend;
+    } else {
+        // it compresses worse than we expected, so at least don't expect better next time
+        if (_currentPacketIsCompressed) {
+            _compressionRatio = std::min(_compressionRatio, (float)dataBytes / availableBytes);
+        }
+        return false;
+    }
+    return true;
+}
+
+void VoxelNodeData::setPacketToSendSequence(VOXEL_PACKET_SEQUENCE sequence) {
+    memcpy(_packetToSend + numBytesForPacketHeader(_packetToSend), &sequence, sizeof(sequence));
+}
+
+VoxelNodeData::~VoxelNodeData() {
+    // the sender writes into our packet buffers, so make sure it's stopped before they go away
+    if (::voxelSendScheduler) {
+        ::voxelSendScheduler->removeSender(_voxelSendThread);
+    }
     _voxelSendThread->terminate();
     delete _voxelSendThread;
+
+    delete[] _voxelPacket;
+    delete[] _packetToSend;
 }
 
 bool VoxelNodeData::updateCurrentViewFrustum() {
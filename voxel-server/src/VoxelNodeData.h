@@ -10,14 +10,18 @@
 #define __hifi__VoxelNodeData__
 
 #include <iostream>
+#include <vector>
 #include <NodeData.h>
 #include <AvatarData.h>
 
 #include <CoverageMap.h>
 #include <VoxelConstants.h>
 #include <VoxelNodeBag.h>
+#include <VoxelPacketCompressor.h>
 #include <VoxelSceneStats.h>
 
+#include "VoxelSendRateController.h"
+
 class VoxelSendThread;
 
 class VoxelNodeData : public AvatarData {
@@ -25,12 +29,19 @@ public:
     VoxelNodeData(Node* owningNode);
     ~VoxelNodeData();
 
-    void resetVoxelPacket();  // resets voxel packet to after "V" header
+    void resetVoxelPacket();  // resets voxel packet to empty
 
     void writeToPacket(unsigned char* buffer, int bytes); // writes to end of packet
 
-    const unsigned char* getPacket() const { return _voxelPacket; }
-    int getPacketLength() const { return (MAX_VOXEL_PACKET_SIZE - _voxelPacketAvailableBytes); }
+    /// Packs the writes [firstWrite, lastWrite) to the waiting packet into a voxel packet that's ready to send, compressing
+    /// them if the client wants compressed packets. Returns false if they don't fit in a single voxel packet, in which
+    /// case they'll need to be split up.
+    bool packPacketToSend(int firstWrite, int lastWrite);
+    void setPacketToSendSequence(VOXEL_PACKET_SEQUENCE sequence); // stamps the packed packet before it's sent
+    const unsigned char* getPacketToSend() const { return _packetToSend; }
+    int getPacketToSendLength() const { return _packetToSendLength; }
+
+    int getPacketWriteCount() const { return _packetWriteEnds.size(); }
     bool isPacketWaiting() const { return _voxelPacketWaiting; }
     int getAvailable() const { return _voxelPacketAvailableBytes; }
     int getMaxSearchLevel() const { return _maxSearchLevel; };
@@ -64,16 +75,23 @@ public:
     bool getCurrentPacketIsColor() const { return _currentPacketIsColor; };
     
     VoxelSceneStats stats;
+    VoxelSendRateController rateController;
     
 private:
     VoxelNodeData(const VoxelNodeData &);
     VoxelNodeData& operator= (const VoxelNodeData&);
     
     bool _viewSent;
-    unsigned char* _voxelPacket;
+    unsigned char* _voxelPacket; // just the voxel data, the headers are added when it's packed to send
     unsigned char* _voxelPacketAt;
     int _voxelPacketAvailableBytes;
     bool _voxelPacketWaiting;
+    std::vector<int> _packetWriteEnds;
+    unsigned char* _packetToSend;
+    int _packetToSendLength;
+    bool _currentPacketIsCompressed;
+    float _compressionRatio;
+    VoxelPacketCompressor _compressor;
     int _maxSearchLevel;
     int _maxLevelReachedInLastSearch;
     ViewFrustum _currentViewFrustum;
@@ -28,8 +28,10 @@ bool VoxelPersistThread::process() {
     // check the dirty bit and persist here...
     if (_tree->isDirty()) {
         printf("saving voxels to file %s...\n",_filename);
+        _tree->lockForRead();
         _tree->writeToSVOFile(_filename);
         _tree->clearDirtyBit(); // tree is clean after saving
+        _tree->unlock();
         printf("DONE saving voxels to file...\n");
     }
 
@@ -0,0 +1,145 @@
+//
+//  VoxelSendRateController.cpp
+//  voxel-server
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Per client rate control for voxel sending, driven by the client's acks
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <SharedUtil.h>
+
+#include "VoxelSendRateController.h"
+
+VoxelSendRateController::VoxelSendRateController(int initialBytesPerInterval, int maxBytesPerInterval) :
+    _bytesPerInterval(initialBytesPerInterval),
+    _maxBytesPerInterval(std::max(maxBytesPerInterval, MAX_VOXEL_PACKET_SIZE)),
+    _usedWholeBudget(false),
+    _nextSequence(0),
+    _packetsSentSinceAck(0),
+    _haveAck(false),
+    _lastAckTime(0),
+    _lastAckedSequence(0),
+    _lastAckedPacketsReceived(0),
+    _packetLoss(0.0f),
+    _averageRoundTripUsecs(0.0f),
+    _shortestRoundTripUsecs(0),
+    _shortestRoundTripInWindowUsecs(0),
+    _roundTripWindowStart(0),
+    _lastDecrease(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    memset(_sentTimes, 0, sizeof(_sentTimes));
+}
+
+VoxelSendRateController::~VoxelSendRateController() {
+    pthread_mutex_destroy(&_mutex);
+}
+
+VOXEL_PACKET_SEQUENCE VoxelSendRateController::packetSent() {
+    pthread_mutex_lock(&_mutex);
+    VOXEL_PACKET_SEQUENCE sequence = _nextSequence++;
+    _sentTimes[sequence % SENT_TIMES_KEPT] = usecTimestampNow();
+    _packetsSentSinceAck++;
+    pthread_mutex_unlock(&_mutex);
+    return sequence;
+}
+
+void VoxelSendRateController::intervalSent(int bytesSent) {
+    pthread_mutex_lock(&_mutex);
+    _usedWholeBudget = (bytesSent >= (int)_bytesPerInterval);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void VoxelSendRateController::ackReceived(VOXEL_PACKET_SEQUENCE newestSequence, uint32_t packetsReceived) {
+    uint64_t now = usecTimestampNow();
+    pthread_mutex_lock(&_mutex);
+
+    // measure the round trip, as long as we still remember when the acked packet was sent
+    VOXEL_PACKET_SEQUENCE packetsSentSinceAcked = _nextSequence - newestSequence;
+    if (packetsSentSinceAcked > 0 && packetsSentSinceAcked <= SENT_TIMES_KEPT) {
+        uint64_t roundTripUsecs = now - _sentTimes[newestSequence % SENT_TIMES_KEPT];
+
+        const float ROUND_TRIP_SMOOTHING = 0.125f;
+        _averageRoundTripUsecs = (_averageRoundTripUsecs == 0.0f) ? roundTripUsecs
+            : _averageRoundTripUsecs + ROUND_TRIP_SMOOTHING * (roundTripUsecs - _averageRoundTripUsecs);
+
+        if (_shortestRoundTripUsecs == 0 || roundTripUsecs < _shortestRoundTripUsecs) {
+            _shortestRoundTripUsecs = roundTripUsecs;
+        }
+        if (_shortestRoundTripInWindowUsecs == 0 || roundTripUsecs < _shortestRoundTripInWindowUsecs) {
+            _shortestRoundTripInWindowUsecs = roundTripUsecs;
+        }
+        if (now - _roundTripWindowStart > SHORTEST_ROUND_TRIP_WINDOW_USECS) {
+            _shortestRoundTripUsecs = _shortestRoundTripInWindowUsecs;
+            _shortestRoundTripInWindowUsecs = 0;
+            _roundTripWindowStart = now;
+        }
+    }
+
+    if (_haveAck) {
+        // how many packets went out between the last ack and this one, and how many of them made it
+        VOXEL_PACKET_SEQUENCE packetsExpected = newestSequence - _lastAckedSequence;
+        uint32_t packetsArrived = packetsReceived - _lastAckedPacketsReceived;
+
+        // packets that come in out of order can make an ack look older than the last one, just wait for the next
+        if (packetsExpected > 0 && packetsExpected < SENT_TIMES_KEPT) {
+            _packetLoss = std::max(0.0f, 1.0f - (float)packetsArrived / packetsExpected);
+
+            bool congested = _packetLoss > CONGESTED_PACKET_LOSS
+                || _averageRoundTripUsecs > _shortestRoundTripUsecs * CONGESTED_ROUND_TRIP_RATIO
+                                            + CONGESTED_ROUND_TRIP_SLACK_USECS;
+            if (congested) {
+                decreaseBudget(now);
+            } else if (_usedWholeBudget) {
+                _bytesPerInterval = std::min(_bytesPerInterval + BUDGET_INCREASE_BYTES, (float)_maxBytesPerInterval);
+            }
+
+            _lastAckedSequence = newestSequence;
+            _lastAckedPacketsReceived = packetsReceived;
+        }
+    } else {
+        _haveAck = true;
+        _lastAckedSequence = newestSequence;
+        _lastAckedPacketsReceived = packetsReceived;
+    }
+
+    _lastAckTime = now;
+    _packetsSentSinceAck = 0;
+    pthread_mutex_unlock(&_mutex);
+}
+
+int VoxelSendRateController::getBytesPerInterval() {
+    uint64_t now = usecTimestampNow();
+    pthread_mutex_lock(&_mutex);
+
+    // if the acks have stopped coming while we're still sending, either they or our packets aren't getting through
+    if (_haveAck && _packetsSentSinceAck > 0 && now - _lastAckTime > ACK_TIMEOUT_USECS
+        && now - _lastDecrease > ACK_TIMEOUT_USECS) {
+        decreaseBudget(now);
+    }
+    int bytesPerInterval = _bytesPerInterval;
+    pthread_mutex_unlock(&_mutex);
+    return bytesPerInterval;
+}
+
+void VoxelSendRateController::decreaseBudget(uint64_t now) {
+    // the acks that show congestion keep coming for a round trip after we slow down, only back off once for them
+    if (now - _lastDecrease > _averageRoundTripUsecs) {
+        _bytesPerInterval = std::max(_bytesPerInterval * BUDGET_DECREASE_FACTOR, (float)MAX_VOXEL_PACKET_SIZE);
+        _lastDecrease = now;
+    }
+}
+
+void VoxelSendRateController::printDebugDetails() {
+    pthread_mutex_lock(&_mutex);
+    printf("VoxelSendRateController: %d bytes per interval, %.1f%% packet loss, round trip %.1f ms (shortest %.1f ms)\n",
+           (int)_bytesPerInterval, _packetLoss * 100.0f, _averageRoundTripUsecs / 1000.0f,
+           _shortestRoundTripUsecs / 1000.0f);
+    pthread_mutex_unlock(&_mutex);
+}
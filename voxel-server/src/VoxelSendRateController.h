@@ -0,0 +1,94 @@
+//
+//  VoxelSendRateController.h
+//  voxel-server
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Per client rate control for voxel sending, driven by the client's acks
+//
+
+#ifndef __voxel_server__VoxelSendRateController__
+#define __voxel_server__VoxelSendRateController__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <VoxelConstants.h>
+
+/// How many of the most recently sent packets we remember the send time of, for measuring round trips
+const int SENT_TIMES_KEPT = 256;
+
+/// Packet loss over this portion of the packets sent means the client's link is congested
+const float CONGESTED_PACKET_LOSS = 0.02f;
+
+/// Round trips this many times the shortest we've seen (plus some slack for jitter) mean our packets are queueing up
+/// somewhere on the way to the client
+const float CONGESTED_ROUND_TRIP_RATIO = 2.0f;
+const uint64_t CONGESTED_ROUND_TRIP_SLACK_USECS = 10 * 1000;
+
+/// How long we remember the shortest round trip for, so that a client whose route changes isn't seen as congested forever
+const uint64_t SHORTEST_ROUND_TRIP_WINDOW_USECS = 10 * 1000 * 1000;
+
+/// If we've been sending and haven't heard an ack for this long, we treat it as congestion
+const uint64_t ACK_TIMEOUT_USECS = 1000 * 1000;
+
+/// How much the send budget shrinks on congestion, and grows with each ack that shows none
+const float BUDGET_DECREASE_FACTOR = 0.75f;
+const int BUDGET_INCREASE_BYTES = MAX_VOXEL_PACKET_SIZE / 2;
+
+/// Decides how many bytes of voxel packets each client can take every send interval. The budget grows additively for as
+/// long as the client's acks show its packets are getting through, and shrinks multiplicatively, at most once per round
+/// trip, when they show packet loss or growing round trips. Acks are received on a different thread than the one
+/// sending, so everything here is locked.
+class VoxelSendRateController {
+public:
+    VoxelSendRateController(int initialBytesPerInterval, int maxBytesPerInterval);
+    ~VoxelSendRateController();
+
+    /// Call this each time a voxel packet is sent to the client, returns the sequence number to stamp it with.
+    VOXEL_PACKET_SEQUENCE packetSent();
+
+    /// Call this at the end of each send interval. If the whole budget was used, the client may be able to take more.
+    void intervalSent(int bytesSent);
+
+    /// Call this when the client acks our packets.
+    /// \param VOXEL_PACKET_SEQUENCE newestSequence the newest sequence number the client has received
+    /// \param uint32_t packetsReceived the total number of voxel packets the client has received from us
+    void ackReceived(VOXEL_PACKET_SEQUENCE newestSequence, uint32_t packetsReceived);
+
+    int getBytesPerInterval();
+
+    void printDebugDetails();
+
+private:
+    // intentionally not implemented
+    VoxelSendRateController(const VoxelSendRateController&);
+    VoxelSendRateController& operator= (const VoxelSendRateController&);
+
+    void decreaseBudget(uint64_t now);
+
+    pthread_mutex_t _mutex;
+
+    float _bytesPerInterval;
+    int _maxBytesPerInterval;
+    bool _usedWholeBudget;
+
+    VOXEL_PACKET_SEQUENCE _nextSequence;
+    uint64_t _sentTimes[SENT_TIMES_KEPT]; // indexed by sequence number modulo SENT_TIMES_KEPT
+    int _packetsSentSinceAck;
+
+    bool _haveAck;
+    uint64_t _lastAckTime;
+    VOXEL_PACKET_SEQUENCE _lastAckedSequence;
+    uint32_t _lastAckedPacketsReceived;
+    float _packetLoss;
+
+    float _averageRoundTripUsecs;
+    uint64_t _shortestRoundTripUsecs;
+    uint64_t _shortestRoundTripInWindowUsecs;
+    uint64_t _roundTripWindowStart;
+    uint64_t _lastDecrease;
+};
+
+#endif // __voxel_server__VoxelSendRateController__
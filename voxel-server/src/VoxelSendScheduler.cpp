@@ -0,0 +1,245 @@
+//
+//  VoxelSendScheduler.cpp
+//  voxel-server
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Runs the voxel senders of all the clients on a fixed pool of worker threads
+//
+
+#include <algorithm>
+#include <unistd.h>
+
+#include <SharedUtil.h>
+
+#include "VoxelSendScheduler.h"
+#include "VoxelSendThread.h"
+#include "VoxelServer.h"
+
+VoxelSendScheduler::VoxelSendScheduler(int workerCount) :
+    _nextQueue(0)
+{
+    if (workerCount <= 0) {
+        workerCount = std::max((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    }
+    pthread_mutex_init(&_jobsMutex, NULL);
+    pthread_cond_init(&_jobFinished, NULL);
+    for (int i = 0; i < workerCount; i++) {
+        Queue* queue = new Queue;
+        pthread_mutex_init(&queue->mutex, NULL);
+        _queues.push_back(queue);
+        _workers.push_back(new VoxelSendWorker(this, i));
+    }
+}
+
+VoxelSendScheduler::~VoxelSendScheduler() {
+    terminate();
+    for (int i = 0; i < _workers.size(); i++) {
+        delete _workers[i];
+        pthread_mutex_destroy(&_queues[i]->mutex);
+        delete _queues[i];
+    }
+    for (std::map<VoxelSendThread*, Job*>::iterator i = _jobs.begin(); i != _jobs.end(); i++) {
+        delete i->second;
+    }
+    pthread_cond_destroy(&_jobFinished);
+    pthread_mutex_destroy(&_jobsMutex);
+}
+
+void VoxelSendScheduler::initialize() {
+    for (int i = 0; i < _workers.size(); i++) {
+        _workers[i]->initialize(true);
+    }
+}
+
+void VoxelSendScheduler::terminate() {
+    for (int i = 0; i < _workers.size(); i++) {
+        _workers[i]->terminate();
+    }
+}
+
+void VoxelSendScheduler::addSender(VoxelSendThread* sender) {
+    Job* job = new Job;
+    job->sender = sender;
+    job->dueTime = usecTimestampNow();
+    job->isRunning = false;
+    job->isRemoved = false;
+
+    // deal new senders out to the workers round robin, stealing will even things out from there
+    pthread_mutex_lock(&_jobsMutex);
+    _jobs[sender] = job;
+    int queueIndex = _nextQueue;
+    _nextQueue = (_nextQueue + 1) % _queues.size();
+    pthread_mutex_unlock(&_jobsMutex);
+
+    Queue* queue = _queues[queueIndex];
+    pthread_mutex_lock(&queue->mutex);
+    queue->jobs.push_back(job);
+    std::push_heap(queue->jobs.begin(), queue->jobs.end(), isDueLater);
+    pthread_mutex_unlock(&queue->mutex);
+
+    _workers[queueIndex]->wakeUp();
+}
+
+void VoxelSendScheduler::removeSender(VoxelSendThread* sender) {
+    pthread_mutex_lock(&_jobsMutex);
+    std::map<VoxelSendThread*, Job*>::iterator found = _jobs.find(sender);
+    if (found == _jobs.end()) {
+        pthread_mutex_unlock(&_jobsMutex);
+        return;
+    }
+    Job* job = found->second;
+    _jobs.erase(found);
+    job->isRemoved = true;
+    while (job->isRunning) {
+        pthread_cond_wait(&_jobFinished, &_jobsMutex);
+    }
+    pthread_mutex_unlock(&_jobsMutex);
+
+    // Workers check isRemoved while holding the lock of the queue they took the job from, so once we've held each queue's
+    // lock, no worker can still be holding on to the job, and it's either in one of the queues or it's been dropped.
+    for (int i = 0; i < _queues.size(); i++) {
+        Queue* queue = _queues[i];
+        pthread_mutex_lock(&queue->mutex);
+        std::vector<Job*>::iterator queued = std::find(queue->jobs.begin(), queue->jobs.end(), job);
+        if (queued != queue->jobs.end()) {
+            queue->jobs.erase(queued);
+            std::make_heap(queue->jobs.begin(), queue->jobs.end(), isDueLater);
+        }
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    delete job;
+}
+
+bool VoxelSendScheduler::runNextJob(int workerIndex) {
+    uint64_t now = usecTimestampNow();
+
+    // our own queue first, then look for overdue senders on the other workers
+    Job* job = takeDueJob(workerIndex, now, false);
+    for (int i = 1; !job && i < _queues.size(); i++) {
+        job = takeDueJob((workerIndex + i) % _queues.size(), now, true);
+    }
+    if (!job) {
+        return false;
+    }
+    runJob(workerIndex, job);
+    return true;
+}
+
+VoxelSendScheduler::Job* VoxelSendScheduler::takeDueJob(int queueIndex, uint64_t now, bool isStealing) {
+    Queue* queue = _queues[queueIndex];
+    if (isStealing) {
+        // don't wait on a busy queue when stealing, its own worker is probably taking care of it
+        if (pthread_mutex_trylock(&queue->mutex) != 0) {
+            return NULL;
+        }
+    } else {
+        pthread_mutex_lock(&queue->mutex);
+    }
+
+    Job* job = NULL;
+    while (!queue->jobs.empty() && queue->jobs.front()->dueTime <= now) {
+        std::pop_heap(queue->jobs.begin(), queue->jobs.end(), isDueLater);
+        Job* dueJob = queue->jobs.back();
+        queue->jobs.pop_back();
+
+        pthread_mutex_lock(&_jobsMutex);
+        bool isRemoved = dueJob->isRemoved;
+        if (!isRemoved) {
+            dueJob->isRunning = true;
+        }
+        pthread_mutex_unlock(&_jobsMutex);
+
+        // removed jobs are simply dropped, the remover deletes them
+        if (!isRemoved) {
+            job = dueJob;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return job;
+}
+
+bool VoxelSendScheduler::getNextDueTime(int workerIndex, uint64_t& nextDueTime) {
+    Queue* queue = _queues[workerIndex];
+    pthread_mutex_lock(&queue->mutex);
+    bool hasJobs = !queue->jobs.empty();
+    if (hasJobs) {
+        nextDueTime = queue->jobs.front()->dueTime;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return hasJobs;
+}
+
+void VoxelSendScheduler::wakeOtherWorkers(int workerIndex) {
+    for (int i = 0; i < _workers.size(); i++) {
+        if (i != workerIndex) {
+            _workers[i]->wakeUp();
+        }
+    }
+}
+
+int VoxelSendScheduler::getSendSliceUsecs() const {
+    // each sender gets its share of the workers' time, but never more than it would have with a worker to itself
+    int senderCount = std::max((int)_jobs.size(), 1);
+    int sliceUsecs = std::min((int)(((int64_t)_workers.size() * VOXEL_SEND_INTERVAL_USECS) / senderCount),
+                              VOXEL_SEND_INTERVAL_USECS);
+    return std::max(sliceUsecs - SENDING_TIME_TO_SPARE, MIN_SEND_SLICE_USECS);
+}
+
+void VoxelSendScheduler::runJob(int workerIndex, Job* job) {
+    uint64_t start = usecTimestampNow();
+    pthread_mutex_lock(&_jobsMutex);
+    int sliceUsecs = getSendSliceUsecs();
+    pthread_mutex_unlock(&_jobsMutex);
+
+    job->sender->setSendDeadline(start + sliceUsecs);
+    job->sender->threadRoutine(); // the sender is in non-threaded mode, so this runs it once
+
+    // the sender is due again one interval after this run started, or right away if it took longer than that. We keep it
+    // on our own queue, so a stolen sender stays with the worker that stole it.
+    job->dueTime = start + VOXEL_SEND_INTERVAL_USECS;
+    if (::debugVoxelSending && job->dueTime < usecTimestampNow()) {
+        printf("Last send took too much time, not waiting!\n");
+    }
+
+    Queue* queue = _queues[workerIndex];
+    pthread_mutex_lock(&queue->mutex);
+    pthread_mutex_lock(&_jobsMutex);
+    job->isRunning = false;
+    if (!job->isRemoved) {
+        queue->jobs.push_back(job);
+        std::push_heap(queue->jobs.begin(), queue->jobs.end(), isDueLater);
+    }
+    pthread_cond_broadcast(&_jobFinished);
+    pthread_mutex_unlock(&_jobsMutex);
+    bool isFallingBehind = !queue->jobs.empty() && queue->jobs.front()->dueTime < usecTimestampNow();
+    pthread_mutex_unlock(&queue->mutex);
+
+    // we already have another overdue sender, so the idle workers can take it off our hands
+    if (isFallingBehind) {
+        wakeOtherWorkers(workerIndex);
+    }
+}
+
+VoxelSendWorker::VoxelSendWorker(VoxelSendScheduler* scheduler, int workerIndex) :
+    _scheduler(scheduler),
+    _workerIndex(workerIndex) {
+}
+
+bool VoxelSendWorker::process() {
+    if (!_scheduler->runNextJob(_workerIndex)) {
+        // nothing's due, so sleep until our next sender is, unless we're woken up for a new sender or to steal one
+        uint64_t nextDueTime;
+        if (!_scheduler->getNextDueTime(_workerIndex, nextDueTime)) {
+            waitForWork();
+        } else {
+            uint64_t now = usecTimestampNow();
+            if (nextDueTime > now) {
+                waitForWork(nextDueTime - now);
+            }
+        }
+    }
+    return isStillRunning();  // keep running till they terminate us
+}
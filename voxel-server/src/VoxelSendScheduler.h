@@ -0,0 +1,110 @@
+//
+//  VoxelSendScheduler.h
+//  voxel-server
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
+//
+//  Runs the voxel senders of all the clients on a fixed pool of worker threads
+//
+
+#ifndef __voxel_server__VoxelSendScheduler__
+#define __voxel_server__VoxelSendScheduler__
+
+#include <map>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include <GenericThread.h>
+
+class VoxelSendThread;
+class VoxelSendWorker;
+
+/// Shortest time slice a sender is given, even when the workers are oversubscribed
+const int MIN_SEND_SLICE_USECS = 1000;
+
+/// Runs the VoxelSendThreads of all the connected clients, in non-threaded mode, on a fixed pool of worker threads instead
+/// of one thread per client. Each sender is due again VOXEL_SEND_INTERVAL_USECS after its last run started, and workers
+/// always run the sender with the earliest due time first. Each worker keeps its own queue of senders, and a worker with
+/// nothing due steals overdue senders from the other workers. Idle workers sleep until their next sender is due, or until
+/// they're handed a new sender, or another worker falls behind and wakes them to steal from it. The time a sender may
+/// spend sending each time it runs is its fair share of the workers' time, so that one busy client can't starve the
+/// others.
+class VoxelSendScheduler {
+public:
+    /// \param int workerCount the number of worker threads, or 0 for one per processor core
+    VoxelSendScheduler(int workerCount = 0);
+    ~VoxelSendScheduler();
+
+    void initialize();
+    void terminate();
+
+    /// Starts running a sender, it's due right away. The scheduler doesn't take ownership of the sender.
+    void addSender(VoxelSendThread* sender);
+
+    /// Stops running a sender, if it's currently being run this blocks until it's done. After this returns the sender
+    /// can safely be deleted.
+    void removeSender(VoxelSendThread* sender);
+
+    int getWorkerCount() const { return _workers.size(); }
+
+private:
+    friend class VoxelSendWorker;
+
+    // intentionally not implemented
+    VoxelSendScheduler(const VoxelSendScheduler&);
+    VoxelSendScheduler& operator= (const VoxelSendScheduler&);
+
+    struct Job {
+        VoxelSendThread*    sender;
+        uint64_t            dueTime;
+        bool                isRunning;
+        bool                isRemoved;
+    };
+
+    /// Runs the next due job, either from the worker's own queue or stolen from another worker's. Returns false if
+    /// there was nothing due.
+    bool runNextJob(int workerIndex);
+
+    /// Gets the time the next job on the worker's own queue is due. Returns false if its queue is empty.
+    bool getNextDueTime(int workerIndex, uint64_t& nextDueTime);
+
+    /// Wakes the other workers, so they can steal the overdue jobs of a worker that's fallen behind
+    void wakeOtherWorkers(int workerIndex);
+
+    Job* takeDueJob(int workerIndex, uint64_t now, bool isStealing);
+    void runJob(int workerIndex, Job* job);
+    int getSendSliceUsecs() const;
+
+    struct Queue {
+        pthread_mutex_t     mutex;
+        std::vector<Job*>   jobs; // a min heap on dueTime
+    };
+
+    static bool isDueLater(const Job* a, const Job* b) { return a->dueTime > b->dueTime; }
+
+    std::vector<VoxelSendWorker*>   _workers;
+    std::vector<Queue*>             _queues;
+
+    // lock order is a queue's mutex first, then the jobs mutex
+    pthread_mutex_t                         _jobsMutex;
+    pthread_cond_t                          _jobFinished;
+    std::map<VoxelSendThread*, Job*>        _jobs;
+    int                                     _nextQueue;
+};
+
+/// One of the worker threads of a VoxelSendScheduler
+class VoxelSendWorker : public GenericThread {
+public:
+    VoxelSendWorker(VoxelSendScheduler* scheduler, int workerIndex);
+
+protected:
+    virtual bool process();
+
+private:
+    VoxelSendScheduler* _scheduler;
+    int                 _workerIndex;
+};
+
+#endif // __voxel_server__VoxelSendScheduler__
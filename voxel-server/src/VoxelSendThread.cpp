@@ -11,17 +11,31 @@
 #include <NodeList.h>
 #include <SharedUtil.h>
 #include <PacketHeaders.h>
+#include <VoxelEncodeCache.h>
 
 #include "VoxelSendThread.h"
 #include "VoxelServer.h"
 
 VoxelSendThread::VoxelSendThread(uint16_t nodeID) :
-    _nodeID(nodeID) {
+    _nodeID(nodeID),
+    _sendDeadline(0),
+    _queuedPacketCount(0),
+    _encodeUsecsMetric(MetricsRegistry::getInstance()->getHistogram("voxel_server_encode_usecs",
+                                                                    "Time taken to encode each subtree, in usecs")),
+    _sendUsecsMetric(MetricsRegistry::getInstance()->getHistogram("voxel_server_client_send_usecs",
+                                                                  "Time taken to send a client its voxels, in usecs")),
+    _packetsSentMetric(MetricsRegistry::getInstance()->getCounter("voxel_server_sent_packets_total",
+                                                                  "Voxel packets sent")),
+    _bytesSentMetric(MetricsRegistry::getInstance()->getCounter("voxel_server_sent_bytes_total", "Voxel bytes sent")) {
 }
 
 bool VoxelSendThread::process() {
-    uint64_t  lastSendTime = usecTimestampNow();
-    
+    // if we're being run in threaded mode, we have a whole send interval to ourselves
+    uint64_t lastSendTime = usecTimestampNow();
+    if (_sendDeadline < lastSendTime) {
+        _sendDeadline = lastSendTime + VOXEL_SEND_INTERVAL_USECS - SENDING_TIME_TO_SPARE;
+    }
+
     Node* node = NodeList::getInstance()->nodeWithID(_nodeID);
     VoxelNodeData* nodeData = NULL;
     
@@ -38,14 +52,17 @@ bool VoxelSendThread::process() {
         deepestLevelVoxelDistributor(node, nodeData, viewFrustumChanged);
     }
     
-    // dynamically sleep until we need to fire off the next set of voxels
-    int usecToSleep =  VOXEL_SEND_INTERVAL_USECS - (usecTimestampNow() - lastSendTime);
-    
-    if (usecToSleep > 0) {
-        usleep(usecToSleep);
-    } else {
-        if (::debugVoxelSending) {
-            std::cout << "Last send took too much time, not sleeping!\n";
+    // when we're run by the VoxelSendScheduler it decides when we're next due, otherwise dynamically sleep until we need
+    // to fire off the next set of voxels
+    if (isThreaded()) {
+        int usecToSleep =  VOXEL_SEND_INTERVAL_USECS - (usecTimestampNow() - lastSendTime);
+        
+        if (usecToSleep > 0) {
+            usleep(usecToSleep);
+        } else {
+            if (::debugVoxelSending) {
+                std::cout << "Last send took too much time, not sleeping!\n";
+            }
         }
     }
     
@@ -54,6 +71,26 @@ bool VoxelSendThread::process() {
 
 
 void VoxelSendThread::handlePacketSend(Node* node, VoxelNodeData* nodeData, int& trueBytesSent, int& truePacketsSent) {
+    sendPacketWrites(node, nodeData, 0, nodeData->getPacketWriteCount(), trueBytesSent, truePacketsSent);
+    nodeData->resetVoxelPacket();
+}
+
+void VoxelSendThread::sendPacketWrites(Node* node, VoxelNodeData* nodeData, int firstWrite, int lastWrite,
+                                       int& trueBytesSent, int& truePacketsSent) {
+
+    // The waiting packet usually goes out as a single packet, but if it compressed worse than we expected, we split it
+    // up. A single write always fits in a packet uncompressed.
+    if (!nodeData->packPacketToSend(firstWrite, lastWrite)) {
+        int middleWrite = (firstWrite + lastWrite) / 2;
+        sendPacketWrites(node, nodeData, firstWrite, middleWrite, trueBytesSent, truePacketsSent);
+        sendPacketWrites(node, nodeData, middleWrite, lastWrite, trueBytesSent, truePacketsSent);
+        return;
+    }
+    const unsigned char* packet = nodeData->getPacketToSend();
+    int packetLength = nodeData->getPacketToSendLength();
+
+    // number the packet, so that the client's acks can tell us how our packets are getting through
+    nodeData->setPacketToSendSequence(nodeData->rateController.packetSent());
 
     // If we've got a stats message ready to send, then see if we can piggyback them together
     if (nodeData->stats.isReadyToSend()) {
@@ -62,37 +99,58 @@ void VoxelSendThread::handlePacketSend(Node* node, VoxelNodeData* nodeData, int&
         int statsMessageLength = nodeData->stats.getStatsMessageLength();
 
         // If the size of the stats message and the voxel message will fit in a packet, then piggyback them
-        if (nodeData->getPacketLength() + statsMessageLength < MAX_PACKET_SIZE) {
+        if (packetLength + statsMessageLength < MAX_PACKET_SIZE) {
 
             // copy voxel message to back of stats message
-            memcpy(statsMessage + statsMessageLength, nodeData->getPacket(), nodeData->getPacketLength());
-            statsMessageLength += nodeData->getPacketLength();
+            memcpy(statsMessage + statsMessageLength, packet, packetLength);
+            statsMessageLength += packetLength;
 
             // actually send it
-            NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(), statsMessage, statsMessageLength);
+            queuePacket(node, statsMessage, statsMessageLength);
         } else {
             // not enough room in the packet, send two packets
-            NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(), statsMessage, statsMessageLength);
-            NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(),
-                                            nodeData->getPacket(), nodeData->getPacketLength());
+            queuePacket(node, statsMessage, statsMessageLength);
+            queuePacket(node, packet, packetLength);
         }
     } else {
         // just send the voxel packet
-        NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(),
-                                        nodeData->getPacket(), nodeData->getPacketLength());
+        queuePacket(node, packet, packetLength);
     }
     // remember to track our stats
-    nodeData->stats.packetSent(nodeData->getPacketLength());
-    trueBytesSent += nodeData->getPacketLength();
+    nodeData->stats.packetSent(packetLength);
+    trueBytesSent += packetLength;
     truePacketsSent++;
-    nodeData->resetVoxelPacket();
+}
+
+void VoxelSendThread::queuePacket(Node* node, const unsigned char* packet, int packetLength) {
+    if (_queuedPacketCount == VOXEL_SEND_BATCH_PACKETS) {
+        flushPackets();
+    }
+    memcpy(_queuedPacketData[_queuedPacketCount], packet, packetLength);
+    _queuedPackets[_queuedPacketCount].address = node->getActiveSocket();
+    _queuedPackets[_queuedPacketCount].data = _queuedPacketData[_queuedPacketCount];
+    _queuedPackets[_queuedPacketCount].byteLength = packetLength;
+    _queuedPacketCount++;
+}
+
+void VoxelSendThread::flushPackets() {
+    if (_queuedPacketCount > 0) {
+        NodeList::getInstance()->getNodeSocket()->sendBatch(_queuedPackets, _queuedPacketCount);
+
+        int bytesSent = 0;
+        for (int i = 0; i < _queuedPacketCount; i++) {
+            bytesSent += _queuedPackets[i].byteLength;
+        }
+        _packetsSentMetric->add(_queuedPacketCount);
+        _bytesSentMetric->add(bytesSent);
+
+        _queuedPacketCount = 0;
+    }
 }
 
 /// Version of voxel distributor that sends the deepest LOD level at once
 void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* nodeData, bool viewFrustumChanged) {
 
-    pthread_mutex_lock(&::treeLock);
-
     int truePacketsSent = 0;
     int trueBytesSent = 0;
 
@@ -141,6 +199,10 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
             );
     }
     
+    // We only hold the tree's read lock while we're touching the tree or our nodeBag (which edits can change), so
+    // other clients can encode at the same time, edits get in between our packets, and we never hold it while sending.
+    ::serverTree.lockForRead();
+
     // If the current view frustum has changed OR we have nothing to send, then search against 
     // the current view frustum for things to send.
     if (viewFrustumChanged || nodeData->nodeBag.isEmpty()) {
@@ -165,6 +227,10 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
         if (viewFrustumChanged) {
             if (::dumpVoxelsOnMove) {
                 nodeData->nodeBag.deleteAll();
+            } else {
+                // the nodes still waiting to be sent are now nearer or further than they were, so re-sort them
+                nodeData->nodeBag.setPriorityFunction(VoxelNodeBag::nearestToCameraFirst,
+                                                      &nodeData->getCurrentViewFrustum());
             }
             nodeData->map.erase();
         } 
@@ -179,6 +245,9 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
         
         if (::displayVoxelStats) {
             nodeData->stats.printDebugDetails();
+            if (::encodeCache) {
+                ::encodeCache->printDebugDetails();
+            }
         }
         
         // start tracking our stats
@@ -194,21 +263,26 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
         nodeData->nodeBag.insert(serverTree.rootNode);
     }
 
+    bool bagWasEmpty = nodeData->nodeBag.isEmpty();
+    ::serverTree.unlock();
+
     // If we have something in our nodeBag, then turn them into packets and send them out...
-    if (!nodeData->nodeBag.isEmpty()) {
+    if (!bagWasEmpty) {
         int bytesWritten = 0;
-        int packetsSentThisInterval = 0;
         uint64_t start = usecTimestampNow();
 
+        // the client's rate controller decides how much its link can take this interval
         bool shouldSendEnvironments = ::sendEnvironments && shouldDo(ENVIRONMENT_SEND_INTERVAL_USECS, VOXEL_SEND_INTERVAL_USECS);
-        while (packetsSentThisInterval < PACKETS_PER_CLIENT_PER_INTERVAL - (shouldSendEnvironments ? 1 : 0)) {        
+        int bytesThisInterval = nodeData->rateController.getBytesPerInterval()
+                                - (shouldSendEnvironments ? MAX_VOXEL_PACKET_SIZE : 0);
+        while (trueBytesSent < bytesThisInterval) {
             // Check to see if we're taking too long, and if so bail early...
             uint64_t now = usecTimestampNow();
             long elapsedUsec = (now - start);
             long elapsedUsecPerPacket = (truePacketsSent == 0) ? 0 : (elapsedUsec / truePacketsSent);
-            long usecRemaining = (VOXEL_SEND_INTERVAL_USECS - elapsedUsec);
+            long usecRemaining = (long)(_sendDeadline - now);
             
-            if (elapsedUsecPerPacket + SENDING_TIME_TO_SPARE > usecRemaining) {
+            if (elapsedUsecPerPacket > usecRemaining) {
                 if (::debugVoxelSending) {
                     printf("packetLoop() usecRemaining=%ld bailing early took %ld usecs to generate %d bytes in %d packets (%ld usec avg), %d nodes still to send\n",
                             usecRemaining, elapsedUsec, trueBytesSent, truePacketsSent, elapsedUsecPerPacket,
@@ -217,7 +291,9 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                 break;
             }            
             
-            if (!nodeData->nodeBag.isEmpty()) {
+            ::serverTree.lockForRead();
+            bool haveNodesToSend = !nodeData->nodeBag.isEmpty();
+            if (haveNodesToSend) {
                 VoxelNode* subTree = nodeData->nodeBag.extract();
                 bool wantOcclusionCulling = nodeData->getWantOcclusionCulling();
                 CoverageMap* coverageMap = wantOcclusionCulling ? &nodeData->map : IGNORE_COVERAGE_MAP;
@@ -231,18 +307,22 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                                              WANT_EXISTS_BITS, DONT_CHOP, wantDelta, lastViewFrustum,
                                              wantOcclusionCulling, coverageMap, boundaryLevelAdjust,
                                              nodeData->getLastTimeBagEmpty(),
-                                             isFullScene, &nodeData->stats, ::jurisdiction);
+                                             isFullScene, &nodeData->stats, ::jurisdiction, ::encodeCache);
                       
                 nodeData->stats.encodeStarted();
-                bytesWritten = serverTree.encodeTreeBitstream(subTree, _tempOutputBuffer, MAX_VOXEL_PACKET_SIZE - 1,
+                uint64_t encodeStart = usecTimestampNow();
+                bytesWritten = serverTree.encodeTreeBitstream(subTree, _tempOutputBuffer, MAX_VOXEL_PACKET_DATA_SIZE,
                                                               nodeData->nodeBag, params);
+                _encodeUsecsMetric->record(usecTimestampNow() - encodeStart);
                 nodeData->stats.encodeStopped();
+            }
+            ::serverTree.unlock();
 
+            if (haveNodesToSend) {
                 if (nodeData->getAvailable() >= bytesWritten) {
                     nodeData->writeToPacket(_tempOutputBuffer, bytesWritten);
                 } else {
                     handlePacketSend(node, nodeData, trueBytesSent, truePacketsSent);
-                    packetsSentThisInterval++;
                     nodeData->resetVoxelPacket();
                     nodeData->writeToPacket(_tempOutputBuffer, bytesWritten);
                 }
@@ -251,9 +331,11 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                     handlePacketSend(node, nodeData, trueBytesSent, truePacketsSent);
                     nodeData->resetVoxelPacket();
                 }
-                packetsSentThisInterval = PACKETS_PER_CLIENT_PER_INTERVAL; // done for now, no nodes left
+                break; // done for now, no nodes left
             }
         }
+        nodeData->rateController.intervalSent(trueBytesSent);
+
         // send the environment packet
         if (shouldSendEnvironments) {
             int numBytesPacketHeader = populateTypeAndVersion(_tempOutputBuffer, PACKET_TYPE_ENVIRONMENT_DATA);
@@ -264,12 +346,16 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
                 envPacketLength += environmentData[i].getBroadcastData(_tempOutputBuffer + envPacketLength);
             }
             
-            NodeList::getInstance()->getNodeSocket()->send(node->getActiveSocket(), _tempOutputBuffer, envPacketLength);
+            queuePacket(node, _tempOutputBuffer, envPacketLength);
             trueBytesSent += envPacketLength;
             truePacketsSent++;
         }
         
+        // everything we've got for this client this interval goes out together
+        flushPackets();
+
         uint64_t end = usecTimestampNow();
+        _sendUsecsMetric->record(end - start);
         int elapsedmsec = (end - start)/1000;
         if (elapsedmsec > 100) {
             if (elapsedmsec > 1000) {
@@ -283,11 +369,15 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
         } else if (::debugVoxelSending) {
             printf("packetLoop() took %d milliseconds to generate %d bytes in %d packets, %d nodes still to send\n",
                     elapsedmsec, trueBytesSent, truePacketsSent, nodeData->nodeBag.count());
+            nodeData->rateController.printDebugDetails();
         }
         
         // if after sending packets we've emptied our bag, then we want to remember that we've sent all 
         // the voxels from the current view frustum
-        if (nodeData->nodeBag.isEmpty()) {
+        ::serverTree.lockForRead();
+        bool bagIsEmpty = nodeData->nodeBag.isEmpty();
+        ::serverTree.unlock();
+        if (bagIsEmpty) {
             nodeData->updateLastKnownViewFrustum();
             nodeData->setViewSent(true);
             if (::debugVoxelSending) {
@@ -298,6 +388,7 @@ void VoxelSendThread::deepestLevelVoxelDistributor(Node* node, VoxelNodeData* no
         
     } // end if bag wasn't empty, and so we sent stuff...
 
-    pthread_mutex_unlock(&::treeLock);
+    // a partial packet we sent because the client changed its color choice may still be queued
+    flushPackets();
 }
 
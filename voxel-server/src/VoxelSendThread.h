@@ -12,26 +12,51 @@
 #define __voxel_server__VoxelSendThread__
 
 #include <GenericThread.h>
+#include <Metrics.h>
 #include <NetworkPacket.h>
 #include <VoxelTree.h>
 #include <VoxelNodeBag.h>
 #include "VoxelNodeData.h"
 
-/// Threaded processor for sending voxel packets to a single client
+/// How many packets a sender queues up before sending them all with one call. Each client has its own sender, so this
+/// is kept small enough not to cost much memory, while still covering a client's whole interval at the initial rate.
+const int VOXEL_SEND_BATCH_PACKETS = 16;
+
+/// Processor for sending voxel packets to a single client. Normally run in non-threaded mode by the VoxelSendScheduler,
+/// which calls threadRoutine() each time the client is due for more voxels.
 class VoxelSendThread : public virtual GenericThread {
 public:
     VoxelSendThread(uint16_t nodeID);
+
+    /// Sets the time by which the next run has to stop sending packets, so that other clients get their turn.
+    void setSendDeadline(uint64_t sendDeadline) { _sendDeadline = sendDeadline; }
 protected:
     /// Implements generic processing behavior for this thread.
     virtual bool process();
 
 private:
     uint16_t _nodeID;
+    uint64_t _sendDeadline;
 
     void handlePacketSend(Node* node, VoxelNodeData* nodeData, int& trueBytesSent, int& truePacketsSent);
+    void sendPacketWrites(Node* node, VoxelNodeData* nodeData, int firstWrite, int lastWrite,
+                          int& trueBytesSent, int& truePacketsSent);
     void deepestLevelVoxelDistributor(Node* node, VoxelNodeData* nodeData, bool viewFrustumChanged);
+
+    void queuePacket(Node* node, const unsigned char* packet, int packetLength);
+    void flushPackets();
     
     unsigned char _tempOutputBuffer[MAX_VOXEL_PACKET_SIZE];
+
+    // the packets of a run are queued up here and sent together
+    unsigned char _queuedPacketData[VOXEL_SEND_BATCH_PACKETS][MAX_PACKET_SIZE];
+    UDPBatchPacket _queuedPackets[VOXEL_SEND_BATCH_PACKETS];
+    int _queuedPacketCount;
+
+    MetricHistogram* _encodeUsecsMetric;
+    MetricHistogram* _sendUsecsMetric;
+    MetricCounter* _packetsSentMetric;
+    MetricCounter* _bytesSentMetric;
 };
 
 #endif // __voxel_server__VoxelSendThread__
@@ -15,6 +15,7 @@
 #include <JurisdictionSender.h>
 #include <VoxelTree.h>
 
+#include "VoxelSendScheduler.h"
 #include "VoxelServerPacketProcessor.h"
 
 
@@ -35,6 +36,7 @@ extern const char* LOCAL_VOXELS_PERSIST_FILE;
 extern const char* VOXELS_PERSIST_FILE;
 extern char voxelPersistFilename[MAX_FILENAME_LENGTH];
 extern int PACKETS_PER_CLIENT_PER_INTERVAL;
+extern int MAX_PACKETS_PER_CLIENT_PER_INTERVAL;
 
 extern VoxelTree serverTree; // this IS a reaveraging tree 
 extern bool wantVoxelPersist;
@@ -50,8 +52,9 @@ extern EnvironmentData environmentData[3];
 extern int receivedPacketCount;
 extern JurisdictionMap* jurisdiction;
 extern JurisdictionSender* jurisdictionSender;
+extern VoxelEncodeCache* encodeCache;
 extern VoxelServerPacketProcessor* voxelServerPacketProcessor;
-extern pthread_mutex_t treeLock;
+extern VoxelSendScheduler* voxelSendScheduler;
 
 
 
@@ -14,8 +14,17 @@
 #include "VoxelServer.h"
 #include "VoxelServerPacketProcessor.h"
 
+VoxelServerPacketProcessor::VoxelServerPacketProcessor() :
+    _processUsecsMetric(MetricsRegistry::getInstance()->getHistogram("voxel_server_edit_process_usecs",
+                                                                     "Time taken to process an edit packet, in usecs")),
+    _queueDepthMetric(MetricsRegistry::getInstance()->getGauge("voxel_server_edit_queue_depth",
+                                                               "Edit packets waiting to be processed"))
+{
+}
 
 void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned char* packetData, ssize_t packetLength) {
+    MetricTimer processTimer(_processUsecsMetric);
+    _queueDepthMetric->set(packetsToProcessCount());
 
     int numBytesPacketHeader = numBytesForPacketHeader(packetData);
     
@@ -41,6 +50,7 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
         }
         int atByte = numBytesPacketHeader + sizeof(itemNumber);
         unsigned char* voxelData = (unsigned char*)&packetData[atByte];
+        ::serverTree.lockForWrite();
         while (atByte < packetLength) {
             unsigned char octets = (unsigned char)*voxelData;
             const int COLOR_SIZE_IN_BYTES = 3;
@@ -62,6 +72,7 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
             voxelData += voxelDataSize;
             atByte += voxelDataSize;
         }
+        ::serverTree.unlock();
 
         // Make sure our Node and NodeList knows we've heard from this node.
         Node* node = NodeList::getInstance()->nodeWithAddress(&senderAddress);
@@ -72,9 +83,9 @@ void VoxelServerPacketProcessor::processPacket(sockaddr& senderAddress, unsigned
     } else if (packetData[0] == PACKET_TYPE_ERASE_VOXEL) {
 
         // Send these bits off to the VoxelTree class to process them
-        pthread_mutex_lock(&::treeLock);
+        ::serverTree.lockForWrite();
         ::serverTree.processRemoveVoxelBitstream((unsigned char*)packetData, packetLength);
-        pthread_mutex_unlock(&::treeLock);
+        ::serverTree.unlock();
 
         // Make sure our Node and NodeList knows we've heard from this node.
         Node* node = NodeList::getInstance()->nodeWithAddress(&senderAddress);
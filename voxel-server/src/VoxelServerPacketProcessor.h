@@ -11,12 +11,20 @@
 #ifndef __voxel_server__VoxelServerPacketProcessor__
 #define __voxel_server__VoxelServerPacketProcessor__
 
+#include <Metrics.h>
 #include <ReceivedPacketProcessor.h>
 
 /// Handles processing of incoming network packets for the voxel-server. As with other ReceivedPacketProcessor classes 
 /// the user is responsible for reading inbound packets and adding them to the processing queue by calling queueReceivedPacket()
 class VoxelServerPacketProcessor : public ReceivedPacketProcessor {
+public:
+    VoxelServerPacketProcessor();
+
 protected:
     virtual void processPacket(sockaddr& senderAddress, unsigned char*  packetData, ssize_t packetLength);
+
+private:
+    MetricHistogram* _processUsecsMetric;
+    MetricGauge* _queueDepthMetric;
 };
 #endif // __voxel_server__VoxelServerPacketProcessor__
@@ -22,6 +22,9 @@
 #include <SceneUtils.h>
 #include <PerfStat.h>
 #include <JurisdictionSender.h>
+#include <Metrics.h>
+#include <MetricsServer.h>
+#include <VoxelEncodeCache.h>
 
 #include "NodeWatcher.h"
 #include "VoxelPersistThread.h"
@@ -42,7 +45,8 @@
 const char* LOCAL_VOXELS_PERSIST_FILE = "resources/voxels.svo";
 const char* VOXELS_PERSIST_FILE = "/etc/highfidelity/voxel-server/resources/voxels.svo";
 char voxelPersistFilename[MAX_FILENAME_LENGTH];
-int PACKETS_PER_CLIENT_PER_INTERVAL = 10;
+int PACKETS_PER_CLIENT_PER_INTERVAL = 10; // where each client's rate controller starts out
+int MAX_PACKETS_PER_CLIENT_PER_INTERVAL = 100; // and the most it will go up to
 VoxelTree serverTree(true); // this IS a reaveraging tree 
 bool wantVoxelPersist = true;
 bool wantLocalDomain = false;
@@ -57,9 +61,11 @@ EnvironmentData environmentData[3];
 int receivedPacketCount = 0;
 JurisdictionMap* jurisdiction = NULL;
 JurisdictionSender* jurisdictionSender = NULL;
+VoxelEncodeCache* encodeCache = NULL;
 VoxelServerPacketProcessor* voxelServerPacketProcessor = NULL;
+VoxelSendScheduler* voxelSendScheduler = NULL;
 VoxelPersistThread* voxelPersistThread = NULL;
-pthread_mutex_t treeLock;
+MetricsServer* metricsServer = NULL;
 NodeWatcher nodeWatcher; // used to cleanup AGENT data when agents are killed
 
 void attachVoxelNodeDataToNode(Node* newNode) {
@@ -69,8 +75,6 @@ void attachVoxelNodeDataToNode(Node* newNode) {
 }
 
 int main(int argc, const char * argv[]) {
-    pthread_mutex_init(&::treeLock, NULL);
-    
     qInstallMessageHandler(sharedMessageHandler);
     
     int listenPort = VOXEL_LISTEN_PORT;
@@ -170,6 +174,15 @@ int main(int argc, const char * argv[]) {
     ::shouldShowAnimationDebug = cmdOptionExists(argc, argv, WANT_ANIMATION_DEBUG);
     printf("shouldShowAnimationDebug=%s\n", debug::valueOf(::shouldShowAnimationDebug));
 
+    // By default clients share a cache of encoded subtrees, you can change its size or pass 0 to disable it
+    const char* ENCODE_CACHE_MB = "--encodeCacheMB";
+    const char* encodeCacheMB = getCmdOption(argc, argv, ENCODE_CACHE_MB);
+    unsigned long encodeCacheBytes = encodeCacheMB ? atoi(encodeCacheMB) * 1024UL * 1024UL : DEFAULT_ENCODE_CACHE_BYTES;
+    if (encodeCacheBytes > 0) {
+        ::encodeCache = new VoxelEncodeCache(encodeCacheBytes);
+    }
+    printf("encodeCacheBytes=%lu\n", encodeCacheBytes);
+
     // By default we will voxel persist, if you want to disable this, then pass in this parameter
     const char* NO_VOXEL_PERSIST = "--NoVoxelPersist";
     if (cmdOptionExists(argc, argv, NO_VOXEL_PERSIST)) {
@@ -234,6 +247,17 @@ int main(int argc, const char * argv[]) {
         }
         printf("packetsPerSecond=%s PACKETS_PER_CLIENT_PER_INTERVAL=%d\n", packetsPerSecond, PACKETS_PER_CLIENT_PER_INTERVAL);
     }
+
+    const char* MAX_PACKETS_PER_SECOND = "--maxPacketsPerSecond";
+    const char* maxPacketsPerSecond = getCmdOption(argc, argv, MAX_PACKETS_PER_SECOND);
+    if (maxPacketsPerSecond) {
+        MAX_PACKETS_PER_CLIENT_PER_INTERVAL = atoi(maxPacketsPerSecond)/INTERVALS_PER_SECOND;
+        if (MAX_PACKETS_PER_CLIENT_PER_INTERVAL < PACKETS_PER_CLIENT_PER_INTERVAL) {
+            MAX_PACKETS_PER_CLIENT_PER_INTERVAL = PACKETS_PER_CLIENT_PER_INTERVAL;
+        }
+        printf("maxPacketsPerSecond=%s MAX_PACKETS_PER_CLIENT_PER_INTERVAL=%d\n", maxPacketsPerSecond,
+               MAX_PACKETS_PER_CLIENT_PER_INTERVAL);
+    }
     
     // for now, initialize the environments with fixed values
     environmentData[1].setID(1);
@@ -267,6 +291,27 @@ int main(int argc, const char * argv[]) {
         ::voxelServerPacketProcessor->initialize(true);
     }
 
+    // set up the worker threads that send voxels to all of our clients, by default one per core
+    const char* VOXEL_SEND_THREADS = "--voxelSendThreads";
+    const char* voxelSendThreads = getCmdOption(argc, argv, VOXEL_SEND_THREADS);
+    ::voxelSendScheduler = new VoxelSendScheduler(voxelSendThreads ? atoi(voxelSendThreads) : 0);
+    ::voxelSendScheduler->initialize();
+    printf("voxelSendThreads=%d\n", ::voxelSendScheduler->getWorkerCount());
+
+    // if you want the server's metrics scraped, pass in the local port to serve them on
+    const char* METRICS_PORT = "--metricsPort";
+    const char* metricsPort = getCmdOption(argc, argv, METRICS_PORT);
+    if (metricsPort) {
+        ::metricsServer = new MetricsServer(atoi(metricsPort));
+        if (!::metricsServer->start()) {
+            delete ::metricsServer;
+            ::metricsServer = NULL;
+        }
+    }
+
+    MetricCounter* receivedPacketsMetric = MetricsRegistry::getInstance()->getCounter(
+        "voxel_server_received_packets_total", "Packets pulled off the network");
+
     // loop to send to nodes requesting data
     while (true) {
 
@@ -279,6 +324,8 @@ int main(int argc, const char * argv[]) {
         if (nodeList->getNodeSocket()->receive(&senderAddress, packetData, &packetLength) &&
             packetVersionMatch(packetData)) {
 
+            receivedPacketsMetric->add();
+
             int numBytesPacketHeader = numBytesForPacketHeader(packetData);
 
             if (packetData[0] == PACKET_TYPE_HEAD_DATA) {
@@ -292,6 +339,28 @@ int main(int argc, const char * argv[]) {
                                                        nodeID);
 
                 NodeList::getInstance()->updateNodeWithData(node, packetData, packetLength);
+            } else if (packetData[0] == PACKET_TYPE_VOXEL_DATA_ACK) {
+                // handle acks right away rather than queueing them behind edits, they're timing our round trips, but
+                // drop any too short to hold the sequence and count
+                const int VOXEL_DATA_ACK_BYTES = sizeof(VOXEL_PACKET_SEQUENCE) + sizeof(uint32_t);
+                Node* node = NULL;
+                if (packetLength >= numBytesPacketHeader + VOXEL_DATA_ACK_BYTES) {
+                    node = NodeList::getInstance()->nodeWithAddress(&senderAddress);
+                }
+                if (node) {
+                    node->lock();
+                    node->setLastHeardMicrostamp(usecTimestampNow());
+                    VoxelNodeData* nodeData = (VoxelNodeData*) node->getLinkedData();
+                    if (nodeData) {
+                        VOXEL_PACKET_SEQUENCE newestSequence;
+                        uint32_t packetsReceived;
+                        memcpy(&newestSequence, packetData + numBytesPacketHeader, sizeof(newestSequence));
+                        memcpy(&packetsReceived, packetData + numBytesPacketHeader + sizeof(newestSequence),
+                               sizeof(packetsReceived));
+                        nodeData->rateController.ackReceived(newestSequence, packetsReceived);
+                    }
+                    node->unlock();
+                }
             } else if (packetData[0] == PACKET_TYPE_PING) {
                 // If the packet is a ping, let processNodeData handle it.
                 NodeList::getInstance()->processNodeData(&senderAddress, packetData, packetLength);
@@ -323,15 +392,27 @@ int main(int argc, const char * argv[]) {
         delete ::voxelServerPacketProcessor;
     }
 
+    if (::voxelSendScheduler) {
+        ::voxelSendScheduler->terminate();
+        delete ::voxelSendScheduler;
+        ::voxelSendScheduler = NULL;
+    }
+
     if (::voxelPersistThread) {
         ::voxelPersistThread->terminate();
         delete ::voxelPersistThread;
     }
+
+    if (::encodeCache) {
+        delete ::encodeCache;
+    }
+
+    if (::metricsServer) {
+        delete ::metricsServer;
+    }
     
     // tell our NodeList we're done with notifications
     nodeList->removeHook(&nodeWatcher);
-    
-    pthread_mutex_destroy(&::treeLock);
 
     return 0;
 }